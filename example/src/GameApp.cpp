@@ -1,11 +1,13 @@
 #include "GameApp.h"
 #include "Polygon.h"
+#include "SpriteBench.h"
 
 #define NUM_POLYGONS 100
 
 JRenderer* GameApp::mRenderer = NULL;
 
 Polygon *polygons;
+SpriteBench *spriteBench = NULL;
 
 GameApp::GameApp()
 {
@@ -24,6 +26,7 @@ void GameApp::Create()
 
 void GameApp::Destroy()
 {
+    SAFE_DELETE(spriteBench);
 
 }
 
@@ -32,6 +35,21 @@ void GameApp::Update()
 	JGE* engine = JGE::GetInstance();	
 	float dt = engine->GetDelta();
 
+    // TRIANGLE toggles the sprite benchmark
+    if (engine->GetButtonClick(CTRL_TRIANGLE))
+    {
+        if (spriteBench == NULL)
+            spriteBench = new SpriteBench();
+        else
+            SAFE_DELETE(spriteBench);
+    }
+
+    if (spriteBench)
+    {
+        spriteBench->Update(dt);
+        return;
+    }
+
     for(int i=0; i<NUM_POLYGONS; i++)
         polygons[i].Update(dt);
 }
@@ -40,6 +58,12 @@ void GameApp::Render()
 {
     mRenderer->ClearScreen(ARGB(255,255,255,255));
 
+    if (spriteBench)
+    {
+        spriteBench->Render();
+        return;
+    }
+
     for(int i=0; i<NUM_POLYGONS; i++)
         polygons[i].Render();
 }
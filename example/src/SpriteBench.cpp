@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <JGE.h>
+#include <JThreadPool.h>
+
+#include "SpriteBench.h"
+
+#define BENCH_REPORT_FRAMES 120
+
+static const int gSpriteCounts[] = { 1000, 10000, 50000 };
+static const char* gBackendNames[] = { "immediate", "batched", "instanced", "threaded" };
+
+#define BENCH_THREADED 3
+
+SpriteBench::SpriteBench()
+{
+    mRenderer = JRenderer::GetInstance();
+
+    PIXEL_TYPE bits[16*16];
+    for (int i=0; i<16*16; i++)
+        bits[i] = ARGB(255, 255, 255, 255);
+
+    mTexture = mRenderer->CreateTexture(16, 16);
+    mTexture->UpdateBits(16, 16, bits);
+    mQuad = new JQuad(mTexture, 0, 0, 16, 16);
+    mQuad->SetHotSpot(8, 8);
+
+    mCountIndex = 0;
+    mBackend = SPRITE_BACKEND_BATCHED;
+    Reset();
+
+    // compare runs with and without JResourceManager::SetShaderCacheDir
+    printf("shader startup: %.3f ms\n", mRenderer->GetShaderLoadTime());
+}
+
+SpriteBench::~SpriteBench()
+{
+    SAFE_DELETE(mQuad);
+    SAFE_DELETE(mTexture);
+}
+
+void SpriteBench::Reset()
+{
+    mSprites.resize(gSpriteCounts[mCountIndex]);
+    for (size_t i=0; i<mSprites.size(); i++)
+    {
+        Sprite &s = mSprites[i];
+        s.x = rand()%(int)SCREEN_WIDTH_F;
+        s.y = rand()%(int)SCREEN_HEIGHT_F;
+        s.vx = (rand()%100) - 50.0f;
+        s.vy = (rand()%100) - 50.0f;
+        s.angle = (rand()%628) / 100.0f;
+    }
+
+    mRenderer->SetSpriteBackend(mBackend == BENCH_THREADED ? SPRITE_BACKEND_BATCHED : mBackend);
+    mElapsed = 0.0;
+    mFrames = 0;
+}
+
+void SpriteBench::Update(float dt)
+{
+    JGE* engine = JGE::GetInstance();
+    if (engine->GetButtonClick(CTRL_START))
+    {
+        mCountIndex = (mCountIndex+1) % 3;
+        Reset();
+    }
+    if (engine->GetButtonClick(CTRL_SELECT))
+    {
+        mBackend = (mBackend+1) % 4;
+        Reset();
+    }
+
+    for (size_t i=0; i<mSprites.size(); i++)
+    {
+        Sprite &s = mSprites[i];
+        s.x += s.vx*dt;
+        s.y += s.vy*dt;
+        s.angle += dt;
+        if (s.x < 0 || s.x > SCREEN_WIDTH_F) s.vx = -s.vx;
+        if (s.y < 0 || s.y > SCREEN_HEIGHT_F) s.vy = -s.vy;
+    }
+}
+
+void SpriteBench::RecordThreaded()
+{
+    JThreadPool* pool = JThreadPool::GetInstance();
+    int threads = pool->GetThreadCount();
+    if ((int)mQueues.size() < threads)
+        mQueues.resize(threads);
+
+    int count = (int)mSprites.size();
+    int slice = (count + threads - 1) / threads;
+
+    pool->Run(threads, [&](int task, int thread)
+    {
+        JRenderQueue &queue = mQueues[thread];
+        JQuad quad = *mQuad;
+
+        int end = std::min(count, (task+1)*slice);
+        for (int i=task*slice; i<end; i++)
+        {
+            Sprite &s = mSprites[i];
+            int r = (i*7)&255, g = (i*13)&255, b = (i*29)&255;
+            quad.SetColor(ARGB(255, r, g, b));
+            queue.AddQuad(&quad, s.x, s.y, s.angle);
+        }
+    });
+
+    for (int i=0; i<threads; i++)
+        mRenderer->MergeRenderQueue(mQueues[i]);
+}
+
+void SpriteBench::Render()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (mBackend == BENCH_THREADED)
+    {
+        RecordThreaded();
+    }
+    else
+    {
+        for (size_t i=0; i<mSprites.size(); i++)
+        {
+            Sprite &s = mSprites[i];
+            int r = (i*7)&255, g = (i*13)&255, b = (i*29)&255;
+            mQuad->SetColor(ARGB(255, r, g, b));
+            mRenderer->RenderQuad(mQuad, s.x, s.y, s.angle);
+        }
+    }
+    mRenderer->FlushBatch();
+
+    auto end = std::chrono::high_resolution_clock::now();
+    mElapsed += std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (++mFrames == BENCH_REPORT_FRAMES)
+    {
+        printf("sprites: %d backend: %s submit: %.3f ms/frame fps: %.1f\n", (int)mSprites.size(),
+            gBackendNames[mBackend], mElapsed/mFrames, JGE::GetInstance()->GetFPS());
+        mElapsed = 0.0;
+        mFrames = 0;
+    }
+}
@@ -0,0 +1,45 @@
+#include <vector>
+#include <JTypes.h>
+#include <JRenderer.h>
+#include <JRenderQueue.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// Sprite stress test comparing the sprite backends of JRenderer.
+///
+/// START cycles the sprite count (1k/10k/50k), SELECT cycles the backend,
+/// the last one records with all threads of JThreadPool.
+/// Average submission time is printed every BENCH_REPORT_FRAMES frames, the
+/// time the renderer took to set its shaders up once at start.
+///
+//////////////////////////////////////////////////////////////////////////
+class SpriteBench
+{
+private:
+    struct Sprite
+    {
+        float x, y;
+        float vx, vy;
+        float angle;
+    };
+
+    JRenderer* mRenderer;
+    JTexture* mTexture;
+    JQuad* mQuad;
+    std::vector<Sprite> mSprites;
+    int mCountIndex;
+    int mBackend;
+
+    // one queue per thread for the threaded mode
+    std::vector<JRenderQueue> mQueues;
+
+    double mElapsed;
+    int mFrames;
+
+    void Reset();
+    void RecordThreaded();
+public:
+    SpriteBench();
+    ~SpriteBench();
+    void Update(float dt);
+    void Render();
+};
@@ -2,6 +2,7 @@
 #define _JAPP_H_
 
 class JGE;
+struct JRenderStats;
 
 //////////////////////////////////////////////////////////////////////////
 /// Main application class for the system to run. The core game class
@@ -72,6 +73,24 @@ public:
 	///
 	//////////////////////////////////////////////////////////////////////////
 	virtual void Resume() = 0;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get rendering statistics of a finished frame, for showing or logging
+	/// them from the game. See JRenderer::GetFrameStats().
+	///
+	/// @par Example: Showing the cost of the last frame:
+	/// @code
+	/// const JRenderStats *stats = GetRenderStats();
+	/// if (stats)
+	///		mFont->printf(0, 0, "%d draws %.2f ms", stats->drawCalls, stats->submitTime);
+	/// @endcode
+	///
+	/// @param framesAgo - 0 for the last finished frame.
+	///
+	/// @return Statistics of the frame, NULL if not kept.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	const JRenderStats* GetRenderStats(int framesAgo = 0) const;
 };
 
 
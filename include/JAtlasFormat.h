@@ -0,0 +1,64 @@
+#ifndef _JATLASFORMAT_H_
+#define _JATLASFORMAT_H_
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// Binary index written by tools/atlasbaker and read by
+/// JResourceManager::LoadAtlas.
+///
+/// @code
+///
+///		JAtlasHeader
+///		JAtlasEntry[entryCount]		sorted by nameHash
+///
+/// @endcode
+///
+/// Pages are stored next to the index as <index name>_<page>.png. All
+/// values are little endian.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#define ATLAS_MAGIC		0x4C54414A		// "JATL"
+#define ATLAS_VERSION	1
+
+//------------------------------------------------------------------------------------------------
+struct JAtlasHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t pageCount;
+	uint32_t entryCount;
+};
+
+//------------------------------------------------------------------------------------------------
+struct JAtlasEntry
+{
+	uint32_t nameHash;		// JAtlasHash of the image name
+	uint16_t page;
+	uint16_t x, y;			// trimmed rect in the page
+	uint16_t width, height;
+	int16_t trimX, trimY;	// position of the trimmed rect in the source image
+	uint16_t sourceWidth, sourceHeight;
+	int16_t hotSpotX, hotSpotY;	// in the source image
+	uint16_t reserved;		// 0
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Hash an image name (32 bit FNV-1a).
+///
+/// @param name - Image file name without directory and extension.
+///
+//////////////////////////////////////////////////////////////////////////
+inline uint32_t JAtlasHash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+#endif
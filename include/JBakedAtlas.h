@@ -0,0 +1,47 @@
+#ifndef _JBAKEDATLAS_H_
+#define _JBAKEDATLAS_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include "JTypes.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// Atlas baked offline by tools/atlasbaker, loaded with
+/// JResourceManager::LoadAtlas.
+///
+/// Owns the page textures and one JQuad per image. Images trimmed by the
+/// baker get their hot spot moved by the trimmed offset, so they are
+/// drawn at the same place as the untrimmed image.
+///
+//////////////////////////////////////////////////////////////////////////
+class JBakedAtlas
+{
+public:
+	~JBakedAtlas();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get quad of an image.
+	///
+	/// @param name - Image file name without directory and extension.
+	///
+	/// @return NULL if the atlas has no such image.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JQuad* GetQuad(const char *name) const;
+
+	int GetQuadCount() const { return (int)mQuads.size(); }
+	int GetPageCount() const { return (int)mPages.size(); }
+	JTexture* GetPage(int index) const { return mPages[index]; }
+
+private:
+	friend class JResourceManager;
+
+	JBakedAtlas() { }
+
+	std::vector<JTexture*> mPages;
+	std::vector<uint32_t> mHashes;	// sorted, same order as mQuads
+	std::vector<JQuad*> mQuads;
+};
+
+#endif
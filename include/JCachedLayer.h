@@ -0,0 +1,82 @@
+#ifndef _JCACHEDLAYER_H_
+#define _JCACHEDLAYER_H_
+
+#include "JTypes.h"
+
+//////////////////////////////////////////////////////////////////////////
+/// Part of the screen that rarely changes, like a background or the
+/// frame of a HUD, kept in a render target. It is drawn again only after
+/// Invalidate(), every other frame costs a single quad.
+///
+/// The layer is composed with premultiplied alpha, which is what drawing
+/// with the default blending into the cleared target produces. Opaque
+/// pixels come out exact, translucent ones slightly more transparent
+/// than when drawn directly.
+///
+/// @par Example: A background redrawn only when the level changes:
+/// @code
+/// void Render()
+/// {
+///		if (mBackground->BeginUpdate())
+///		{
+///			DrawTiles();
+///			mBackground->EndUpdate();
+///		}
+///		mBackground->Render(0, 0);
+/// }
+/// @endcode
+///
+//////////////////////////////////////////////////////////////////////////
+class JCachedLayer
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	///
+	/// @param width - Width of the layer in screen coordinates.
+	/// @param height - Height of the layer in screen coordinates.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JCachedLayer(int width, int height);
+	~JCachedLayer();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Have the layer drawn again at the next BeginUpdate().
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Invalidate() { mValid = false; }
+	bool IsValid() const { return mValid; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Start drawing the layer if it is invalid. Everything drawn until
+	/// EndUpdate() goes into the layer, with its top-left corner at 0,0.
+	///
+	/// Without render target support the layer cannot be cached: this
+	/// always returns true and the drawing goes straight to the screen.
+	///
+	/// @return true if the layer has to be drawn, then EndUpdate() must
+	///			follow.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	bool BeginUpdate();
+
+	void EndUpdate();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw the layer.
+	///
+	/// @param x - X position of the top-left corner.
+	/// @param y - Y position of the top-left corner.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Render(float x, float y);
+
+	JTexture* GetTexture() const { return mTexture; }
+
+private:
+	JTexture *mTexture;		// NULL without render target support
+	JQuad *mQuad;
+	bool mValid;
+};
+
+#endif
@@ -44,6 +44,18 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	int GetFileSize();
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Open, read and close a file with a single read call. Unlike
+	/// OpenFile, safe to call from several threads.
+	/// 
+	/// @param filename - Name of file to read.
+	/// @param buffer - Receives the content of the file.
+	/// 
+	/// @return true if the whole file was read.
+	/// 
+	//////////////////////////////////////////////////////////////////////////
+	bool ReadWholeFile(const string &filename, vector<unsigned char> &buffer);
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Close file.
 	/// 
@@ -0,0 +1,20 @@
+#ifndef _JGL_H_
+#define _JGL_H_
+
+//////////////////////////////////////////////////////////////////////////
+/// Single place the engine gets GL from.
+///
+/// Normal builds use vitaGL (or its WebGL counterpart under emscripten).
+/// Builds with JGE_HEADLESS defined get the GL subset the engine uses
+/// from JGLHeadless.h instead, implemented by JGLRecorder, so the engine
+/// runs on machines without a GPU.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef JGE_HEADLESS
+#include "JGLHeadless.h"
+#else
+#include <vitaGL.h>
+#endif
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef _JGLHEADLESS_H_
+#define _JGLHEADLESS_H_
+
+//////////////////////////////////////////////////////////////////////////
+/// GL for JGE_HEADLESS builds.
+///
+/// Declares the OpenGL ES 3 subset used by the engine with the standard
+/// enum values. The functions are implemented in JGLHeadless.cpp on top
+/// of JGLRecorder instead of a driver: object names are handed out,
+/// shaders always compile and link, and every call is counted and
+/// optionally logged so draw calls and upload sizes can be checked
+/// without a GPU. With JGLRasterizer enabled, draws are also shaded on
+/// the CPU and rasterized into its framebuffer.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+typedef unsigned int GLenum;
+typedef unsigned char GLboolean;
+typedef unsigned int GLbitfield;
+typedef void GLvoid;
+typedef signed char GLbyte;
+typedef short GLshort;
+typedef int GLint;
+typedef int GLsizei;
+typedef unsigned char GLubyte;
+typedef unsigned short GLushort;
+typedef unsigned int GLuint;
+typedef float GLfloat;
+typedef float GLclampf;
+typedef char GLchar;
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+
+#define GL_FALSE						0
+#define GL_TRUE							1
+#define GL_NONE							0
+#define GL_NO_ERROR						0
+
+#define GL_DEPTH_BUFFER_BIT				0x00000100
+#define GL_STENCIL_BUFFER_BIT			0x00000400
+#define GL_COLOR_BUFFER_BIT				0x00004000
+
+#define GL_POINTS						0x0000
+#define GL_LINES						0x0001
+#define GL_LINE_LOOP					0x0002
+#define GL_LINE_STRIP					0x0003
+#define GL_TRIANGLES					0x0004
+#define GL_TRIANGLE_STRIP				0x0005
+#define GL_TRIANGLE_FAN					0x0006
+
+#define GL_ZERO							0
+#define GL_ONE							1
+#define GL_SRC_COLOR					0x0300
+#define GL_ONE_MINUS_SRC_COLOR			0x0301
+#define GL_SRC_ALPHA					0x0302
+#define GL_ONE_MINUS_SRC_ALPHA			0x0303
+#define GL_DST_ALPHA					0x0304
+#define GL_ONE_MINUS_DST_ALPHA			0x0305
+#define GL_DST_COLOR					0x0306
+#define GL_ONE_MINUS_DST_COLOR			0x0307
+#define GL_SRC_ALPHA_SATURATE			0x0308
+
+#define GL_CULL_FACE					0x0B44
+#define GL_DEPTH_TEST					0x0B71
+#define GL_VIEWPORT						0x0BA2
+#define GL_BLEND						0x0BE2
+#define GL_SCISSOR_TEST					0x0C11
+#define GL_TEXTURE_2D					0x0DE1
+
+#define GL_BYTE							0x1400
+#define GL_UNSIGNED_BYTE				0x1401
+#define GL_SHORT						0x1402
+#define GL_UNSIGNED_SHORT				0x1403
+#define GL_INT							0x1404
+#define GL_UNSIGNED_INT					0x1405
+#define GL_FLOAT						0x1406
+
+#define GL_VENDOR						0x1F00
+#define GL_RENDERER						0x1F01
+#define GL_VERSION						0x1F02
+#define GL_EXTENSIONS					0x1F03
+
+#define GL_ALPHA						0x1906
+#define GL_RGB							0x1907
+#define GL_RGBA							0x1908
+#define GL_LUMINANCE					0x1909
+#define GL_RGBA8						0x8058
+
+#define GL_NEAREST						0x2600
+#define GL_LINEAR						0x2601
+#define GL_NEAREST_MIPMAP_NEAREST		0x2700
+#define GL_LINEAR_MIPMAP_NEAREST		0x2701
+#define GL_NEAREST_MIPMAP_LINEAR		0x2702
+#define GL_LINEAR_MIPMAP_LINEAR			0x2703
+#define GL_TEXTURE_MAG_FILTER			0x2800
+#define GL_TEXTURE_MIN_FILTER			0x2801
+#define GL_TEXTURE_WRAP_S				0x2802
+#define GL_TEXTURE_WRAP_T				0x2803
+#define GL_REPEAT						0x2901
+#define GL_CLAMP_TO_EDGE				0x812F
+#define GL_MIRRORED_REPEAT				0x8370
+
+#define GL_TEXTURE0						0x84C0
+
+#define GL_NUM_COMPRESSED_TEXTURE_FORMATS	0x86A2
+#define GL_COMPRESSED_TEXTURE_FORMATS		0x86A3
+
+#define GL_PROGRAM_BINARY_LENGTH		0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS	0x87FE
+#define GL_PROGRAM_BINARY_FORMATS		0x87FF
+
+// program binaries of the headless GL, the sources linked
+#define GL_PROGRAM_BINARY_HEADLESS		0x4A47
+
+#define GL_ARRAY_BUFFER					0x8892
+#define GL_ELEMENT_ARRAY_BUFFER			0x8893
+#define GL_STREAM_DRAW					0x88E0
+#define GL_STATIC_DRAW					0x88E4
+#define GL_DYNAMIC_DRAW					0x88E8
+
+#define GL_FRAGMENT_SHADER				0x8B30
+#define GL_VERTEX_SHADER				0x8B31
+#define GL_FLOAT_VEC2					0x8B50
+#define GL_FLOAT_VEC3					0x8B51
+#define GL_FLOAT_VEC4					0x8B52
+#define GL_INT_VEC2						0x8B53
+#define GL_INT_VEC3						0x8B54
+#define GL_INT_VEC4						0x8B55
+#define GL_BOOL							0x8B56
+#define GL_FLOAT_MAT2					0x8B5A
+#define GL_FLOAT_MAT3					0x8B5B
+#define GL_FLOAT_MAT4					0x8B5C
+#define GL_SAMPLER_2D					0x8B5E
+#define GL_COMPILE_STATUS				0x8B81
+#define GL_LINK_STATUS					0x8B82
+#define GL_INFO_LOG_LENGTH				0x8B84
+#define GL_ACTIVE_UNIFORMS				0x8B86
+#define GL_ACTIVE_UNIFORM_MAX_LENGTH	0x8B87
+#define GL_ACTIVE_ATTRIBUTES			0x8B89
+#define GL_ACTIVE_ATTRIBUTE_MAX_LENGTH	0x8B8A
+
+#define GL_FRAMEBUFFER_COMPLETE						0x8CD5
+#define GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT	0x8CD7
+#define GL_COLOR_ATTACHMENT0			0x8CE0
+#define GL_FRAMEBUFFER					0x8D40
+
+void glActiveTexture(GLenum texture);
+void glAttachShader(GLuint program, GLuint shader);
+void glBindBuffer(GLenum target, GLuint buffer);
+void glBindFramebuffer(GLenum target, GLuint framebuffer);
+void glBindTexture(GLenum target, GLuint texture);
+void glBindVertexArray(GLuint array);
+void glBlendFunc(GLenum sfactor, GLenum dfactor);
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+GLenum glCheckFramebufferStatus(GLenum target);
+void glClear(GLbitfield mask);
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+void glCompileShader(GLuint shader);
+void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void *data);
+GLuint glCreateProgram(void);
+GLuint glCreateShader(GLenum type);
+void glDeleteBuffers(GLsizei n, const GLuint *buffers);
+void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+void glDeleteProgram(GLuint program);
+void glDeleteShader(GLuint shader);
+void glDeleteTextures(GLsizei n, const GLuint *textures);
+void glDeleteVertexArrays(GLsizei n, const GLuint *arrays);
+void glDisable(GLenum cap);
+void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+void glEnable(GLenum cap);
+void glEnableVertexAttribArray(GLuint index);
+void glFlush(void);
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+void glGenBuffers(GLsizei n, GLuint *buffers);
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers);
+void glGenTextures(GLsizei n, GLuint *textures);
+void glGenVertexArrays(GLsizei n, GLuint *arrays);
+void glGenerateMipmap(GLenum target);
+void glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name);
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name);
+GLint glGetAttribLocation(GLuint program, const GLchar *name);
+GLenum glGetError(void);
+void glGetIntegerv(GLenum pname, GLint *data);
+void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+void glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params);
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params);
+const GLubyte* glGetString(GLenum name);
+GLint glGetUniformLocation(GLuint program, const GLchar *name);
+GLboolean glIsEnabled(GLenum cap);
+void glLineWidth(GLfloat width);
+void glLinkProgram(GLuint program);
+void glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+void glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+void glTexParameteri(GLenum target, GLenum pname, GLint param);
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+void glUniform1f(GLint location, GLfloat v0);
+void glUniform1i(GLint location, GLint v0);
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1);
+void glUniform2i(GLint location, GLint v0, GLint v1);
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+void glUseProgram(GLuint program);
+void glVertexAttribDivisor(GLuint index, GLuint divisor);
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+//////////////////////////////////////////////////////////////////////////
+/// What the recorder does with the calls it sees.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	GL_RECORDER_NULL,		///< Discard everything, only object names are handed out.
+	GL_RECORDER_COUNT,		///< Update the statistics, keep no log.
+	GL_RECORDER_RECORD		///< Update the statistics and log every call.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Kinds of recorded calls.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	GL_CALL_DRAW,			///< glDraw*.
+	GL_CALL_STATE,			///< Bindings, capabilities, blending, line width, viewport.
+	GL_CALL_UNIFORM,		///< glUniform*.
+	GL_CALL_BUFFER_UPLOAD,	///< glBufferData, glBufferSubData.
+	GL_CALL_TEXTURE_UPLOAD,	///< glTexImage2D, glTexSubImage2D, glGenerateMipmap.
+	GL_CALL_OBJECT,			///< Creation and deletion of GL objects.
+	GL_CALL_OTHER			///< Everything else.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// One logged GL call.
+///
+//////////////////////////////////////////////////////////////////////////
+struct JGLCall
+{
+	const char *name;	// GL function name
+	int kind;			// GL_CALL_*
+	GLenum target;		// primitive mode, capability, buffer target or blend factors
+	GLuint object;		// object bound or affected, texture of draws
+	int count;			// vertices of draws, objects of glGen*/glDelete*
+	int instances;		// instances of draws
+	long bytes;			// bytes uploaded
+	long memory;		// change of texture memory
+	bool redundant;		// state change setting the state already current
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Counters gathered since the last ResetStats().
+///
+//////////////////////////////////////////////////////////////////////////
+struct JGLStats
+{
+	int calls;
+	int drawCalls;
+	long vertices;				// vertices submitted, times instances
+	int stateChanges;
+	int redundantStateChanges;	// included in stateChanges
+	int uniformUploads;
+	int bufferUploads;
+	long bufferUploadBytes;
+	int textureUploads;
+	long textureUploadBytes;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Inspectable log of the GL calls made by a JGE_HEADLESS build.
+///
+/// Tests and benchmarks switch the mode, run a frame and compare the
+/// statistics, so a change batching less shows up as more draw calls or
+/// upload bytes.
+///
+//////////////////////////////////////////////////////////////////////////
+class JGLRecorder
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the singleton instance.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static JGLRecorder* GetInstance();
+
+	static void Destroy();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set what to do with the calls. Defaults to GL_RECORDER_COUNT.
+	///
+	/// @param mode - GL_RECORDER_NULL, GL_RECORDER_COUNT or GL_RECORDER_RECORD.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetMode(int mode) { mMode = mode; }
+	int GetMode() const { return mMode; }
+
+	const std::vector<JGLCall>& GetLog() const { return mLog; }
+	void ClearLog() { mLog.clear(); }
+
+	const JGLStats& GetStats() const { return mStats; }
+	void ResetStats();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get bytes of texture storage currently allocated, mipmaps included.
+	/// Not affected by ResetStats().
+	///
+	//////////////////////////////////////////////////////////////////////////
+	long GetTextureMemory() const { return mTextureMemory; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Write the log, one call per line, followed by the statistics.
+	///
+	/// @param file - File to write to.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Dump(FILE *file) const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Account for a call. Used by the headless gl* functions.
+	///
+	/// @param call - Call to add.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Record(const JGLCall &call);
+
+protected:
+	JGLRecorder();
+	~JGLRecorder();
+
+private:
+	static JGLRecorder* mInstance;
+
+	int mMode;
+	std::vector<JGLCall> mLog;
+	JGLStats mStats;
+	long mTextureMemory;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef _JGLRASTERIZER_H_
+#define _JGLRASTERIZER_H_
+
+#include "JGLHeadless.h"
+
+#include <vector>
+
+// Edge length of the square screen tiles rasterized in parallel.
+// Must be a multiple of 4, pixels are shaded 4 at a time.
+#define RASTER_TILE_SIZE			64
+
+// Triangles binned before the tiles are rasterized without waiting for
+// Finish(), bounds the memory used by long frames.
+#define RASTER_MAX_PENDING_TRIANGLES	65536
+
+//////////////////////////////////////////////////////////////////////////
+/// Vertex in window space, origin at the top-left of the framebuffer.
+///
+//////////////////////////////////////////////////////////////////////////
+struct JRasterVertex
+{
+	float x, y;
+	float u, v;			// normalized texture coordinates
+	float r, g, b, a;	// 0 to 1
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// RGBA8 texture sampled by a draw.
+///
+//////////////////////////////////////////////////////////////////////////
+struct JRasterTexture
+{
+	const unsigned char *pixels;	// NULL for untextured draws
+	int width, height;
+	GLenum minFilter, magFilter;	// mipmap filters sample the base level
+	GLenum wrapS, wrapT;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// State of the triangles added after BeginDraw().
+///
+//////////////////////////////////////////////////////////////////////////
+struct JRasterState
+{
+	JRasterTexture texture;
+	bool blend;
+	GLenum blendSrc, blendDest;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Work done since the last ResetStats().
+///
+//////////////////////////////////////////////////////////////////////////
+struct JRasterStats
+{
+	int triangles;
+	int tileTriangles;		// triangles times the tiles they touch
+	long fragments;			// pixels written
+	double rasterTime;		// milliseconds spent rasterizing tiles
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Software rasterizer behind the headless GL.
+///
+/// Draws of a JGE_HEADLESS build are shaded by JGLHeadless.cpp and end
+/// up here as window space triangles. Triangles are binned into tiles of
+/// RASTER_TILE_SIZE pixels; Finish() rasterizes the tiles in parallel on
+/// the JThreadPool, each tile in submission order so blending is
+/// correct. Pixels are shaded 4 at a time with SSE or NEON when
+/// available.
+///
+/// Supports what the engine draws: colored and textured triangles,
+/// lines, points, nearest and linear sampling with clamp, repeat and
+/// mirrored wrapping, and the blend factors of glBlendFunc.
+///
+/// @par Example: Comparing a frame with a golden image:
+/// @code
+/// JGLRasterizer::GetInstance()->SetEnabled(true);
+///
+/// JRenderer *renderer = JRenderer::GetInstance();
+/// renderer->BeginScene();
+/// app->Render();
+/// renderer->EndScene();
+///
+/// int differing = JGLRasterizer::GetInstance()->ComparePNG("golden/title.png", 2);
+/// @endcode
+///
+//////////////////////////////////////////////////////////////////////////
+class JGLRasterizer
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the singleton instance.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static JGLRasterizer* GetInstance();
+
+	static void Destroy();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Turn rasterizing of the headless draws on or off. Off by default,
+	/// then draws are only counted by JGLRecorder.
+	///
+	/// @param enabled - True to rasterize.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return mEnabled; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Resize the framebuffer, clearing it to transparent black. Defaults
+	/// to SCREEN_WIDTH x SCREEN_HEIGHT.
+	///
+	/// @param width - Width in pixels.
+	/// @param height - Height in pixels.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetFramebufferSize(int width, int height);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Replace the framebuffer, to draw into a texture.
+	///
+	/// @param width - Width in pixels.
+	/// @param height - Height in pixels.
+	/// @param pixels - RGBA8 pixels, rows from the top, NULL to clear.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetFramebuffer(int width, int height, const unsigned char *pixels);
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the framebuffer after finishing pending triangles.
+	///
+	/// @return RGBA8 pixels, rows from the top, GetWidth()*4 bytes per row.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	const unsigned char* GetPixels();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Fill the whole framebuffer with a color.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Clear(float r, float g, float b, float a);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Start a draw, the triangles added next use the given state. The
+	/// texture pixels must stay unchanged until Finish().
+	///
+	/// @param state - State of the draw.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void BeginDraw(const JRasterState &state);
+
+	void AddTriangle(const JRasterVertex &v0, const JRasterVertex &v1, const JRasterVertex &v2);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a line as a quad of the given width around it.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddLine(const JRasterVertex &v0, const JRasterVertex &v1, float width);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a point as a square of the given size around it.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddPoint(const JRasterVertex &v, float size);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Rasterize all pending triangles.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Finish();
+
+	const JRasterStats& GetStats() const { return mStats; }
+	void ResetStats();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Save the framebuffer.
+	///
+	/// @param filename - PNG file to write.
+	///
+	/// @return True on success.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	bool SavePNG(const char *filename);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Compare the framebuffer with an image of the same size.
+	///
+	/// @param filename - PNG file to compare with.
+	/// @param tolerance - Largest channel difference still counted as equal.
+	///
+	/// @return Number of differing pixels, -1 if the file could not be
+	///			read or its size differs.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int ComparePNG(const char *filename, int tolerance);
+
+protected:
+	JGLRasterizer();
+	~JGLRasterizer();
+
+private:
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];	// edge functions, positive inside
+		bool topLeft[3];					// edges owning the pixels exactly on them
+		float plane[6][3];					// u, v, r, g, b, a as dx, dy and constant
+		int minX, minY, maxX, maxY;
+		int state;
+		bool minify;						// more than one texel per pixel
+	};
+
+	static JGLRasterizer* mInstance;
+
+	bool mEnabled;
+	int mWidth, mHeight;
+	int mTilesX, mTilesY;
+	std::vector<unsigned char> mPixels;
+
+	std::vector<JRasterState> mStates;
+	std::vector<Triangle> mTriangles;
+	std::vector<std::vector<int> > mTiles;	// triangle indices per tile
+
+	JRasterStats mStats;
+	std::vector<long> mTileFragments;
+
+	void RasterizeTile(int tile);
+	void RasterizeTriangle(const Triangle &tri, int x0, int y0, int x1, int y1, long &fragments);
+};
+
+#endif
@@ -4,6 +4,13 @@
 #define PRINTF_BUFFER_SIZE		256
 #define MAX_CHAR				256
 
+// Strings whose glyph layout is kept, the least recently drawn is dropped first.
+#define FONT_RUN_CACHE_SIZE		256
+
+#include <map>
+#include <string>
+#include <vector>
+
 #include "JRenderer.h"
 #include "JResourceManager.h"
 
@@ -17,6 +24,11 @@
 ///		2: xxx.dat, widths for each character
 ///	Each font contains 2 sets of characters ASCII code (32-159).
 ///
+/// The glyph quads of a string are laid out once and kept for the
+/// following frames, keyed by the string and the scale, rotation,
+/// tracking, alignment and character set used. Each string is drawn as a
+/// single batch, its shadow included.
+///
 //////////////////////////////////////////////////////////////////////////
 class JLBFont
 {
@@ -45,6 +57,19 @@ public:
 	void		DrawString(const char *string, float x, float y, int align=JGETEXT_LEFT);
 	void		DrawShadowedString(const char *string, float x, float y, int align=JGETEXT_LEFT);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Record text into a render queue instead of drawing it. Does not
+	/// change the font, so several threads can record with the same font.
+	/// 
+	/// @param queue - Queue to record to.
+	/// @param string - text for rendering.
+	/// @param x - X position of text.
+	/// @param y - Y position of text.
+	/// @align - Text aligment.
+	/// 
+	//////////////////////////////////////////////////////////////////////////
+	void		RecordString(JRenderQueue &queue, const char *string, float x, float y, int align=JGETEXT_LEFT) const;
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Rendering text to screen with syntax similar to printf of C/C++.
 	/// 
@@ -149,12 +174,40 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void		SetBase(int base);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Drop all cached string layouts.
+	/// 
+	//////////////////////////////////////////////////////////////////////////
+	void		ClearCache();
+
+	int			GetCachedCount() const { return (int)mRuns.size(); }
+
 private:
+	struct RunKey
+	{
+		std::string	text;
+		float		scale;
+		float		rotation;
+		float		tracking;
+		int			align;
+		int			base;
+
+		bool operator<(const RunKey &other) const;
+	};
+
+	struct GlyphRun
+	{
+		std::vector<JSpriteVertex> vertices;	// relative to the text position, colors unset
+		unsigned int lastFrame;
+	};
+
 	static JRenderer*	mRenderer;
 
 	JTexture*	mTexture;
-	JQuad*		mQuad;
-	JQuad*		mShadowQuad;
+
+	std::map<RunKey, GlyphRun> mRuns;
+	std::vector<JSpriteVertex> mLayout;		// strings not cached
+	std::vector<JSpriteVertex> mVertices;	// run being drawn
 
 	float		mXPos[MAX_CHAR];
 	float		mYPos[MAX_CHAR];
@@ -167,10 +220,15 @@ private:
 	float       mSpacing;
 
 	PIXEL_TYPE		mColor;
+	PIXEL_TYPE		mShadowColor;
 	int			mBlend;
 
 	int			mBase;
 
+	void		LayoutString(const char *string, int align, std::vector<JSpriteVertex> &vertices) const;
+	const std::vector<JSpriteVertex>& GetRun(const char *string, int align);
+	void		DrawRun(const std::vector<JSpriteVertex> &glyphs, float x, float y, bool shadowed);
+
 };
 
 
@@ -0,0 +1,125 @@
+#ifndef _JPRIMITIVEBATCHER_H_
+#define _JPRIMITIVEBATCHER_H_
+
+#include <vector>
+
+#include "JShader.h"
+#include "JTypes.h"
+#include "JStreamBuffer.h"
+#include "JRenderState.h"
+
+// Vertices collected before the batch is forced out, must stay addressable with 16 bit indices.
+#define PRIMITIVE_BATCH_MAX_VERTICES	16384
+
+//------------------------------------------------------------------------------------------------
+struct JColorVertex
+{
+	GLfloat x, y;
+	GLuint color;		// RGBA8, red in the lowest byte
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Collects untextured primitives as indexed triangle, line or point
+/// lists with per-vertex color, so that any number of polygons and lines
+/// sharing the same state go out with a single draw call.
+///
+//////////////////////////////////////////////////////////////////////////
+class JPrimitiveBatcher
+{
+public:
+	JPrimitiveBatcher(JShader &shader, JStreamBuffer *vertexStream, JStreamBuffer *indexStream);
+	~JPrimitiveBatcher();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Append a primitive given in any GL drawing mode. Fans and strips are
+	/// converted to triangle lists, loops and strips to line lists.
+	///
+	/// @param mode - GL_TRIANGLES, GL_TRIANGLE_FAN, GL_TRIANGLE_STRIP,
+	///				  GL_LINES, GL_LINE_LOOP, GL_LINE_STRIP or GL_POINTS.
+	/// @param x - Array of X positions.
+	/// @param y - Array of Y positions.
+	/// @param count - Number of vertices.
+	/// @param color - Colour of all the vertices (ARGB).
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Append already indexed geometry.
+	///
+	/// @param mode - GL_TRIANGLES, GL_LINES or GL_POINTS.
+	/// @param vertices - Vertices to append.
+	/// @param vertexCount - Number of vertices.
+	/// @param indices - Indices relative to the first vertex passed.
+	/// @param indexCount - Number of indices.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set width of the lines drawn from now on.
+	///
+	/// @param width - Line width in pixels.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetLineWidth(float width);
+	float GetLineWidth() const { return mLineWidth; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw everything collected so far.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Flush();
+
+	bool HasPendingPrimitives() const { return !mIndices.empty(); }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the list type a primitive is converted to.
+	///
+	/// @return GL_TRIANGLES, GL_LINES, GL_POINTS or GL_NONE when the
+	///			primitive has too few or too many vertices to draw.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static GLenum GetListMode(GLenum mode, int count);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Convert a primitive to an indexed list. Does not touch GL, so it is
+	/// also used to record geometry for later submission.
+	///
+	/// @param base - Index given to the first vertex appended.
+	/// @param vertices - Receives the vertices.
+	/// @param indices - Receives the indices.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static void AppendPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color,
+								GLushort base, std::vector<JColorVertex> &vertices, std::vector<GLushort> &indices);
+
+private:
+	JRenderState *mRenderState;
+
+	JShader mShader;
+	GLuint mVAO;
+	GLint mVertexLocation;
+	GLint mColorLocation;
+
+	JStreamBuffer *mVertexStream;
+	JStreamBuffer *mIndexStream;
+
+	GLenum mMode;				// GL_TRIANGLES, GL_LINES or GL_POINTS
+	float mLineWidth;
+	float mBatchLineWidth;
+
+	std::vector<JColorVertex> mVertices;
+	std::vector<GLushort> mIndices;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Flush if the batch cannot take the geometry, then start a batch of
+	/// the given list mode.
+	///
+	/// @return Index of the first vertex to be appended.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	GLushort Reserve(GLenum mode, int vertexCount);
+};
+
+#endif
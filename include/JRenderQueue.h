@@ -0,0 +1,246 @@
+#ifndef _JRENDERQUEUE_H_
+#define _JRENDERQUEUE_H_
+
+#include <vector>
+#include <bitset>
+#include <stdint.h>
+
+#include "JTypes.h"
+#include "JSpriteRenderer.h"
+#include "JPrimitiveBatcher.h"
+
+#define RENDER_QUEUE_LAYERS		256
+#define RENDER_QUEUE_BLEND_MODES	256
+
+// Sort key layout, most significant bits first:
+//
+//	layer 8 | shader 4 | blend 8 | texture 20 | depth 24
+//
+// Layers marked stable only use layer and depth, so their commands keep
+// the order they were recorded in.
+#define RENDER_KEY_LAYER_SHIFT		56
+#define RENDER_KEY_SHADER_SHIFT		52
+#define RENDER_KEY_BLEND_SHIFT		44
+#define RENDER_KEY_TEXTURE_SHIFT	24
+#define RENDER_KEY_TEXTURE_MASK		0xFFFFF
+#define RENDER_KEY_DEPTH_MASK		0xFFFFFF
+#define RENDER_KEY_DEPTH_BIAS		0x800000
+
+enum
+{
+	RENDER_COMMAND_QUAD,		///< Textured quad, drawn by JSpriteRenderer.
+	RENDER_COMMAND_PRIMITIVE	///< Untextured indexed list, drawn by JPrimitiveBatcher.
+};
+
+//------------------------------------------------------------------------------------------------
+struct JRenderCommand
+{
+	int type;
+	JTexture *texture;		// quads only
+	int textureFilter;		// quads only
+	int blendSrc;
+	int blendDest;
+	GLenum mode;			// primitives only: GL_TRIANGLES, GL_LINES or GL_POINTS
+	float lineWidth;		// primitives only
+	int firstVertex;		// into the quad or the primitive vertices
+	int vertexCount;
+	int firstIndex;			// primitives only, indices are relative to firstVertex
+	int indexCount;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Deferred list of draw commands.
+///
+/// Quads and primitives are recorded with a 64 bit sort key instead of
+/// being drawn. Sorting by key groups commands of the same layer by
+/// shader, blending and texture, so the batchers see long runs of
+/// compatible geometry. The queue does not issue any GL calls itself,
+/// JRenderer replays the sorted commands through the batchers.
+///
+/// Queues can also be filled by worker threads, one queue per thread,
+/// and handed over to JRenderer::MergeRenderQueue on the GL thread.
+///
+//////////////////////////////////////////////////////////////////////////
+class JRenderQueue
+{
+public:
+	JRenderQueue();
+	~JRenderQueue();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set layer of the commands recorded from now on. Lower layers are
+	/// drawn first.
+	///
+	/// @param layer - 0 to RENDER_QUEUE_LAYERS-1.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetLayer(int layer);
+	int GetLayer() const { return mLayer; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set depth of the commands recorded from now on. Inside a layer
+	/// lower depths are drawn first, after state changes are grouped.
+	///
+	/// @param depth - Signed 24 bit depth.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetDepth(int depth);
+	int GetDepth() const { return mDepth; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Keep the recording order of a layer. Commands of a stable layer are
+	/// only sorted by depth, so alpha blended geometry that depends on
+	/// draw order comes out as submitted.
+	///
+	/// @param layer - Layer to change.
+	/// @param stable - true to keep recording order.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetLayerStable(int layer, bool stable);
+	bool IsLayerStable(int layer) const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set blending of the quads recorded with AddQuad from now on.
+	///
+	/// @param src - Source blending factor.
+	/// @param dest - Destination blending factor.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetBlend(int src, int dest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set texture filter of the quads recorded with AddQuad from now on.
+	///
+	/// @param filter - TEX_FILTER_NONE, TEX_FILTER_LINEAR or TEX_FILTER_NEAREST.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetTextureFilter(int filter);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Record a quad the same way JRenderer::RenderQuad draws it, using the
+	/// blending and texture filter of this queue.
+	///
+	/// @param quad - Quad to record.
+	/// @param xo - x position.
+	/// @param yo - y position.
+	/// @param angle - Rotation in radians.
+	/// @param xScale - Horizontal scaling.
+	/// @param yScale - Vertical scaling.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddQuad(const JQuad *quad, float xo, float yo, float angle=0.0f, float xScale=1.0f, float yScale=1.0f);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Record a sprite. The quad is transformed right away.
+	///
+	/// @param sprite - Sprite to record.
+	/// @param blendSrc - Source blending factor.
+	/// @param blendDest - Destination blending factor.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddSprite(const JSprite &sprite, int blendSrc, int blendDest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Record quads transformed beforehand as one command, using the
+	/// blending and texture filter of this queue. The quads keep their order
+	/// whatever the sorting.
+	///
+	/// @param texture - Texture of all the quads.
+	/// @param vertices - 4 vertices per quad.
+	/// @param quadCount - Number of quads.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddQuads(JTexture *texture, const JSpriteVertex *vertices, int quadCount);
+	void AddQuads(JTexture *texture, int textureFilter, const JSpriteVertex *vertices, int quadCount, int blendSrc, int blendDest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Record a primitive, see JPrimitiveBatcher::AddPrimitive.
+	///
+	/// @param lineWidth - Line width the primitive is drawn with.
+	/// @param blendSrc - Source blending factor.
+	/// @param blendDest - Destination blending factor.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color,
+					  float lineWidth, int blendSrc, int blendDest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Record already indexed geometry, see JPrimitiveBatcher::AddIndexed.
+	///
+	/// @param lineWidth - Line width the primitive is drawn with.
+	/// @param blendSrc - Source blending factor.
+	/// @param blendDest - Destination blending factor.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount,
+					float lineWidth, int blendSrc, int blendDest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Move all commands of another queue to the end of this one, keeping
+	/// their sort keys. The other queue is cleared.
+	///
+	/// @param other - Queue to take the commands from.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Append(JRenderQueue &other);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Sort the recorded commands. Commands with equal keys keep their
+	/// recording order.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Sort();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Drop all recorded commands, keeping the allocated memory.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Clear();
+
+	bool IsEmpty() const { return mCommands.empty(); }
+	int GetCommandCount() const { return (int)mCommands.size(); }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get a command in sorted order. Only valid after Sort().
+	///
+	//////////////////////////////////////////////////////////////////////////
+	const JRenderCommand &GetSortedCommand(int index) const { return mCommands[mSortEntries[index].index]; }
+
+	const JSpriteVertex *GetQuadVertices(const JRenderCommand &command) const { return &mQuadVertices[command.firstVertex]; }
+	const JColorVertex *GetPrimitiveVertices(const JRenderCommand &command) const { return &mPrimitiveVertices[command.firstVertex]; }
+	const GLushort *GetPrimitiveIndices(const JRenderCommand &command) const { return &mPrimitiveIndices[command.firstIndex]; }
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		int index;
+
+		bool operator<(const SortEntry &other) const
+		{
+			return key < other.key || (key == other.key && index < other.index);
+		}
+	};
+
+	int mLayer;
+	int mDepth;
+	int mBlendSrc;
+	int mBlendDest;
+	int mTextureFilter;
+	std::bitset<RENDER_QUEUE_LAYERS> mStableLayers;
+
+	std::vector<JRenderCommand> mCommands;
+	std::vector<SortEntry> mSortEntries;
+
+	std::vector<JSpriteVertex> mQuadVertices;
+	std::vector<JColorVertex> mPrimitiveVertices;
+	std::vector<GLushort> mPrimitiveIndices;
+
+	// blend factor pairs seen so far, their position is the blend id of the key
+	std::vector<std::pair<int, int> > mBlendModes;
+
+	int GetBlendId(int src, int dest);
+	void Record(JRenderCommand &command, int shaderId, GLuint textureId);
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef _JRENDERSTATE_H_
+#define _JRENDERSTATE_H_
+
+#include "JTypes.h"
+#include "JRenderStats.h"
+
+#include <chrono>
+
+#define RENDER_STATE_UNKNOWN			0xFFFFFFFF
+#define RENDER_STATE_TEXTURE_UNITS		8
+
+//////////////////////////////////////////////////////////////////////////
+/// Kinds of GL calls going through the state cache.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	STATE_CALL_USE_PROGRAM,
+	STATE_CALL_ACTIVE_TEXTURE,
+	STATE_CALL_BIND_TEXTURE,
+	STATE_CALL_TEX_PARAMETER,
+	STATE_CALL_BLEND_FUNC,
+	STATE_CALL_BIND_BUFFER,
+	STATE_CALL_BIND_VERTEX_ARRAY,
+	STATE_CALL_COUNT
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Shadow copy of the GL state touched by the engine. Every state change
+/// of the engine goes through here and is dropped when it would not
+/// change anything.
+///
+/// Code issuing GL calls on its own should call Invalidate() afterwards.
+///
+//////////////////////////////////////////////////////////////////////////
+class JRenderState
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the singleton instance
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static JRenderState* GetInstance();
+
+	static void Destroy();
+
+	void UseProgram(GLuint program);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Select the texture unit affected by the following texture calls.
+	///
+	/// @param unit - GL_TEXTURE0 + n.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void ActiveTexture(GLenum unit);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Bind a 2D texture to the active texture unit.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void BindTexture(GLuint texture);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set filtering of a texture. The texture is bound to the active
+	/// unit only if its filtering actually changes.
+	///
+	/// @param tex - Texture to modify.
+	/// @param minFilter - GL_TEXTURE_MIN_FILTER value.
+	/// @param magFilter - GL_TEXTURE_MAG_FILTER value.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetTextureFilter(JTexture *tex, GLint minFilter, GLint magFilter);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set filtering of a texture to linear or nearest, minifying through
+	/// the mipmaps of textures having them (JTexture::mMipmapped).
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetTextureFilter(JTexture *tex, bool linear);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set wrapping of a texture. The texture is bound to the active unit
+	/// only if its wrapping actually changes.
+	///
+	/// @param tex - Texture to modify.
+	/// @param wrapS - GL_TEXTURE_WRAP_S value.
+	/// @param wrapT - GL_TEXTURE_WRAP_T value.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetTextureWrap(JTexture *tex, GLint wrapS, GLint wrapT);
+
+	void BlendFunc(GLenum src, GLenum dest);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Bind a buffer. The GL_ELEMENT_ARRAY_BUFFER binding belongs to the
+	/// bound vertex array, so it is forgotten whenever the VAO changes.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void BindBuffer(GLenum target, GLuint buffer);
+
+	void BindVertexArray(GLuint vao);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Delete GL objects, dropping them from the cached bindings.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void DeleteTexture(GLuint texture);
+	void DeleteProgram(GLuint program);
+	void DeleteBuffer(GLuint buffer);
+	void DeleteVertexArray(GLuint vao);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Forget everything known about the GL state. The next call of each
+	/// kind is always issued.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Invalidate();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Number of GL calls issued or skipped since the last ResetCounters().
+	///
+	/// @param call - One of STATE_CALL_xxx.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetIssuedCount(int call) const { return mIssued[call]; }
+	int GetSkippedCount(int call) const { return mSkipped[call]; }
+	int GetTotalIssuedCount() const;
+	int GetTotalSkippedCount() const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Account for work done outside of the state calls, read back into
+	/// JRenderStats by the renderer.
+	///
+	/// @param vertices - Vertices or indices drawn, times instances.
+	/// @param bytes - Bytes of vertex, index or texture data uploaded.
+	/// @param reason - One of BATCH_BREAK_xxx.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void CountDraw(int vertices) { mDrawCalls++; mVertices += vertices; }
+	void CountUpload(int bytes) { mUploadBytes += bytes; }
+	void CountBatchBreak(int reason) { mBatchBreaks[reason]++; }
+	void CountCulled() { mCulledQuads++; }
+
+	int GetDrawCount() const { return mDrawCalls; }
+	int GetVertexCount() const { return mVertices; }
+	int GetUploadBytes() const { return mUploadBytes; }
+	int GetBatchBreakCount(int reason) const { return mBatchBreaks[reason]; }
+	int GetCulledCount() const { return mCulledQuads; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Time the CPU spends issuing GL calls. Calls may nest, only the
+	/// outermost pair is timed.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void BeginSubmit();
+	void EndSubmit();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get milliseconds spent between BeginSubmit() and EndSubmit().
+	///
+	//////////////////////////////////////////////////////////////////////////
+	float GetSubmitTime() const { return mSubmitTime; }
+
+	void ResetCounters();
+
+protected:
+	JRenderState();
+	~JRenderState();
+
+private:
+	static JRenderState* mInstance;
+
+	GLuint mProgram;
+	GLenum mActiveTexture;
+	GLuint mTextures[RENDER_STATE_TEXTURE_UNITS];
+	GLenum mBlendSrc;
+	GLenum mBlendDest;
+	GLuint mArrayBuffer;
+	GLuint mElementBuffer;
+	GLuint mVertexArray;
+
+	int mIssued[STATE_CALL_COUNT];
+	int mSkipped[STATE_CALL_COUNT];
+
+	int mDrawCalls;
+	int mVertices;
+	int mUploadBytes;
+	int mBatchBreaks[BATCH_BREAK_COUNT];
+	int mCulledQuads;
+
+	int mSubmitDepth;
+	std::chrono::steady_clock::time_point mSubmitStart;
+	float mSubmitTime;
+
+	// Count the call and tell if it has to be issued.
+	inline bool Changed(int call, bool changed)
+	{
+		if (changed)
+			mIssued[call]++;
+		else
+			mSkipped[call]++;
+		return changed;
+	}
+};
+
+#endif
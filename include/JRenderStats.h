@@ -0,0 +1,48 @@
+#ifndef _JRENDERSTATS_H_
+#define _JRENDERSTATS_H_
+
+// Frames kept by JRenderer for GetFrameStats().
+#define RENDER_STATS_HISTORY		120
+
+//////////////////////////////////////////////////////////////////////////
+/// Reasons for a sprite or primitive batch to be drawn before the next
+/// one can start.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	BATCH_BREAK_TEXTURE,		///< Sprite with a different texture.
+	BATCH_BREAK_FILTER,			///< Sprite with a different texture filter.
+	BATCH_BREAK_MODE,			///< Primitive of a different GL mode.
+	BATCH_BREAK_LINE_WIDTH,		///< Lines of a different width.
+	BATCH_BREAK_FULL,			///< Batch reached its maximum size.
+	BATCH_BREAK_BACKEND,		///< Switch between batched and instanced sprites.
+	BATCH_BREAK_BATCHER,		///< Switch between sprites and primitives.
+	BATCH_BREAK_BLEND,			///< Blending changed.
+	BATCH_BREAK_FLUSH,			///< FlushBatch(), end of the scene included.
+	BATCH_BREAK_COUNT
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// What a frame cost, gathered between JRenderer::BeginScene() and
+/// JRenderer::EndScene().
+///
+//////////////////////////////////////////////////////////////////////////
+struct JRenderStats
+{
+	unsigned int frame;			// number of the frame, from 0
+	int drawCalls;
+	int vertices;				// vertices or indices submitted, times instances
+	int uploadBytes;			// vertex, index and texture data sent to GL
+	int textureBinds;
+	int programSwitches;
+	int stateChanges;			// state calls issued, binds and switches included
+	int redundantStateChanges;	// state calls dropped by JRenderState
+	int batchBreaks[BATCH_BREAK_COUNT];
+	int culledQuads;			// quads skipped for being outside of the view
+	float submitTime;			// CPU milliseconds spent issuing GL calls
+	float frameTime;			// CPU milliseconds from BeginScene to EndScene
+	float gpuTime;				// GPU milliseconds, negative while unknown
+};
+
+#endif
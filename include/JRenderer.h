@@ -7,17 +7,31 @@
 #include <stdarg.h>
 #include <array>
 
-#include <vitaGL.h>
+#include "JGL.h"
 
 #include "JTypes.h"
 #include "Vector2D.h"
 #include "JSpriteRenderer.h"
+#include "JPrimitiveBatcher.h"
+#include "JStreamBuffer.h"
+#include "JRenderQueue.h"
+#include "JTriangulator.h"
+#include "JStroker.h"
+#include "JRenderStats.h"
+#include "JStaticMesh.h"
 #include "earcut.hpp" // https://github.com/mapbox/earcut.hpp
 #include <vector>
+#include <map>
+#include <chrono>
 
 #define SINF(x)		sinf(x*DEG2RAD)
 #define COSF(x)		cosf(x*DEG2RAD)
 
+// Largest distance in pixels between a circle and its polygon.
+#define CIRCLE_TOLERANCE		0.25f
+#define CIRCLE_MIN_SEGMENTS		8
+#define CIRCLE_MAX_SEGMENTS		180
+
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -55,6 +69,13 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void EnableTextureFilter(bool flag);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Get filter quads are drawn with, TEX_FILTER_NONE until
+	/// EnableTextureFilter is called.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetTextureFilter() const { return mCurrentTextureFilter; }
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Create texture from memory on the fly.
 	/// 
@@ -64,6 +85,46 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	JTexture* CreateTexture(int width, int height);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Create texture that can be drawn into, see BeginRenderTarget.
+	/// 
+	/// @param width - Width of texture.
+	/// @param height - Height of texture.
+	/// 
+	/// @return Texture backed by a framebuffer object, NULL if GL could not
+	///			create one.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JTexture* CreateRenderTarget(int width, int height);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw into a render target instead of the screen until
+	/// EndRenderTarget. Coordinates are pixels of the target with the
+	/// origin at its top-left, as on the screen, so drawing code works for
+	/// both. Calls nest.
+	///
+	/// The target is left upright: a JQuad over the whole texture shows it
+	/// as it was drawn.
+	/// 
+	/// @param target - Texture from CreateRenderTarget.
+	/// @param clear - true to clear the target to transparent black first.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void BeginRenderTarget(JTexture *target, bool clear = true);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw everything pending into the current render target and return
+	/// to the previous one, or to the screen.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void EndRenderTarget();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get render target drawn into, NULL for the screen.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JTexture* GetRenderTarget() const { return mRenderTargets.empty() ? NULL : mRenderTargets.back(); }
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Clear entire screen to a particular color.
 	/// 
@@ -115,6 +176,9 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void SetTexBlendDest(int dest);
 
+	int GetTexBlendSrc() const { return mCurrTexBlendSrc; }
+	int GetTexBlendDest() const { return mCurrTexBlendDest; }
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Enable rendering in 2D mode.
 	/// 
@@ -135,7 +199,179 @@ public:
 	///
 	//////////////////////////////////////////////////////////////////////////
 	void RenderQuad(JQuad* quad, float xo, float yo, float angle=0.0f, float xScale=1.0f, float yScale=1.0f);
-	void RenderQuadBatch(JQuad* quad, float xo, float yo, float angle=0.0f, float xScale=1.0f, float yScale=1.0f);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Render quads transformed beforehand, such as the glyphs of a text
+	/// run, with the current blending and texture filter. They always go
+	/// through the batched sprite path, so a run of one texture takes a
+	/// single draw call whatever the sprite backend. The run is culled as a
+	/// whole.
+	///
+	/// @param texture - Texture of all the quads.
+	/// @param vertices - 4 vertices per quad, see JSpriteRenderer::BuildQuad.
+	/// @param quadCount - Number of quads.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void RenderQuads(JTexture *texture, const JSpriteVertex *vertices, int quadCount);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Skip quads lying completely outside of the view in RenderQuad, before
+	/// anything is uploaded or queued. Enabled by default.
+	///
+	/// @param flag - true to enable, false to submit every quad.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void EnableCulling(bool flag) { mCullingEnabled = flag; }
+	bool IsCullingEnabled() const { return mCullingEnabled; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get size of the area drawn to: the screen in its 480x272 coordinates,
+	/// or the current render target.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	float GetViewWidth() const { return mViewWidth; }
+	float GetViewHeight() const { return mViewHeight; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Enable batched submission of quads. When enabled RenderQuad only
+	/// collects transformed vertices; they are drawn together when the
+	/// texture, filter or blending changes, when the batch is full, before
+	/// any other primitive is drawn and at the end of the scene.
+	///
+	/// @param flag - true to enable (default), false to draw every quad
+	///				  with its own draw call.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void EnableSpriteBatching(bool flag);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Select how RenderQuad submits quads to GL.
+	///
+	/// @par Backends:
+	///
+	/// @code
+	///
+	///		SPRITE_BACKEND_IMMEDIATE
+	///		SPRITE_BACKEND_BATCHED (default)
+	///		SPRITE_BACKEND_INSTANCED (GLES3/WebGL2 only)
+	///
+	/// @endcode
+	///
+	/// @param backend - Backend to use.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetSpriteBackend(int backend);
+	int GetSpriteBackend() const { return mSpriteBackend; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw all the quads and primitives collected so far. Needed only before
+	/// issuing GL calls directly, the renderer flushes by itself otherwise.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void FlushBatch();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get statistics of a finished frame. The renderer keeps the last
+	/// RENDER_STATS_HISTORY frames, counted from BeginScene to EndScene.
+	///
+	/// GPU time is measured only in builds defining JGE_GPU_TIMER, on GL
+	/// with EXT_disjoint_timer_query. It arrives a few frames late, read
+	/// it from older frames; it stays negative until then.
+	///
+	/// @par Example: Logging the average draw calls of the last second:
+	/// @code
+	/// JRenderer *r = JRenderer::GetInstance();
+	/// int count = std::min(r->GetFrameStatsCount(), 60);
+	/// int drawCalls = 0;
+	/// for (int i = 0; i < count; i++)
+	///		drawCalls += r->GetFrameStats(i)->drawCalls;
+	/// if (count > 0)
+	///		printf("draw calls: %d\n", drawCalls / count);
+	/// @endcode
+	///
+	/// @param framesAgo - 0 for the last finished frame, up to
+	///						GetFrameStatsCount()-1.
+	///
+	/// @return Statistics of the frame, NULL if not kept.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	const JRenderStats* GetFrameStats(int framesAgo = 0) const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of frames GetFrameStats() can return.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetFrameStatsCount() const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of scenes ended so far.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	unsigned int GetFrameCount() const { return mFrameCount; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get time spent loading, compiling and linking the shaders of the
+	/// renderer at startup, in milliseconds. See
+	/// JResourceManager::SetShaderCacheDir.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	float GetShaderLoadTime() const { return mShaderLoadTime; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Defer drawing to the render queue. When enabled RenderQuad, the
+	/// polygon and line functions and therefore JLBFont only record
+	/// commands. They are sorted by layer, shader, blending, texture and
+	/// depth and drawn by EndScene, or earlier by FlushBatch or ClearScreen.
+	/// Blending and texture filter are recorded with each command.
+	/// Queued quads are always drawn through the batched sprite backend.
+	///
+	/// @param flag - true to enable, false to draw in submission order (default).
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void EnableRenderQueue(bool flag);
+	bool IsRenderQueueEnabled() const { return mRenderQueueEnabled; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set layer of everything drawn from now on while the render queue is
+	/// enabled. Lower layers are drawn first.
+	///
+	/// @param layer - 0 to RENDER_QUEUE_LAYERS-1.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetRenderLayer(int layer);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set depth of everything drawn from now on while the render queue is
+	/// enabled. Lower depths are drawn first inside a layer.
+	///
+	/// @param depth - Signed 24 bit depth.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetRenderDepth(int depth);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Keep the submission order of a layer, for alpha blended geometry
+	/// that depends on it. Commands of a stable layer are only sorted by
+	/// depth.
+	///
+	/// @param layer - Layer to change.
+	/// @param stable - true to keep submission order.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetLayerStable(int layer, bool stable);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Take over commands recorded into a queue by another thread. Must be
+	/// called on the GL thread once the recording thread is done with the
+	/// queue. With the render queue enabled the commands are sorted with
+	/// everything else at the end of the scene, otherwise they are sorted
+	/// and drawn right away. Stable layers are taken from the recording
+	/// queue, see JRenderQueue::SetLayerStable.
+	///
+	/// @param queue - Recorded queue, cleared for reuse.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void MergeRenderQueue(JRenderQueue &queue);
 
 	//////////////////////////////////////////////////////////////////////////
 	/// Draw polygon.
@@ -214,6 +450,47 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void DrawLine(float x1, float y1, float x2, float y2, float lineWidth, PIXEL_TYPE color);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw a thick polyline as a single triangle strip, without gaps at
+	/// the joints.
+	///
+	/// @param x - Array of X positions.
+	/// @param y - Array of Y positions.
+	/// @param count - Number of points.
+	/// @param width - Line width.
+	/// @param color - Draw colour.
+	/// @param join - LINE_JOIN_MITER, LINE_JOIN_BEVEL or LINE_JOIN_ROUND.
+	/// @param cap - LINE_CAP_BUTT, LINE_CAP_SQUARE or LINE_CAP_ROUND.
+	/// @param closed - true to connect the last point to the first.
+	/// 
+	//////////////////////////////////////////////////////////////////////////
+	void DrawPolyline(const float* x, const float* y, int count, float width, PIXEL_TYPE color,
+					  int join = LINE_JOIN_MITER, int cap = LINE_CAP_BUTT, bool closed = false);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw a path stroked in advance, for paths that do not change.
+	///
+	/// @param path - Stroked path.
+	/// @param color - Draw colour.
+	/// 
+	//////////////////////////////////////////////////////////////////////////
+	void DrawStrokedPath(const JStrokedPath &path, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw a static mesh, building it first if needed. Everything drawn
+	/// before is flushed so the mesh keeps its place in the drawing order.
+	///
+	/// @param mesh - Mesh to draw.
+	/// @param x - Horizontal offset.
+	/// @param y - Vertical offset.
+	/// @param angle - Rotation around the origin of the mesh (radian).
+	/// @param xScale - Horizontal scale.
+	/// @param yScale - Vertical scale.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void RenderStaticMesh(JStaticMesh *mesh, float x = 0.0f, float y = 0.0f, float angle = 0.0f,
+						  float xScale = 1.0f, float yScale = 1.0f);
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Draw polygon with filled colour.
 	/// 
@@ -226,6 +503,27 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void FillPolygon(float* x, float* y, int count, PIXEL_TYPE color, bool convex = true);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw polygon with holes with filled colour. The triangulation is
+	/// cached, drawing the same shape again costs no triangulation.
+	/// 
+	/// @param x - X positions of all rings, one after the other.
+	/// @param y - Y positions of all rings, one after the other.
+	/// @param ringCounts - Vertex count of each ring. The first ring is the
+	///						outline, the others are holes.
+	/// @param ringCount - Number of rings.
+	/// @param color - Filling colour.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void FillPolygon(const float* x, const float* y, const int* ringCounts, int ringCount, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get triangulator of concave polygons, to read the hit and miss
+	/// counts of its cache.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JTriangulator* GetTriangulator() { return &mTriangulator; }
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Draw solid symmetric polygon with certain number of sides.
 	/// 
@@ -239,6 +537,15 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void FillPolygon(float x, float y, float size, int count, float startingAngle, PIXEL_TYPE color);
 
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of segments a circle is drawn with. Grows with the radius
+	/// so that the outline stays within CIRCLE_TOLERANCE of the circle.
+	/// 
+	/// @param radius - Radius in pixels.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static int GetCircleSegments(float radius);
+
 	//////////////////////////////////////////////////////////////////////////
 	/// Draw circle.
 	/// 
@@ -261,43 +568,116 @@ public:
 	//////////////////////////////////////////////////////////////////////////
 	void FillCircle(float x, float y, float radius, PIXEL_TYPE color);
 
-	// void AddSprite(JSprite &sprite) {
-    //     mSpriteRenderer->AddSprite(sprite); // 调用 AddSprite 添加精灵
-    // }
-
-    // void Flush() {
-    //     mSpriteRenderer->Flush(); // 调用 Flush 执行渲染操作
-    // }
-
-	// void Clear() {
-    //     mSpriteRenderer->Clear(); // 调用 Flush 执行渲染操作
-    // }
-	// void AddToBatch(JSprite &sprite) {
-	// 	mSpriteRenderer->AddToBatch(sprite);
-	// }
-
-	// void Flush() {
-	// 	mSpriteRenderer->FlushBatch();
-	// }
-
 private:
 
 	static JRenderer* mInstance;
 
 	JSpriteRenderer *mSpriteRenderer;
+	int mSpriteBackend;
+
+	JPrimitiveBatcher *mPrimitiveBatcher;
+
+	// transient geometry of both the sprite and the primitive path
+	JStreamBuffer *mVertexStream;
+	JStreamBuffer *mIndexStream;
 
 	int mCurrentTextureFilter;
 
 	int mCurrTexBlendSrc;
 	int mCurrTexBlendDest;
 
-	GLuint mVBO;
-	GLint colorUniformLoc; // location of color uniform on shader
-	int bufferSize;
-	int elementBufferSize;
+	// blending set in GL, differs from the current one while recording to the queue
+	int mAppliedTexBlendSrc;
+	int mAppliedTexBlendDest;
+
+	JRenderQueue *mRenderQueue;
+	bool mRenderQueueEnabled;
+
+	JTriangulator mTriangulator;
+
+	// targets of nested BeginRenderTarget calls, the screen when empty
+	std::vector<JTexture*> mRenderTargets;
+
+	// screen viewport, projection and size when the first target was begun, restored by the last EndRenderTarget
+	GLint mScreenViewport[4];
+	glm::mat4 mScreenProjection;
+	float mScreenViewWidth;
+	float mScreenViewHeight;
+
+	// projection of the screen or the current render target, and its size
+	glm::mat4 mProjection;
+	float mViewWidth;
+	float mViewHeight;
+
+	bool mCullingEnabled;
+
+	// shaders drawing with mProjection, resolved once by InitRenderer
+	enum
+	{
+		PROJECTED_SPRITE,
+		PROJECTED_SIMPLE,
+		PROJECTED_PRIMITIVE,
+		PROJECTED_SPRITE_BATCH,
+		PROJECTED_SPRITE_INSTANCED,
+		PROJECTED_SHADERS
+	};
+	int mProjectedShaders[PROJECTED_SHADERS];
+	JUniform<glm::mat4> mProjectionUniforms[PROJECTED_SHADERS];
+
+	// Set the projection uniform of one of the PROJECTED_* shaders.
+	void SetShaderProjection(int shader, const glm::mat4 &projection);
+
+	// Bind the framebuffer of a target, or the screen, and fit the viewport and projection to it.
+	void BindRenderTarget(JTexture *target);
+
+	// statistics of the last frames, by frame number modulo the history
+	JRenderStats mFrameStats[RENDER_STATS_HISTORY];
+	unsigned int mFrameCount;
+	std::chrono::steady_clock::time_point mFrameStart;
+	float mShaderLoadTime;
+
+#ifdef JGE_GPU_TIMER
+	// one timer query per frame in flight, results read once available
+	enum { GPU_TIMER_QUERIES = 4 };
+	bool mGpuTimerSupported;
+	GLuint mGpuQueries[GPU_TIMER_QUERIES];
+	unsigned int mGpuQueryFrames[GPU_TIMER_QUERIES];
+	bool mGpuQueryPending[GPU_TIMER_QUERIES];
+	bool mGpuQueryActive;
+
+	void ReadGpuTimers();
+#endif
+
+	// cos/sin of the vertices of a unit regular polygon, with the index
+	// lists drawing it filled and outlined
+	struct UnitShape
+	{
+		std::vector<float> cosSin;
+		std::vector<GLushort> fillIndices;
+		std::vector<GLushort> outlineIndices;
+	};
+	std::map<int, UnitShape> mUnitShapes;
+
+	const UnitShape& GetUnitShape(int count);
+
+	// Flush the other batch so that sprites and primitives keep their submission order.
+	void BeginSprites();
+	void BeginPrimitives();
+
+	// Draw a primitive through the render queue or the primitive batcher, in pieces when larger than a batch.
+	void SubmitPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color, float lineWidth);
+	void SubmitSplitPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color, float lineWidth);
+
+	// Draw a triangle strip of any length.
+	void DrawStrip(const float *x, const float *y, int count, PIXEL_TYPE color);
+
+	// Draw an indexed list through the render queue or the primitive batcher, in pieces when larger than a batch.
+	void DrawIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount);
+	void DrawSplitIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount);
 
-	void InitVBO();
-	std::vector<JSprite> mSpriteBatch;
+	void FlushBatchers(int reason);
+	void ApplyTexBlend(int src, int dest);
+	void SubmitRenderQueue();
 };
 
 
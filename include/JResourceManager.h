@@ -3,24 +3,108 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "JShader.h"
 #include "JTypes.h"
-#include <vitaGL.h>
+#include "JBakedAtlas.h"
+#include "JGL.h"
+
+
+// Flags of JResourceManager::LoadTextureFromFile.
+enum
+{
+	TEX_LOAD_TRIM = 1,		// store only the part of a png inside its fully transparent borders
+	TEX_LOAD_POT = 2		// pad pngs to powers of two even when the GPU takes other sizes
+};
+
+// Textures loaded from files since the last JResourceManager::ResetTextureStats(). Memory counts the levels uploaded:
+// the base level of pngs and expanded files, every level of compressed ones.
+struct JTextureStats
+{
+	int textures;
+	int compressedTextures;		// kept block compressed on the GPU
+	int decodedTextures;		// compressed files expanded to RGBA8, the GPU lacking their format
+	long memory;
+	long memorySaved;			// against RGBA8 padded to powers of two, see JTexture::mMemorySaved
+};
+
+// A texture of the JResourceManager cache, see JResourceManager::GetTextureUsage.
+struct JTextureUsage
+{
+	std::string name;			// normalised path
+	int flags;
+	int references;
+	JTexture *texture;
+	int memory;					// JTexture::mMemory, 0 while loading
+	int memorySaved;
+};
 
 
 class JResourceManager
 {
+	friend class JTextureLoader;
+
 public:
-	static JTexture* LoadTextureFromFile(const char* filename);
+	// Loads a png, or a ktx file of block compressed levels (see JTextureDecoder for the formats). Compressed textures
+	// the GPU cannot sample are expanded to RGBA8 on the CPU. Pngs keep their size when the GPU takes sizes other than
+	// powers of two. Flags are TEX_LOAD_ values.
+	static JTexture* LoadTextureFromFile(const char* filename, int flags = 0);
+
+	// Loads the first of name.bc.ktx, name.etc2.ktx and name.etc1.ktx in a format the GPU takes. Expands the first one
+	// found when none is, and loads name.png when there are none.
+	static JTexture* LoadCompressedTexture(const char* name);
+
+	// Whether the GPU samples a compressed format, GL_COMPRESSED_RGB8_ETC2 for instance.
+	static bool IsCompressedFormatSupported(GLenum format);
+
+	// Whether the GPU takes textures of any size with repeating and mipmaps, as GLES3 and WebGL2 do.
+	static bool IsNPOTSupported();
+
+	// Loads a texture once for all its users: the same file, after normalising its path, with the same flags comes
+	// from the cache. Each call is paired with a ReleaseTexture, the last one frees the texture. Async queues the file
+	// in JTextureLoader, the texture showing its placeholder until loaded. Returns NULL on failure.
+	static JTexture* AcquireTexture(const char* filename, int flags = 0, bool async = false);
+
+	// Drops a reference taken by AcquireTexture. Textures not in the cache are left alone.
+	static void ReleaseTexture(JTexture *tex);
+
+	// Textures in the cache, by name, with their references and memory.
+	static void GetTextureUsage(std::vector<JTextureUsage> &usage);
+
+	// Memory of the textures in the cache, the sum of their JTexture::mMemory.
+	static long GetCachedTextureMemory();
+
+	// Key of the texture cache: backslashes turned to slashes, repeated slashes, "." and "dir/.." removed.
+	static std::string NormalizePath(const std::string &path);
+
+	static const JTextureStats& GetTextureStats() { return TextureStats; }
+	static void ResetTextureStats();
+
+	// Decodes an image file without creating a texture. Pixels are RGBA8, rows are pitch pixels apart. Free with delete [].
+	static u8* LoadImageBits(const char* filename, int &width, int &height, int &pitch);
+
+	// Loads an atlas baked by tools/atlasbaker, its index with a single read and its pages through AcquireTexture.
+	// Returns NULL on failure.
+	static JBakedAtlas* LoadAtlas(const char* filename);
 
 	// Loads (and generates) a shader program from file loading vertex, fragment shader's source code.
-	static JShader LoadShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name);
+	static JShader& LoadShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name);
 	
-	// Retrieves a stored sader
-	static JShader GetShader(std::string name);
+	// Retrieves a stored sader, an empty one if there is none of that name. References are valid until the next LoadShader.
+	static JShader& GetShader(const std::string &name);
+
+	// Retrieves a stored shader by its interned id, without any string lookup. To be used on hot paths.
+	static JShader& GetShader(int id) { return Shaders[id]; }
+
+	// Id of a stored shader, -1 if there is none of that name. Ids stay the same when a shader is loaded again.
+	static int GetShaderId(const std::string &name);
+
+	// Folder, ending with a slash, where LoadShader keeps program binaries to skip compiling on later runs. Empty (the default)
+	// compiles every time. Set before the renderer is created, for instance to "ux0:data/mygame/". See JShader::LoadBinary.
+	static void SetShaderCacheDir(const std::string &dir) { ShaderCacheDir = dir; }
 
-	// Properly de-allocates all loaded resources
+	// Properly de-allocates all loaded resources, cached textures included
 	static void Clear();
 
 private:
@@ -31,18 +115,75 @@ private:
 		int mHeight;
 		int mTexWidth;
 		int mTexHeight;
+		int mTrimX;			// part of the image in mBits, all of it unless trimmed
+		int mTrimY;
+		int mTrimWidth;
+		int mTrimHeight;
+	};
+
+	struct CompressedInfo
+	{
+		GLenum mFormat;
+		int mWidth;
+		int mHeight;
+		std::vector<const u8*> mLevels;		// into the file data
+		std::vector<int> mLevelSizes;
 	};
 
-	// Resource storage
-	static std::map<std::string, JShader>    Shaders;
+	// A texture read and decoded, ready for upload
+	struct TextureData
+	{
+		TextureInfo mImage;						// mBits NULL when compressed
+		CompressedInfo mCompressed;
+		std::vector<unsigned char> mFile;		// kept for the compressed levels
+		bool mIsCompressed;
+		bool mIsDecoded;						// expanded from a format the GPU lacks
+
+		TextureData() : mIsCompressed(false), mIsDecoded(false) { mImage.mBits = NULL; }
+		~TextureData() { delete [] mImage.mBits; }
+	};
+
+	// Texture of the cache, keyed by normalised path and flags
+	struct CachedTexture
+	{
+		JTexture *mTexture;
+		int mReferences;
+	};
+	typedef std::pair<std::string, int> TextureKey;
+
+	// Resource storage, shaders indexed by id
+	static std::vector<JShader>              Shaders;
+	static std::map<std::string, int>        ShaderIds;
+	static std::map<TextureKey, CachedTexture> Textures;
+	static std::map<JTexture*, TextureKey>   TextureKeys;
+	static std::string                       ShaderCacheDir;
+	static JTextureStats                     TextureStats;
+	static std::vector<GLint>                CompressedFormats;
+	static bool                              CompressedFormatsQueried;
+	static int                               NPOTSupport;
 
 	// Private constructor, that is we do not want any actual resource manager objects. Its members and functions should be publicly available (static).
 	JResourceManager() { }
 
-	static bool LoadPNG(TextureInfo &textureInfo, const char *filename);
+	static bool LoadPNG(TextureInfo &textureInfo, const std::vector<unsigned char> &file, bool powerOfTwo);
+	static void TrimImage(TextureInfo &textureInfo, bool powerOfTwo);
+	static bool ParseKTX(const std::vector<unsigned char> &data, CompressedInfo &info);
+
+	// Reads and decodes a texture file. Safe on loader threads once IsNPOTSupported and IsCompressedFormatSupported
+	// were asked on the GL thread.
+	static bool ReadTexture(const char *filename, int flags, TextureData &data);
+
+	// Creates or fills a texture object, on the GL thread
+	static JTexture* CreateTexture(const TextureData &data, const char *filename);
+	static void UploadTexture(JTexture *tex, const TextureData &data);
 
 	// Loads and generates a shader from file
 	static JShader LoadShaderFromFile(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile = nullptr);
+
+	// Program binary cache: files are named after a hash of the sources and of the GL driver strings
+	static std::string GetProgramCacheFile(const std::string &vertexCode, const std::string &fragmentCode);
+	static bool LoadProgramBinary(JShader &shader, const std::string &file);
+	static void SaveProgramBinary(const JShader &shader, const std::string &file);
 };
 
 #endif
\ No newline at end of file
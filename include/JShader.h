@@ -2,25 +2,80 @@
 #define SHADER_H
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
-#include <vitaGL.h>
+#include "JGL.h"
+
+// GL type of the values each kind of uniform handle takes
+template <typename T> struct JUniformType;
+template <> struct JUniformType<GLfloat> { static const GLenum Type = GL_FLOAT; };
+template <> struct JUniformType<GLint> { static const GLenum Type = GL_INT; };	// samplers and bools too
+template <> struct JUniformType<glm::vec2> { static const GLenum Type = GL_FLOAT_VEC2; };
+template <> struct JUniformType<glm::vec3> { static const GLenum Type = GL_FLOAT_VEC3; };
+template <> struct JUniformType<glm::vec4> { static const GLenum Type = GL_FLOAT_VEC4; };
+template <> struct JUniformType<glm::ivec2> { static const GLenum Type = GL_INT_VEC2; };
+template <> struct JUniformType<glm::mat4> { static const GLenum Type = GL_FLOAT_MAT4; };
+
+// Location of a uniform, looked up once and typed by the value it takes.
+// Setting an invalid handle does nothing, as with GL.
+template <typename T>
+struct JUniform
+{
+	GLint Location;
+	JUniform() : Location(-1) { }
+	explicit JUniform(GLint location) : Location(location) { }
+	bool IsValid() const { return Location >= 0; }
+};
+
+// Active uniform or attribute of a linked program
+struct JShaderVariable
+{
+	std::string Name;		// without the [0] of arrays
+	GLenum Type;
+	GLint Size;				// array length, 1 otherwise
+	GLint Location;
+};
 
 class JShader
 {
 public:
 	// The program ID
 	GLuint Program;
-	JShader() { }
+	// Index in JResourceManager, -1 for shaders not loaded through it
+	int Id;
+	// Active uniforms and attributes, listed when linking
+	std::vector<JShaderVariable> Uniforms;
+	std::vector<JShaderVariable> Attributes;
+	JShader() : Program(0), Id(-1) { }
 	// Sets the current JShader as active
 	JShader &Use();
 	// Compiles the shader from given source code
 	void Compile(const GLchar *vertexSource, const GLchar *fragmentSource);
-	// Utility functions
+	// Links the program from a binary given by GetBinary, false if GL rejects it.
+	// Program binaries are only used in builds defining JGE_PROGRAM_CACHE.
+	bool LoadBinary(GLenum format, const void *binary, GLsizei length);
+	// Gets the binary of the linked program, false if GL cannot give one
+	bool GetBinary(GLenum &format, std::vector<unsigned char> &binary) const;
+	// Looks up an active uniform, to be done once after loading. The handle
+	// is invalid if the uniform is missing or does not take values of type T.
+	template <typename T>
+	JUniform<T> GetUniform(const GLchar *name) const { return JUniform<T>(FindUniform(name, JUniformType<T>::Type)); }
+	// Location of an active attribute, -1 if missing
+	GLint GetAttribute(const GLchar *name) const;
+	// Fast setters, through handles
+	void Set(const JUniform<GLfloat> &uniform, GLfloat value, GLboolean useShader = false);
+	void Set(const JUniform<GLint> &uniform, GLint value, GLboolean useShader = false);
+	void Set(const JUniform<glm::vec2> &uniform, const glm::vec2 &value, GLboolean useShader = false);
+	void Set(const JUniform<glm::vec3> &uniform, const glm::vec3 &value, GLboolean useShader = false);
+	void Set(const JUniform<glm::vec4> &uniform, const glm::vec4 &value, GLboolean useShader = false);
+	void Set(const JUniform<glm::ivec2> &uniform, const glm::ivec2 &value, GLboolean useShader = false);
+	void Set(const JUniform<glm::mat4> &uniform, const glm::mat4 &matrix, GLboolean useShader = false);
+	// Utility functions, looking the uniform up by name on every call
 	void SetFloat(const GLchar *name, GLfloat value, GLboolean useShader = false);
 	void SetInteger(const GLchar *name, GLint value, GLboolean useShader = false);
 	void SetVector2f(const GLchar *name, GLfloat x, GLfloat y, GLboolean useShader = false);
@@ -33,6 +88,9 @@ public:
 private:
 	// Checks if compilation or linking failed and if so, print the error logs
 	void checkCompileErrors(GLuint object, std::string type);
+	// Lists the active uniforms and attributes of the linked program
+	void introspect();
+	GLint FindUniform(const GLchar *name, GLenum type) const;
 };
 
 
@@ -0,0 +1,70 @@
+#ifndef _JSKYLINEPACKER_H_
+#define _JSKYLINEPACKER_H_
+
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+/// Rectangle packer using the skyline bottom-left heuristic.
+///
+/// The top edge of the packed area is kept as a list of horizontal
+/// segments and every rectangle is placed where its top ends up lowest.
+/// Does not depend on GL, so offline tools can use it as well.
+///
+//////////////////////////////////////////////////////////////////////////
+class JSkylinePacker
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	///
+	/// @param width - Width of the area to pack into.
+	/// @param height - Height of the area to pack into.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JSkylinePacker(int width, int height);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Find room for a rectangle and mark it as used.
+	///
+	/// @param width - Width of the rectangle.
+	/// @param height - Height of the rectangle.
+	/// @param x - Receives left position of the rectangle.
+	/// @param y - Receives top position of the rectangle.
+	///
+	/// @return false if the rectangle does not fit anymore.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	bool Insert(int width, int height, int &x, int &y);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Forget all the rectangles packed so far.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Reset();
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get fraction of the area covered by rectangles, from 0 to 1.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	float GetOccupancy() const;
+
+private:
+	struct Segment
+	{
+		int x, y;
+		int width;
+	};
+
+	int mWidth;
+	int mHeight;
+	long mUsedArea;
+	std::vector<Segment> mSkyline;
+
+	int Fit(int index, int width, int height) const;
+	void AddSegment(int index, int x, int y, int width, int height);
+};
+
+#endif
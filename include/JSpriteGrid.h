@@ -0,0 +1,112 @@
+#ifndef _JSPRITEGRID_H_
+#define _JSPRITEGRID_H_
+
+#include <vector>
+
+#include "JTypes.h"
+
+#define SPRITE_GRID_CELL_SIZE		128.0f
+
+//////////////////////////////////////////////////////////////////////////
+/// Uniform grid of long-lived sprites, such as the tiles of a map. Only
+/// the cells under the view are walked when rendering, so the cost
+/// depends on what is visible rather than on the size of the map.
+///
+/// Sprites are drawn in the order they were added. Sprites lying outside
+/// of the grid area are kept in its border cells.
+///
+/// @par Example: A scrolling tile map:
+/// @code
+/// mMap = new JSpriteGrid(mapWidth * 16.0f, mapHeight * 16.0f);
+/// for (int y = 0; y < mapHeight; y++)
+///		for (int x = 0; x < mapWidth; x++)
+///			mMap->Add(mTiles[map[y][x]], x * 16.0f, y * 16.0f);
+/// ...
+/// mMap->Render(mCameraX, mCameraY);
+/// @endcode
+///
+//////////////////////////////////////////////////////////////////////////
+class JSpriteGrid
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	///
+	/// @param width - Width of the area covered by the grid.
+	/// @param height - Height of the area covered by the grid.
+	/// @param cellSize - Width and height of a cell. A few times the size
+	///					  of a typical sprite works well.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JSpriteGrid(float width, float height, float cellSize = SPRITE_GRID_CELL_SIZE);
+	~JSpriteGrid();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a sprite, parameters as in JRenderer::RenderQuad. Its bounds are
+	/// taken from the quad now; call Move after changing the hot spot or
+	/// size of the quad.
+	///
+	/// @return Handle of the sprite.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int Add(JQuad *quad, float x, float y, float angle = 0.0f, float xScale = 1.0f, float yScale = 1.0f);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Move a sprite.
+	///
+	/// @param sprite - Handle returned by Add.
+	/// @param x - New x position.
+	/// @param y - New y position.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Move(int sprite, float x, float y);
+
+	void Remove(int sprite);
+	void Clear();
+
+	int GetCount() const { return mCount; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw the sprites in view.
+	///
+	/// @param viewX - Position of the grid drawn at the left of the view.
+	/// @param viewY - Position of the grid drawn at the top of the view.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Render(float viewX, float viewY);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of sprites found in the cells walked by the last Render,
+	/// those outside of the view included.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetVisitedCount() const { return (int)mVisible.size(); }
+
+private:
+	struct Entry
+	{
+		JQuad *quad;		// NULL once removed
+		float x, y;
+		float angle;
+		float xScale, yScale;
+		int cells[4];		// first and last cell column and row
+	};
+
+	float mCellSize;
+	int mCellsX, mCellsY;
+	std::vector<std::vector<int> > mCells;
+
+	std::vector<Entry> mEntries;
+	int mCount;
+
+	// Render marks the sprites it met, to draw those in several cells once
+	std::vector<unsigned int> mMarks;
+	unsigned int mMark;
+	std::vector<int> mVisible;
+
+	void GetCellRange(float left, float top, float right, float bottom, int *cells) const;
+	void Insert(int sprite);
+	void Erase(int sprite);
+};
+
+#endif
@@ -6,8 +6,28 @@
 
 #include "JShader.h"
 #include "JTypes.h"
+#include "JStreamBuffer.h"
+#include "JRenderState.h"
 #include <vector>
 
+// Max number of quads collected before the batch is forced out.
+// 4 vertices per quad must stay addressable with 16 bit indices.
+#define SPRITE_BATCH_MAX_QUADS	2048
+
+#define SPRITE_BATCH_ATTRIBUTES		3
+#define SPRITE_INSTANCE_ATTRIBUTES	5
+
+//////////////////////////////////////////////////////////////////////////
+/// Ways of submitting sprites to GL.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	SPRITE_BACKEND_IMMEDIATE,	///< One draw call and uniform upload per sprite.
+	SPRITE_BACKEND_BATCHED,		///< CPU transformed vertices, one draw per batch.
+	SPRITE_BACKEND_INSTANCED	///< Unit quad drawn instanced, 48 bytes per sprite.
+};
+
 class JSprite{
 public:
 	JTexture *texture;
@@ -22,25 +42,121 @@ public:
 	int textureFilter = TEX_FILTER_NONE;
 };
 
+//------------------------------------------------------------------------------------------------
+struct JSpriteVertex
+{
+	GLfloat x, y;		// screen position
+	GLfloat u, v;		// normalized texture coordinates
+	GLuint color;		// RGBA8, red in the lowest byte
+};
+
+//------------------------------------------------------------------------------------------------
+struct JSpriteInstance
+{
+	GLfloat model[4];		// 2x2 transform of the unit quad, column major
+	GLfloat translation[2];	// position of the unit quad origin
+	GLfloat spriteRect[4];	// source rectangle in texels
+	GLubyte color[4];		// RGBA8
+	GLubyte flipped[2];		// horizontal, vertical
+	GLubyte padding[2];
+};
+
 class JSpriteRenderer
 {
 public:
-	JSpriteRenderer(JShader &shader);
+	JSpriteRenderer(JShader &shader, JShader &batchShader, JShader &instancedShader, JStreamBuffer *vertexStream);
 	~JSpriteRenderer();
 	void DrawSprite(JSprite &sprite);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Transform a sprite on the CPU and append it to the current batch.
+	/// The batch is flushed first if the texture or filter differs from
+	/// the one being collected, or if the batch is full.
+	///
+	/// @param sprite - Sprite to add.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddSprite(JSprite &sprite);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Append an already transformed quad to the current batch.
+	///
+	/// @param tex - Texture of the quad.
+	/// @param textureFilter - Filter to sample the texture with.
+	/// @param vertices - 4 vertices, clockwise starting from top-left.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddQuad(JTexture *tex, int textureFilter, const JSpriteVertex *vertices);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Append a sprite to the current instanced batch. Only the per-instance
+	/// attributes are computed on the CPU, the unit quad set up in
+	/// initRenderData is expanded by sprite_instanced.vert.
+	///
+	/// @param sprite - Sprite to add.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddSpriteInstance(JSprite &sprite);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw everything collected so far with a single draw call.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Flush();
+
+	bool HasPendingSprites() const { return mQuadCount > 0 || !mInstances.empty(); }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Compute the 4 screen space vertices of a sprite. Does not touch GL,
+	/// so it is also used to record quads for later submission.
+	///
+	/// @param sprite - Sprite to transform.
+	/// @param vertices - Receives 4 vertices, clockwise from top-left.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static void BuildQuad(const JSprite &sprite, JSpriteVertex *vertices);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Compute the screen space bounding box of a sprite, rotation and
+	/// scaling included.
+	///
+	/// @param sprite - Sprite to measure.
+	/// @param bounds - Receives left, top, right and bottom.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static void GetBounds(const JSprite &sprite, float *bounds);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Fill a sprite with a quad drawn at the given position, as done by
+	/// JRenderer::RenderQuad. The texture filter is left untouched. Quads
+	/// of trimmed textures are cut to the part of the image stored.
+	///
+	/// @param quad - Quad to draw.
+	/// @param xo - x position.
+	/// @param yo - y position.
+	/// @param angle - Rotation in radians.
+	/// @param xScale - Horizontal scaling.
+	/// @param yScale - Vertical scaling.
+	/// @param sprite - Receives the sprite.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static void SetSprite(const JQuad *quad, float xo, float yo, float angle, float xScale, float yScale, JSprite &sprite);
+
 private:
+	JRenderState *mRenderState;
+
 	JShader shader;
 	//GLuint quadVAO;
 	GLuint VAO, VBO, EBO;
 	void initRenderData();
-
-	std::vector<JSprite> mSpriteBatch;
+	void initBatchData();
+	void initInstanceData();
 
 	//////////////////////////////////////////////////////////////////////////
 	/// Bind texture to be used for the rendering followed.
-	/// 
+	///
 	/// @param tex - Texture to use.
-	/// 
+	///
 	//////////////////////////////////////////////////////////////////////////
 	void BindTexture(JTexture *tex, int textureFilter);
 
@@ -49,4 +165,23 @@ private:
 	GLint textureSizeLocation;
 	GLint colorLocation;
 	GLint flippedLocation;
-};
\ No newline at end of file
+
+	// batching
+	JStreamBuffer *vertexStream;
+	JShader batchShader;
+	GLuint batchVAO, batchEBO;
+	GLint batchLocations[SPRITE_BATCH_ATTRIBUTES];
+
+	std::vector<JSpriteVertex> mVertices;
+	int mQuadCount;
+	JTexture *mBatchTexture;
+	int mBatchFilter;
+
+	// instancing
+	JShader instancedShader;
+	GLuint instanceVAO;
+	GLint instanceLocations[SPRITE_INSTANCE_ATTRIBUTES];
+	GLint instanceTextureSizeLocation;
+
+	std::vector<JSpriteInstance> mInstances;
+};
@@ -0,0 +1,157 @@
+#ifndef _JSTATICMESH_H_
+#define _JSTATICMESH_H_
+
+#include <vector>
+
+#include "JTypes.h"
+#include "JShader.h"
+#include "JSpriteRenderer.h"
+#include "JPrimitiveBatcher.h"
+
+class JStrokedPath;
+
+// Vertices a mesh can hold, must stay addressable with 16 bit indices.
+#define STATIC_MESH_MAX_VERTICES	65536
+
+//////////////////////////////////////////////////////////////////////////
+/// Shapes that never change, uploaded once into static vertex and index
+/// buffers and drawn with JRenderer::RenderStaticMesh.
+///
+/// Polygons, lines and quads are added in drawing order, then Build()
+/// uploads them. Consecutive shapes of the same kind share a draw call:
+/// a mesh of only polygons, or of quads from one texture, draws with a
+/// single call whatever its size.
+///
+/// @par Example: Baking the decoration of a level:
+/// @code
+/// mDecoration = new JStaticMesh();
+/// mDecoration->AddPolygon(hillX, hillY, hillCount, ARGB(255,40,120,40));
+/// for (int i = 0; i < treeCount; i++)
+///		mDecoration->AddQuad(mTreeQuad, trees[i].x, trees[i].y);
+/// mDecoration->Build();
+/// ...
+/// JRenderer::GetInstance()->RenderStaticMesh(mDecoration, -mScrollX, 0.0f);
+/// @endcode
+///
+//////////////////////////////////////////////////////////////////////////
+class JStaticMesh
+{
+public:
+	JStaticMesh();
+	~JStaticMesh();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a filled polygon, convex or not.
+	///
+	/// @param x - X positions of the vertices.
+	/// @param y - Y positions of the vertices.
+	/// @param count - Number of vertices.
+	/// @param color - Filling colour.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddPolygon(const float *x, const float *y, int count, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a filled polygon with holes, parameters as in
+	/// JRenderer::FillPolygon.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddPolygon(const float *x, const float *y, const int *ringCounts, int ringCount, PIXEL_TYPE color);
+
+	void AddRect(float x, float y, float width, float height, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a line drawn by GL, see JStrokedPath for wide lines.
+	///
+	/// @param width - Line width, lines of different widths do not share
+	///				   a draw call.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddLine(float x1, float y1, float x2, float y2, PIXEL_TYPE color, float width = 1.0f);
+
+	void AddStrokedPath(const JStrokedPath &path, PIXEL_TYPE color);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add a textured quad, parameters as in JRenderer::RenderQuad. Uses the
+	/// color, flipping and hot spot of the quad and the texture filter of
+	/// the renderer at the time of the call.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddQuad(JQuad *quad, float xo, float yo, float angle = 0.0f, float xScale = 1.0f, float yScale = 1.0f);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add an indexed list of colored vertices.
+	///
+	/// @param mode - GL_TRIANGLES or GL_LINES.
+	/// @param vertices - Vertices.
+	/// @param vertexCount - Number of vertices.
+	/// @param indices - Indices into the vertices.
+	/// @param indexCount - Number of indices.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Upload the shapes and free the copy kept in memory. Shapes added
+	/// afterwards are ignored until Clear(). Called by the first draw if
+	/// needed.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Build();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Remove all shapes and release the buffers.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Clear();
+
+	bool IsBuilt() const { return mBuilt; }
+	int GetVertexCount() const { return mVertexCount; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of draw calls the mesh takes.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetDrawCount() const { return (int)mSections.size(); }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Draw with the projection currently set in the shaders, use
+	/// JRenderer::RenderStaticMesh instead.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Draw();
+
+private:
+	// indices drawn with the same state
+	struct Section
+	{
+		GLenum mode;
+		JTexture *texture;		// NULL for colored shapes
+		int textureFilter;
+		float lineWidth;
+		int first;
+		int count;
+	};
+
+	JShader mColorShader;
+	JShader mTextureShader;
+
+	std::vector<JSpriteVertex> mVertices;
+	std::vector<GLushort> mIndices;
+	std::vector<Section> mSections;
+	int mVertexCount;
+	bool mBuilt;
+
+	GLuint mVertexBuffer;
+	GLuint mIndexBuffer;
+	GLuint mColorVAO;
+	GLuint mTextureVAO;
+
+	// Start a shape, -1 if the mesh is full or built.
+	int Reserve(GLenum mode, JTexture *texture, int textureFilter, float lineWidth, int vertexCount, int indexCount);
+
+	void AddColorVertex(float x, float y, GLuint color);
+	GLuint CreateVertexArray(JShader &shader, bool textured);
+};
+
+#endif
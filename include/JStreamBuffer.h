@@ -0,0 +1,67 @@
+#ifndef _JSTREAMBUFFER_H_
+#define _JSTREAMBUFFER_H_
+
+#include "JTypes.h"
+
+// Number of frames the GPU may still be reading from before a region is reused.
+#define STREAM_BUFFER_FRAMES	3
+
+//////////////////////////////////////////////////////////////////////////
+/// Ring buffer for transient vertex and index data.
+///
+/// The GL buffer is split into STREAM_BUFFER_FRAMES regions, one per frame
+/// in flight. Allocations are carved out of the current region with
+/// glBufferSubData and the renderer moves to the next region with
+/// NextFrame(), so data still referenced by earlier frames is never
+/// overwritten. When a frame needs more room than its region has, the
+/// storage is orphaned and re-created twice as large.
+///
+//////////////////////////////////////////////////////////////////////////
+class JStreamBuffer
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	///
+	/// @param target - GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+	/// @param frameSize - Initial size in bytes of the region of each frame.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JStreamBuffer(GLenum target, int frameSize);
+	~JStreamBuffer();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Copy data into the buffer. The buffer is left bound to its target,
+	/// bind the VAO first when uploading indices.
+	///
+	/// @param data - Data to copy.
+	/// @param size - Size of data in bytes.
+	///
+	/// @return Byte offset of the data inside the buffer.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	GLintptr Upload(const void *data, int size);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Move to the region of the next frame. To be called once per frame
+	/// after the last draw using the buffer.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void NextFrame();
+
+	GLuint GetBuffer() const { return mBuffer; }
+	GLenum GetTarget() const { return mTarget; }
+	int GetFrameSize() const { return mFrameSize; }
+
+private:
+	GLenum mTarget;
+	GLuint mBuffer;
+
+	int mFrameSize;		// bytes in the region of each frame
+	int mFrame;			// region written this frame
+	int mOffset;		// next free byte in the current region
+
+	void Grow(int size);
+};
+
+#endif
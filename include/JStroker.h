@@ -0,0 +1,84 @@
+#ifndef _JSTROKER_H_
+#define _JSTROKER_H_
+
+#include <vector>
+
+// Largest distance in pixels between a round join or cap and its polygon.
+#define STROKE_TOLERANCE		0.25f
+#define STROKE_MITER_LIMIT		4.0f
+
+//////////////////////////////////////////////////////////////////////////
+/// How segments of a stroked path meet.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	LINE_JOIN_MITER,	///< Sharp corner, bevelled past the miter limit.
+	LINE_JOIN_BEVEL,	///< Corner cut straight.
+	LINE_JOIN_ROUND		///< Corner rounded with the half width as radius.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// How the ends of an open stroked path look.
+///
+//////////////////////////////////////////////////////////////////////////
+enum
+{
+	LINE_CAP_BUTT,		///< Ends exactly at the end points.
+	LINE_CAP_SQUARE,	///< Extends by half the width.
+	LINE_CAP_ROUND		///< Half circle around the end points.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Turns a polyline into the outline of a thick line, as a single
+/// triangle strip. Joins and caps are part of the strip, so a whole path
+/// goes out without gaps in one primitive. Does not depend on GL.
+///
+//////////////////////////////////////////////////////////////////////////
+class JStroker
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Stroke a path.
+	///
+	/// @param x - X positions of the path.
+	/// @param y - Y positions of the path.
+	/// @param count - Number of points.
+	/// @param width - Line width.
+	/// @param join - LINE_JOIN_MITER, LINE_JOIN_BEVEL or LINE_JOIN_ROUND.
+	/// @param cap - LINE_CAP_BUTT, LINE_CAP_SQUARE or LINE_CAP_ROUND.
+	/// @param closed - true to join the last point back to the first, caps
+	///					are not used then.
+	/// @param stripX - Receives X positions of the triangle strip.
+	/// @param stripY - Receives Y positions of the triangle strip.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static void Stroke(const float *x, const float *y, int count, float width, int join, int cap, bool closed,
+					   std::vector<float> &stripX, std::vector<float> &stripY);
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Stroked path kept for drawing many times, see JRenderer::DrawStrokedPath.
+/// Joins and caps are computed once in the constructor.
+///
+//////////////////////////////////////////////////////////////////////////
+class JStrokedPath
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor, parameters as in JStroker::Stroke.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JStrokedPath(const float *x, const float *y, int count, float width, int join = LINE_JOIN_MITER,
+				 int cap = LINE_CAP_BUTT, bool closed = false);
+
+	int GetVertexCount() const { return (int)mStripX.size(); }
+	const float* GetX() const { return mStripX.empty() ? 0 : &mStripX[0]; }
+	const float* GetY() const { return mStripY.empty() ? 0 : &mStripY[0]; }
+
+private:
+	std::vector<float> mStripX;
+	std::vector<float> mStripY;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef _JTEXTUREATLAS_H_
+#define _JTEXTUREATLAS_H_
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include "JTypes.h"
+#include "JSkylinePacker.h"
+
+#define TEXTURE_ATLAS_PAGE_SIZE		2048
+#define TEXTURE_ATLAS_PADDING		2
+
+//////////////////////////////////////////////////////////////////////////
+/// Packs many images into a few large textures (pages), so that sprites
+/// loaded from different files can be drawn in the same batch.
+///
+/// Every image gets a border of padding pixels filled by repeating its
+/// edge pixels, which keeps filtering from bleeding in the neighbours.
+/// The atlas keeps a copy of the source pixels to be able to repack; the
+/// JQuads it returns are owned by the atlas and updated in place when
+/// images move.
+///
+//////////////////////////////////////////////////////////////////////////
+class JTextureAtlas
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Constructor.
+	///
+	/// @param pageSize - Width and height of each page.
+	/// @param padding - Border around each image, in pixels.
+	/// @param maxPages - Pages allowed before the atlas gets repacked
+	///					  instead of growing, 0 for no limit.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JTextureAtlas(int pageSize = TEXTURE_ATLAS_PAGE_SIZE, int padding = TEXTURE_ATLAS_PADDING, int maxPages = 0);
+	~JTextureAtlas();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Load an image file and add it to the atlas.
+	///
+	/// @param filename - Image to load, also the name of the image.
+	///
+	/// @return Quad covering the image, NULL if it could not be loaded or
+	///			does not fit.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JQuad* AddFile(const char *filename);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Add an image to the atlas. Adding a name twice returns the quad of
+	/// the first image.
+	///
+	/// @param name - Name to look the image up with.
+	/// @param bits - RGBA8 pixels.
+	/// @param width - Width of the image.
+	/// @param height - Height of the image.
+	/// @param pitch - Distance between rows in pixels.
+	///
+	/// @return Quad covering the image, NULL if it does not fit.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JQuad* AddImage(const char *name, const PIXEL_TYPE *bits, int width, int height, int pitch);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get quad of an image added before.
+	///
+	/// @return NULL if there is no image of that name.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JQuad* GetQuad(const char *name) const;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Pack all images again from scratch, largest first, which usually
+	/// needs fewer pages than packing them in the order they were added.
+	/// Quads are updated in place. Pending batches are flushed first.
+	///
+	/// @return false if some images did not fit anymore (only possible
+	///			with a page limit); those keep their old quads.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	bool Repack();
+
+	int GetPageCount() const { return (int)mPages.size(); }
+	JTexture* GetPage(int index) const { return mPages[index]; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get fraction of the page area covered by images, from 0 to 1.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	float GetOccupancy() const;
+
+private:
+	struct Image
+	{
+		PIXEL_TYPE *bits;	// width*height, tightly packed
+		int width;
+		int height;
+		int page;
+		int x, y;			// top-left of the image, excluding padding
+		JQuad *quad;
+	};
+
+	int mPageSize;
+	int mPadding;
+	int mMaxPages;
+
+	std::vector<Image> mImages;
+	std::vector<JTexture*> mPages;
+	std::vector<JSkylinePacker*> mPackers;	// one per page
+	std::map<std::string, int> mImageIndex;
+
+	bool Place(std::vector<JSkylinePacker*> &packers, Image &image);
+	void SetPageCount(int count);
+	void ClearPage(int page);
+	void Upload(const Image &image);
+	void UpdateQuad(Image &image);
+};
+
+#endif
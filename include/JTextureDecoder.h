@@ -0,0 +1,93 @@
+#ifndef _JTEXTUREDECODER_H_
+#define _JTEXTUREDECODER_H_
+
+#include <stddef.h>
+
+#include "JGL.h"
+
+// Block compressed formats, values of the GL extensions and of GL ES 3.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT		0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT	0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT	0x83F2
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT	0x83F3
+#endif
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES					0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2				0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC		0x9278
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+/// CPU decoder of the block compressed texture formats JGE loads, for
+/// GPUs lacking one of them.
+///
+/// @par Formats:
+///
+/// @code
+///
+///		GL_COMPRESSED_RGB_S3TC_DXT1_EXT		BC1, 8 bytes per block
+///		GL_COMPRESSED_RGBA_S3TC_DXT1_EXT	BC1 with 1 bit alpha
+///		GL_COMPRESSED_RGBA_S3TC_DXT3_EXT	BC2, 16 bytes per block
+///		GL_COMPRESSED_RGBA_S3TC_DXT5_EXT	BC3, 16 bytes per block
+///		GL_ETC1_RGB8_OES					ETC1, 8 bytes per block
+///		GL_COMPRESSED_RGB8_ETC2				ETC2, 8 bytes per block
+///		GL_COMPRESSED_RGBA8_ETC2_EAC		ETC2 with EAC alpha, 16 bytes per block
+///
+/// @endcode
+///
+/// All of them store 4x4 pixel blocks, rows of blocks from the top.
+///
+//////////////////////////////////////////////////////////////////////////
+class JTextureDecoder
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Check if a format is one of the above.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static bool IsSupported(GLenum format);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get size of an image, in whole blocks.
+	///
+	/// @return Size in bytes, 0 for unknown formats. Computed in 64 bits,
+	///			sizes read from files do not wrap it.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static size_t GetImageSize(GLenum format, int width, int height);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Decode an image to RGBA8.
+	///
+	/// @param format - Format of the image.
+	/// @param data - Blocks of the image, GetImageSize bytes.
+	/// @param width - Width of the image.
+	/// @param height - Height of the image.
+	/// @param pixels - Receives width x height RGBA8 pixels.
+	///
+	/// @return false for unknown formats.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static bool Decode(GLenum format, const unsigned char *data, int width, int height, unsigned char *pixels);
+
+private:
+	// Each decodes one block into 4x4 RGBA8 pixels, rows of 16 bytes.
+	static void DecodeBC1(const unsigned char *block, bool alpha, bool fourColors, unsigned char *out);
+	static void DecodeBC2Alpha(const unsigned char *block, unsigned char *out);
+	static void DecodeBC3Alpha(const unsigned char *block, unsigned char *out);
+	static void DecodeETC(const unsigned char *block, bool etc2, unsigned char *out);
+	static void DecodeEACAlpha(const unsigned char *block, unsigned char *out);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef _JTEXTURELOADER_H_
+#define _JTEXTURELOADER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "JThreadPool.h"
+#include "JTypes.h"
+
+// Threads reading and decoding texture files.
+#define TEXTURE_LOADER_WORKERS			2
+
+// Default budget of Update(), per frame.
+#define TEXTURE_LOADER_UPLOAD_BYTES		(4*1024*1024)
+#define TEXTURE_LOADER_UPLOAD_TIME		2.0f
+
+//////////////////////////////////////////////////////////////////////////
+/// Loads textures in the background, for streaming levels or screens
+/// in without stalling frames.
+///
+/// LoadTexture() returns a texture at once, holding a 1x1 placeholder
+/// texel. Worker threads read and decode the file, then Update() uploads
+/// the finished textures on the GL thread, within a budget of bytes and
+/// of time per frame. JRenderer::BeginScene() calls Update().
+///
+/// Until a texture is resident its mLoading is true and its size is 1x1,
+/// quads are best made with explicit rects. Deleting a texture still
+/// loading cancels it.
+///
+/// Without thread support (emscripten built without pthreads) Update()
+/// reads the files too, within the same budget.
+///
+//////////////////////////////////////////////////////////////////////////
+class JTextureLoader
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the singleton instance.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static JTextureLoader* GetInstance();
+
+	static void Destroy();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Queue a texture file, as JResourceManager::LoadTextureFromFile
+	/// loads it.
+	///
+	/// @param filename - Name of the png or ktx file.
+	/// @param flags - TEX_LOAD_ values.
+	///
+	/// @return Texture showing the placeholder color until loaded, NULL
+	///			when no texture object could be made. A file failing to
+	///			load leaves the placeholder.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	JTexture* LoadTexture(const char *filename, int flags = 0);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Upload textures finished loading, on the GL thread. Stops once
+	/// the budget is spent, uploading at least one texture.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Update();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set budget of Update().
+	///
+	/// @param bytes - Bytes uploaded per frame, 0 for no limit.
+	/// @param milliseconds - Time spent per frame, 0 for no limit.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetUploadBudget(int bytes, float milliseconds);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Set color of the placeholder of textures queued from now on.
+	/// Transparent by default.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void SetPlaceholderColor(PIXEL_TYPE color) { mPlaceholderColor = color; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of textures not uploaded yet.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetPendingCount() const { return mPendingCount; }
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Stop loading a texture, called when it is deleted. The texture
+	/// keeps its placeholder.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Cancel(JTexture *tex);
+
+protected:
+	JTextureLoader();
+	~JTextureLoader();
+
+private:
+	struct Job;
+
+	static JTextureLoader* mInstance;
+
+	std::deque<Job*> mQueued;		// waiting for a worker
+	std::deque<Job*> mFinished;		// read, waiting for Update()
+	std::vector<Job*> mRunning;		// being read by the workers
+
+	int mPendingCount;
+	int mUploadBytes;
+	float mUploadTime;
+	PIXEL_TYPE mPlaceholderColor;
+
+	void Upload(Job *job);
+
+#ifdef JGE_THREADS
+	std::vector<std::thread> mWorkers;	// started by the first LoadTexture()
+
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	bool mQuit;
+
+	void WorkerLoop();
+#endif
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _JTHREADPOOL_H_
+#define _JTHREADPOOL_H_
+
+#include <vector>
+#include <functional>
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define JGE_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#endif
+
+// Worker threads started when the hardware concurrency cannot be queried.
+#define THREAD_POOL_DEFAULT_WORKERS	3
+
+//////////////////////////////////////////////////////////////////////////
+/// Fixed set of worker threads for splitting CPU work of a frame, like
+/// recording render commands, over the available cores.
+///
+/// Run() hands out tasks to the workers and to the calling thread and
+/// returns when all of them are done. Without thread support (emscripten
+/// built without pthreads) every task runs on the calling thread.
+///
+//////////////////////////////////////////////////////////////////////////
+class JThreadPool
+{
+public:
+	//////////////////////////////////////////////////////////////////////////
+	/// Get the singleton instance.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	static JThreadPool* GetInstance();
+
+	static void Destroy();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Run tasks in parallel and wait for them to finish. Must not be
+	/// called from inside a task.
+	///
+	/// @param taskCount - Number of tasks.
+	/// @param task - Called once per task with the task index and the index
+	///				  of the thread running it, from 0 to GetThreadCount()-1.
+	///				  The thread index can be used to pick per-thread data.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void Run(int taskCount, const std::function<void(int task, int thread)> &task);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Get number of threads running tasks, including the calling thread.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	int GetThreadCount() const { return (int)mWorkers.size() + 1; }
+
+protected:
+	JThreadPool(int workerCount);
+	~JThreadPool();
+
+private:
+	static JThreadPool* mInstance;
+
+#ifdef JGE_THREADS
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mWakeCondition;
+	std::condition_variable mDoneCondition;
+
+	const std::function<void(int, int)> *mTask;
+	int mTaskCount;
+	std::atomic<int> mNextTask;
+	int mFinishedWorkers;
+	unsigned int mGeneration;	// bumped for every Run() so workers notice new work
+	bool mQuit;
+
+	void WorkerLoop(int thread);
+	void RunTasks(int thread);
+#else
+	std::vector<int> mWorkers;
+#endif
+};
+
+#endif
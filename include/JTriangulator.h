@@ -0,0 +1,75 @@
+#ifndef _JTRIANGULATOR_H_
+#define _JTRIANGULATOR_H_
+
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+#include "JTypes.h"
+
+// Frames a cached triangulation survives without being used.
+#define TRIANGULATION_CACHE_FRAMES	120
+
+// Most vertices of a polygon, all numbered by GLushort indices.
+#define TRIANGULATOR_MAX_VERTICES	65536
+
+//////////////////////////////////////////////////////////////////////////
+/// Triangulates concave polygons with holes (ear clipping, earcut.hpp)
+/// and caches the result.
+///
+/// Results are keyed by a hash of the vertex data, so a static shape
+/// drawn every frame is only triangulated the first time. Entries not
+/// used for TRIANGULATION_CACHE_FRAMES frames are dropped by NextFrame().
+///
+//////////////////////////////////////////////////////////////////////////
+class JTriangulator
+{
+public:
+	JTriangulator();
+	~JTriangulator();
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Triangulate a polygon.
+	///
+	/// @param x - X positions of all rings, one after the other.
+	/// @param y - Y positions of all rings, one after the other.
+	/// @param ringCounts - Vertex count of each ring. The first ring is
+	///						the outline, the others are holes.
+	/// @param ringCount - Number of rings.
+	///
+	/// @return Triangle list indices into the vertices passed. Valid until
+	///			the next call. Empty above TRIANGULATOR_MAX_VERTICES.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	const std::vector<GLushort>& Triangulate(const float *x, const float *y, const int *ringCounts, int ringCount);
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Drop entries that were not used lately. To be called once per frame.
+	///
+	//////////////////////////////////////////////////////////////////////////
+	void NextFrame();
+
+	void Clear();
+
+	int GetHitCount() const { return mHits; }
+	int GetMissCount() const { return mMisses; }
+	int GetCachedCount() const { return (int)mCache.size(); }
+	void ResetCounters();
+
+private:
+	struct Entry
+	{
+		int vertexCount;		// guards against hash collisions of different sizes
+		int lastFrame;
+		std::vector<GLushort> indices;
+	};
+
+	std::map<uint64_t, Entry> mCache;
+	std::vector<GLushort> mEmpty;		// returned for polygons too large
+	int mFrame;
+
+	int mHits;
+	int mMisses;
+};
+
+#endif
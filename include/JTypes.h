@@ -28,7 +28,7 @@
 #define SCREEN_WIDTH_2			240.0f
 #define SCREEN_HEIGHT_2			136.0f
 
-#include <vitaGL.h>
+#include "JGL.h"
 
 #define GL_GLEXT_PROTOTYPES
 
@@ -56,6 +56,9 @@ typedef unsigned int DWORD;
 #define ARGB(a, r, g, b)		((a << 24) | (r << 16) | (g << 8) | b)
 #define RGBA(r, g, b, a)		((a << 24) | (b << 16) | (g << 8) | r)
 
+// Swap red and blue of an ARGB colour, giving the byte order of a GL_UNSIGNED_BYTE RGBA attribute.
+#define ARGB_TO_RGBA8(c)		(((c) & 0xFF00FF00) | (((c) >> 16) & 0xFF) | (((c) & 0xFF) << 16))
+
 enum CtrlButtons
 {
 	CTRL_SELECT     = 0x00000001,
@@ -158,6 +161,37 @@ public:
 	int mTexWidth;
 	int mTexHeight;
 	GLuint mTexId = 0;
+
+	// framebuffer object of textures made by JRenderer::CreateRenderTarget, 0 otherwise
+	GLuint mFramebufferId = 0;
+
+	// sampling parameters last set through JRenderState, 0 when unknown
+	GLint mMinFilter = 0;
+	GLint mMagFilter = 0;
+	GLint mWrapS = 0;
+	GLint mWrapT = 0;
+
+	// GL_RGBA, or the block compressed format kept on the GPU
+	GLenum mFormat = GL_RGBA;
+
+	// levels below the base loaded from file, sampled with mipmap minification filters
+	bool mMipmapped = false;
+
+	// bytes of the levels loaded from file, and bytes saved against the image in RGBA8 padded to
+	// powers of two, by compression, trimming and sizes other than powers of two
+	int mMemory = 0;
+	int mMemorySaved = 0;
+
+	// loaded with TEX_LOAD_TRIM: part of the image kept, stored from texel 0,0. Quads stay in the
+	// coordinates of the whole image, mWidth by mHeight, and are cut to that part when drawn.
+	bool mTrimmed = false;
+	int mTrimX = 0;
+	int mTrimY = 0;
+	int mTrimWidth = 0;
+	int mTrimHeight = 0;
+
+	// queued in JTextureLoader, showing its placeholder
+	bool mLoading = false;
 };
 
 
@@ -0,0 +1,8 @@
+precision mediump float;
+
+varying vec4 Color;
+
+void main()
+{
+    gl_FragColor = Color;
+}
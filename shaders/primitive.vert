@@ -0,0 +1,15 @@
+precision mediump float;
+
+attribute vec2 vertex;
+// per-vertex color, unsigned bytes normalized to [0, 1]
+attribute vec4 color;
+
+uniform mat4 projection;
+
+varying vec4 Color;
+
+void main()
+{
+    gl_Position = projection * vec4(vertex, 0.0, 1.0);
+    Color = color;
+}
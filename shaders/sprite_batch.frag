@@ -0,0 +1,11 @@
+precision mediump float;
+
+varying vec2 TexCoords;
+varying vec4 Color;
+
+uniform sampler2D image;
+
+void main()
+{
+    gl_FragColor = texture2D(image, TexCoords) * Color;
+}
@@ -0,0 +1,21 @@
+precision mediump float;
+
+// pre-transformed quad corner in screen space
+attribute vec2 vertex;
+// normalized texture coordinates of the corner
+attribute vec2 texCoord;
+// per-vertex tint, unsigned bytes normalized to [0, 1]
+attribute vec4 color;
+
+uniform mat4 projection;
+
+varying vec2 TexCoords;
+varying vec4 Color;
+
+void main()
+{
+    gl_Position = projection * vec4(vertex, 0.0, 1.0);
+
+    TexCoords = texCoord;
+    Color = color;
+}
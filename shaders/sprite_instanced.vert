@@ -0,0 +1,39 @@
+precision mediump float;
+
+// corner of the unit quad, shared by every instance
+attribute vec2 vertex;
+
+// per instance attributes (48 bytes, see JSpriteInstance)
+// 2x2 model matrix, columns in xy and zw, sprite size already applied
+attribute vec4 model;
+// screen position of the quad origin, hotspot already applied
+attribute vec2 translation;
+// [0] -> spriteSourceX
+// [1] -> spriteSourceY
+// [2] -> spriteWidth
+// [3] -> spriteHeight
+attribute vec4 spriteRect;
+attribute vec4 color;
+// 1.0 when flipped horizontally (x) or vertically (y)
+attribute vec2 flipped;
+
+// texture width and height
+uniform vec2 textureSize;
+uniform mat4 projection;
+
+varying vec2 TexCoords;
+varying vec4 Color;
+
+void main()
+{
+    vec2 position = mat2(model.xy, model.zw) * vertex + translation;
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+
+    vec2 spriteSource = spriteRect.xy;
+    vec2 spriteSize = spriteRect.zw - 1.0; // -1.0 to fix border problem
+
+    vec2 v = mix(vertex, 1.0 - vertex, flipped);
+
+    TexCoords = (v * spriteSize + spriteSource) / textureSize;
+    Color = color;
+}
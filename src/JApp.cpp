@@ -1,5 +1,6 @@
 #include "../include/JApp.h"
 #include "../include/JGE.h"
+#include "../include/JRenderer.h"
 
 
 JApp::JApp()
@@ -9,4 +10,10 @@ JApp::JApp()
 
 JApp::~JApp() 
 {
-}
\ No newline at end of file
+}
+
+
+const JRenderStats* JApp::GetRenderStats(int framesAgo) const
+{
+	return JRenderer::GetInstance()->GetFrameStats(framesAgo);
+}
@@ -0,0 +1,25 @@
+#include "../include/JBakedAtlas.h"
+#include "../include/JAtlasFormat.h"
+#include "../include/JResourceManager.h"
+
+#include <algorithm>
+
+JBakedAtlas::~JBakedAtlas()
+{
+    for (size_t i = 0; i < mQuads.size(); i++)
+        delete mQuads[i];
+
+    for (size_t i = 0; i < mPages.size(); i++)
+        JResourceManager::ReleaseTexture(mPages[i]);
+}
+
+JQuad* JBakedAtlas::GetQuad(const char *name) const
+{
+    uint32_t hash = JAtlasHash(name);
+
+    std::vector<uint32_t>::const_iterator it = std::lower_bound(mHashes.begin(), mHashes.end(), hash);
+    if (it == mHashes.end() || *it != hash)
+        return NULL;
+
+    return mQuads[it - mHashes.begin()];
+}
@@ -0,0 +1,53 @@
+#include "../include/JCachedLayer.h"
+#include "../include/JRenderer.h"
+
+#include <stddef.h>
+
+JCachedLayer::JCachedLayer(int width, int height)
+{
+    mTexture = JRenderer::GetInstance()->CreateRenderTarget(width, height);
+    mQuad = mTexture ? new JQuad(mTexture, 0.0f, 0.0f, (float)width, (float)height) : NULL;
+    mValid = false;
+}
+
+JCachedLayer::~JCachedLayer()
+{
+    delete mQuad;
+    delete mTexture;
+}
+
+bool JCachedLayer::BeginUpdate()
+{
+    if (mTexture == NULL)
+        return true;
+
+    if (mValid)
+        return false;
+
+    JRenderer::GetInstance()->BeginRenderTarget(mTexture, true);
+    return true;
+}
+
+void JCachedLayer::EndUpdate()
+{
+    if (mTexture == NULL)
+        return;
+
+    JRenderer::GetInstance()->EndRenderTarget();
+    mValid = true;
+}
+
+void JCachedLayer::Render(float x, float y)
+{
+    if (mTexture == NULL || !mValid)
+        return;
+
+    JRenderer *renderer = JRenderer::GetInstance();
+
+    int src = renderer->GetTexBlendSrc();
+    int dest = renderer->GetTexBlendDest();
+
+    renderer->SetTexBlend(BLEND_ONE, BLEND_ONE_MINUS_SRC_ALPHA);
+    renderer->RenderQuad(mQuad, x, y);
+    renderer->SetTexBlend(src, dest);
+}
@@ -91,6 +91,30 @@ int JFileSystem::GetFileSize()
 }
 
 
+bool JFileSystem::ReadWholeFile(const string &filename, vector<unsigned char> &buffer)
+{
+	// a FILE of its own instead of mFile, loader threads read at the same time
+	string path = mResourceRoot + filename;
+
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == NULL)
+	{
+		printf("could not open file %s \n", filename.c_str());
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	buffer.resize(fileSize);
+	long size = (fileSize > 0) ? (long)fread(&buffer[0], 1, fileSize, file) : 0;
+	fclose(file);
+
+	return size == fileSize;
+}
+
+
 void JFileSystem::SetResourceRoot(const string& resourceRoot)
 {
 	mResourceRoot = resourceRoot;
@@ -4,6 +4,8 @@
 #include "../include/JSoundSystem.h"
 #include "../include/Vector2D.h"
 #include "../include/JFileSystem.h"
+#include "../include/JThreadPool.h"
+#include "../include/JTextureLoader.h"
 
 using namespace std;
 
@@ -20,9 +22,11 @@ JGE::JGE()
 
 JGE::~JGE()
 {
+	JTextureLoader::Destroy();
 	JRenderer::Destroy();
 	JFileSystem::Destroy();
 	JSoundSystem::Destroy();
+	JThreadPool::Destroy();
 }
 
 
@@ -0,0 +1,1606 @@
+#ifdef JGE_HEADLESS
+
+#include "../include/JGLHeadless.h"
+#include "../include/JGLRasterizer.h"
+#include "../include/JTextureDecoder.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include <string.h>
+#include <map>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#define HEADLESS_TEXTURE_UNITS		8
+#define HEADLESS_VERTEX_ATTRIBUTES	16
+
+namespace
+{
+    struct HeadlessTexture
+    {
+        long baseBytes;     // level 0
+        long memory;        // all levels
+
+        // level 0 as RGBA8 and the sampling state, for the rasterizer
+        int width, height;
+        std::vector<unsigned char> pixels;
+        GLenum minFilter, magFilter;
+        GLenum wrapS, wrapT;
+    };
+
+    struct HeadlessAttribute
+    {
+        bool enabled;
+        GLint size;
+        GLenum type;
+        bool normalized;
+        GLsizei stride;
+        GLuint buffer;                  // 0 for client memory
+        const unsigned char *pointer;   // offset into the buffer or client memory
+        GLuint divisor;
+    };
+
+    struct HeadlessVertexArray
+    {
+        GLuint elementBuffer;
+        HeadlessAttribute attributes[HEADLESS_VERTEX_ATTRIBUTES];
+
+        HeadlessVertexArray()
+        {
+            elementBuffer = 0;
+            memset(attributes, 0, sizeof(attributes));
+        }
+    };
+
+    // The engine only links the programs of its shaders folder, they are
+    // told apart by their declarations and emulated on the CPU.
+    enum
+    {
+        PROGRAM_SIMPLE,             // simple.vert, uniform color
+        PROGRAM_PRIMITIVE,          // primitive.vert, vertex colors
+        PROGRAM_SPRITE,             // sprite.vert, one sprite from uniforms
+        PROGRAM_SPRITE_BATCH,       // sprite_batch.vert, transformed quads
+        PROGRAM_SPRITE_INSTANCED    // sprite_instanced.vert
+    };
+
+    struct HeadlessUniform
+    {
+        GLfloat values[16];
+    };
+
+    // uniform or attribute declared in the program sources
+    struct HeadlessVariable
+    {
+        std::string name;
+        GLenum type;
+    };
+
+    struct HeadlessProgram
+    {
+        std::vector<GLuint> shaders;
+        int kind;
+        std::map<std::string, GLint> attribLocations;
+        std::map<std::string, GLint> uniformLocations;
+        std::map<GLint, HeadlessUniform> uniforms;
+        std::vector<HeadlessVariable> activeAttributes;
+        std::vector<HeadlessVariable> activeUniforms;
+        std::string source;     // sources linked, also the program binary
+        bool linked;
+    };
+
+    // GL state the calls are checked against, so redundant state changes
+    // can be told apart and uploads be charged to the right object. Object
+    // contents are kept for the rasterizer.
+    struct HeadlessState
+    {
+        GLuint nextName;
+
+        GLuint program;
+        GLuint framebuffer;
+        GLuint vertexArray;
+        GLuint arrayBuffer;
+        int textureUnit;
+        GLuint textures[HEADLESS_TEXTURE_UNITS];
+        GLenum blendSrc, blendDest;
+        bool blend, depthTest, scissorTest, cullFace;
+        GLfloat lineWidth;
+        GLint viewport[4];
+        GLfloat clearColor[4];
+
+        std::map<GLuint, HeadlessTexture> textureObjects;
+        std::map<GLuint, std::vector<unsigned char> > buffers;
+        std::map<GLuint, HeadlessVertexArray> vertexArrays;     // 0 is the default one
+        std::map<GLuint, std::string> shaderSources;
+        std::map<GLuint, HeadlessProgram> programs;
+        std::map<GLuint, GLuint> framebuffers;                  // texture attached to each
+
+        // screen kept aside while the rasterizer draws into a framebuffer object
+        std::vector<unsigned char> screenPixels;
+        int screenWidth, screenHeight;
+
+        HeadlessState()
+        {
+            nextName = 1;
+            program = 0;
+            framebuffer = 0;
+            screenWidth = screenHeight = 0;
+            vertexArray = 0;
+            arrayBuffer = 0;
+            textureUnit = 0;
+            memset(textures, 0, sizeof(textures));
+            blendSrc = GL_ONE;
+            blendDest = GL_ZERO;
+            blend = depthTest = scissorTest = cullFace = false;
+            lineWidth = 1.0f;
+            memset(viewport, 0, sizeof(viewport));
+            memset(clearColor, 0, sizeof(clearColor));
+        }
+    };
+
+    HeadlessState gState;
+
+    void RecordCall(const char *name, int kind, GLenum target, GLuint object, int count, int instances, long bytes, long memory, bool redundant)
+    {
+        JGLCall call;
+        call.name = name;
+        call.kind = kind;
+        call.target = target;
+        call.object = object;
+        call.count = count;
+        call.instances = instances;
+        call.bytes = bytes;
+        call.memory = memory;
+        call.redundant = redundant;
+        JGLRecorder::GetInstance()->Record(call);
+    }
+
+    void RecordState(const char *name, GLenum target, GLuint object, bool redundant)
+    {
+        RecordCall(name, GL_CALL_STATE, target, object, 0, 0, 0, 0, redundant);
+    }
+
+    void RecordOther(const char *name, int kind, GLuint object, int count)
+    {
+        RecordCall(name, kind, 0, object, count, 0, 0, 0, false);
+    }
+
+    void RecordDraw(const char *name, GLenum mode, int count, int instances)
+    {
+        RecordCall(name, GL_CALL_DRAW, mode, gState.textures[gState.textureUnit], count, instances, 0, 0, false);
+    }
+
+    void GenNames(const char *name, GLsizei n, GLuint *names)
+    {
+        for (int i = 0; i < n; i++)
+            names[i] = gState.nextName++;
+        RecordOther(name, GL_CALL_OBJECT, n > 0 ? names[0] : 0, n);
+    }
+
+    int GetPixelBytes(GLenum format, GLenum type)
+    {
+        if (type != GL_UNSIGNED_BYTE)
+            return 2;   // packed 16 bit formats
+
+        switch (format)
+        {
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+            return 1;
+        case GL_RGB:
+            return 3;
+        default:
+            return 4;
+        }
+    }
+
+    int GetTypeBytes(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    bool* GetCapability(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_BLEND:          return &gState.blend;
+        case GL_DEPTH_TEST:     return &gState.depthTest;
+        case GL_SCISSOR_TEST:   return &gState.scissorTest;
+        case GL_CULL_FACE:      return &gState.cullFace;
+        default:                return NULL;
+        }
+    }
+
+    GLint GetLocation(std::map<std::string, GLint> &names, const GLchar *name)
+    {
+        std::map<std::string, GLint>::iterator it = names.find(name);
+        if (it != names.end())
+            return it->second;
+
+        GLint location = (GLint)names.size();
+        names[name] = location;
+        return location;
+    }
+
+    GLenum GetVariableType(const std::string &type)
+    {
+        static const struct { const char *name; GLenum type; } types[] = {
+            { "float", GL_FLOAT }, { "vec2", GL_FLOAT_VEC2 }, { "vec3", GL_FLOAT_VEC3 }, { "vec4", GL_FLOAT_VEC4 },
+            { "int", GL_INT }, { "ivec2", GL_INT_VEC2 }, { "ivec3", GL_INT_VEC3 }, { "ivec4", GL_INT_VEC4 },
+            { "bool", GL_BOOL }, { "mat2", GL_FLOAT_MAT2 }, { "mat3", GL_FLOAT_MAT3 }, { "mat4", GL_FLOAT_MAT4 },
+            { "sampler2D", GL_SAMPLER_2D }
+        };
+
+        for (int i = 0; i < (int)(sizeof(types) / sizeof(types[0])); i++)
+            if (type == types[i].name)
+                return types[i].type;
+        return GL_NONE;
+    }
+
+    // Finds the "<qualifier> <type> <name>;" declarations of a source, once
+    // each. Every declaration counts as active, nothing is optimized out.
+    void FindVariables(const std::string &source, const char *qualifier, std::map<std::string, GLint> &locations,
+                       std::vector<HeadlessVariable> &variables)
+    {
+        std::istringstream lines(source);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream words(line);
+            std::string word, type, name;
+            if (!(words >> word) || word != qualifier || !(words >> type >> name))
+                continue;
+
+            name = name.substr(0, name.find_first_of(";["));
+            bool known = false;
+            for (size_t i = 0; i < variables.size(); i++)
+                known = known || variables[i].name == name;
+            if (known || name.empty())
+                continue;
+
+            HeadlessVariable variable;
+            variable.name = name;
+            variable.type = GetVariableType(type);
+            variables.push_back(variable);
+            GetLocation(locations, name.c_str());
+        }
+    }
+
+    void GetActiveVariable(const std::vector<HeadlessVariable> &variables, GLuint index, GLsizei bufSize,
+                           GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+    {
+        std::string found = index < variables.size() ? variables[index].name : "";
+        *size = index < variables.size() ? 1 : 0;
+        *type = index < variables.size() ? variables[index].type : GL_NONE;
+
+        GLsizei count = bufSize > 0 ? std::min((GLsizei)found.size(), bufSize - 1) : 0;
+        if (bufSize > 0)
+        {
+            memcpy(name, found.c_str(), count);
+            name[count] = '\0';
+        }
+        if (length)
+            *length = count;
+    }
+
+    GLint GetMaxNameLength(const std::vector<HeadlessVariable> &variables)
+    {
+        GLint length = 0;
+        for (size_t i = 0; i < variables.size(); i++)
+            length = std::max(length, (GLint)variables[i].name.size() + 1);
+        return length;
+    }
+
+    void LinkSource(HeadlessProgram &program, const std::string &source)
+    {
+        if (source.find("attribute vec4 model") != std::string::npos)
+            program.kind = PROGRAM_SPRITE_INSTANCED;
+        else if (source.find("attribute vec2 texCoord") != std::string::npos)
+            program.kind = PROGRAM_SPRITE_BATCH;
+        else if (source.find("uniform vec4 spriteRect") != std::string::npos)
+            program.kind = PROGRAM_SPRITE;
+        else if (source.find("attribute vec4 color") != std::string::npos)
+            program.kind = PROGRAM_PRIMITIVE;
+        else
+            program.kind = PROGRAM_SIMPLE;
+
+        program.activeAttributes.clear();
+        program.activeUniforms.clear();
+        FindVariables(source, "attribute", program.attribLocations, program.activeAttributes);
+        FindVariables(source, "uniform", program.uniformLocations, program.activeUniforms);
+
+        program.source = source;
+        program.linked = true;
+    }
+
+    void WriteInfoLog(GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+    {
+        if (length)
+            *length = 0;
+        if (infoLog && bufSize > 0)
+            infoLog[0] = '\0';
+    }
+
+    HeadlessTexture* GetBoundTexture()
+    {
+        std::map<GLuint, HeadlessTexture>::iterator it = gState.textureObjects.find(gState.textures[gState.textureUnit]);
+        return it != gState.textureObjects.end() ? &it->second : NULL;
+    }
+
+    void SetUniform(GLint location, int count, const GLfloat *values)
+    {
+        if (location < 0 || gState.program == 0)
+            return;
+
+        HeadlessUniform &uniform = gState.programs[gState.program].uniforms[location];
+        memcpy(uniform.values, values, count * sizeof(GLfloat));
+    }
+
+    // Textures are read by the rasterizer until it finishes.
+    void FinishRaster()
+    {
+        JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+        if (rasterizer->IsEnabled())
+            rasterizer->Finish();
+    }
+
+    HeadlessTexture* GetAttachedTexture(GLuint framebuffer)
+    {
+        std::map<GLuint, GLuint>::iterator it = gState.framebuffers.find(framebuffer);
+        if (it == gState.framebuffers.end())
+            return NULL;
+
+        std::map<GLuint, HeadlessTexture>::iterator texture = gState.textureObjects.find(it->second);
+        return texture != gState.textureObjects.end() && !texture->second.pixels.empty() ? &texture->second : NULL;
+    }
+
+    // Copy rows in reverse order, textures start with the bottom row.
+    void FlipRows(const unsigned char *src, int width, int height, unsigned char *dst)
+    {
+        size_t pitch = (size_t)width * 4;
+        for (int y = 0; y < height; y++)
+            memcpy(dst + (height - 1 - y) * pitch, src + y * pitch, pitch);
+    }
+
+    // The rasterizer has one framebuffer. While a framebuffer object is
+    // bound it holds the attached texture, moved back by StoreFramebuffer.
+    void StoreFramebuffer()
+    {
+        JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+        if (!rasterizer->IsEnabled())
+            return;
+
+        const unsigned char *pixels = rasterizer->GetPixels();
+        if (gState.framebuffer == 0)
+        {
+            gState.screenWidth = rasterizer->GetWidth();
+            gState.screenHeight = rasterizer->GetHeight();
+            gState.screenPixels.assign(pixels, pixels + (size_t)gState.screenWidth * gState.screenHeight * 4);
+            return;
+        }
+
+        HeadlessTexture *texture = GetAttachedTexture(gState.framebuffer);
+        if (texture && texture->width == rasterizer->GetWidth() && texture->height == rasterizer->GetHeight())
+            FlipRows(pixels, texture->width, texture->height, &texture->pixels[0]);
+    }
+
+    void LoadFramebuffer()
+    {
+        JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+        if (!rasterizer->IsEnabled())
+            return;
+
+        if (gState.framebuffer == 0)
+        {
+            if (!gState.screenPixels.empty())
+                rasterizer->SetFramebuffer(gState.screenWidth, gState.screenHeight, &gState.screenPixels[0]);
+            gState.screenPixels.clear();
+            return;
+        }
+
+        HeadlessTexture *texture = GetAttachedTexture(gState.framebuffer);
+        if (texture)
+        {
+            std::vector<unsigned char> pixels(texture->pixels.size());
+            FlipRows(&texture->pixels[0], texture->width, texture->height, &pixels[0]);
+            rasterizer->SetFramebuffer(texture->width, texture->height, &pixels[0]);
+        }
+    }
+
+    // Convert rows of the given format to RGBA8.
+    void ConvertPixels(const unsigned char *src, GLenum format, int count, unsigned char *dst)
+    {
+        for (int i = 0; i < count; i++, dst += 4)
+        {
+            switch (format)
+            {
+            case GL_RGB:
+                dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;
+                src += 3;
+                break;
+            case GL_ALPHA:
+                dst[0] = dst[1] = dst[2] = 0; dst[3] = src[0];
+                src += 1;
+                break;
+            case GL_LUMINANCE:
+                dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255;
+                src += 1;
+                break;
+            default:
+                memcpy(dst, src, 4);
+                src += 4;
+                break;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // CPU emulation of the engine's programs
+
+    struct AttributeSource
+    {
+        const unsigned char *data;
+        const unsigned char *end;   // NULL for client memory
+        GLint size;
+        GLenum type;
+        bool normalized;
+        GLsizei stride;
+        GLuint divisor;
+    };
+
+    bool ResolveAttribute(HeadlessProgram &program, const char *name, AttributeSource &source)
+    {
+        GLint location = GetLocation(program.attribLocations, name);
+        if (location >= HEADLESS_VERTEX_ATTRIBUTES)
+            return false;
+
+        const HeadlessAttribute &attribute = gState.vertexArrays[gState.vertexArray].attributes[location];
+        if (!attribute.enabled)
+            return false;
+
+        source.data = attribute.pointer;
+        source.end = NULL;
+        if (attribute.buffer)
+        {
+            std::vector<unsigned char> &buffer = gState.buffers[attribute.buffer];
+            if (buffer.empty())
+                return false;
+            source.data = &buffer[0] + (size_t)attribute.pointer;
+            source.end = &buffer[0] + buffer.size();
+        }
+
+        source.size = attribute.size;
+        source.type = attribute.type;
+        source.normalized = attribute.normalized;
+        source.stride = attribute.stride ? attribute.stride : attribute.size * GetTypeBytes(attribute.type);
+        source.divisor = attribute.divisor;
+        return true;
+    }
+
+    void FetchAttribute(const AttributeSource *source, int vertex, int instance, float *out)
+    {
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        if (source == NULL)
+            return;
+
+        int index = source->divisor ? instance / source->divisor : vertex;
+        const unsigned char *p = source->data + (size_t)index * source->stride;
+        if (source->end && p + source->size * GetTypeBytes(source->type) > source->end)
+            return;
+
+        for (int i = 0; i < source->size; i++)
+        {
+            switch (source->type)
+            {
+            case GL_FLOAT:
+                memcpy(&out[i], p + i * 4, 4);
+                break;
+            case GL_UNSIGNED_BYTE:
+                out[i] = source->normalized ? p[i] / 255.0f : p[i];
+                break;
+            case GL_BYTE:
+                out[i] = source->normalized ? ((signed char)p[i]) / 127.0f : (signed char)p[i];
+                break;
+            case GL_UNSIGNED_SHORT:
+            {
+                unsigned short value;
+                memcpy(&value, p + i * 2, 2);
+                out[i] = source->normalized ? value / 65535.0f : value;
+                break;
+            }
+            case GL_SHORT:
+            {
+                short value;
+                memcpy(&value, p + i * 2, 2);
+                out[i] = source->normalized ? value / 32767.0f : value;
+                break;
+            }
+            }
+        }
+    }
+
+    const GLfloat* GetUniform(HeadlessProgram &program, const char *name)
+    {
+        static const GLfloat unset[16] = { 0 };
+
+        std::map<GLint, HeadlessUniform>::iterator it = program.uniforms.find(GetLocation(program.uniformLocations, name));
+        return it != program.uniforms.end() ? it->second.values : unset;
+    }
+
+    struct Shading
+    {
+        int kind;
+        glm::mat4 projection;
+        glm::mat4 model;
+        const GLfloat *color;
+        const GLfloat *spriteRect;
+        const GLfloat *textureSize;
+        const GLfloat *flipped;
+
+        const AttributeSource *vertex;
+        const AttributeSource *texCoord;
+        const AttributeSource *vertexColor;
+        const AttributeSource *instanceModel;
+        const AttributeSource *translation;
+        const AttributeSource *instanceRect;
+        const AttributeSource *instanceFlipped;
+
+        float viewport[4];
+        float height;
+    };
+
+    void SetTexCoords(float x, float y, const float *rect, const float *size, JRasterVertex &out)
+    {
+        // as the sprite shaders, -1.0 to fix border problem
+        out.u = size[0] != 0.0f ? (x * (rect[2] - 1.0f) + rect[0]) / size[0] : 0.0f;
+        out.v = size[1] != 0.0f ? (y * (rect[3] - 1.0f) + rect[1]) / size[1] : 0.0f;
+    }
+
+    void ShadeVertex(const Shading &shading, int index, int instance, JRasterVertex &out)
+    {
+        float vertex[4];
+        FetchAttribute(shading.vertex, index, instance, vertex);
+
+        glm::vec4 position(vertex[0], vertex[1], 0.0f, 1.0f);
+        float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        out.u = out.v = 0.0f;
+
+        switch (shading.kind)
+        {
+        case PROGRAM_SIMPLE:
+            memcpy(color, shading.color, sizeof(color));
+            break;
+        case PROGRAM_PRIMITIVE:
+            FetchAttribute(shading.vertexColor, index, instance, color);
+            break;
+        case PROGRAM_SPRITE:
+        {
+            position = shading.model * position;
+            float x = shading.flipped[0] == 1.0f ? 1.0f - vertex[0] : vertex[0];
+            float y = shading.flipped[1] == 1.0f ? 1.0f - vertex[1] : vertex[1];
+            SetTexCoords(x, y, shading.spriteRect, shading.textureSize, out);
+            memcpy(color, shading.color, sizeof(color));
+            break;
+        }
+        case PROGRAM_SPRITE_BATCH:
+        {
+            float texCoord[4];
+            FetchAttribute(shading.texCoord, index, instance, texCoord);
+            out.u = texCoord[0];
+            out.v = texCoord[1];
+            FetchAttribute(shading.vertexColor, index, instance, color);
+            break;
+        }
+        case PROGRAM_SPRITE_INSTANCED:
+        {
+            float model[4], translation[4], rect[4], flipped[4];
+            FetchAttribute(shading.instanceModel, index, instance, model);
+            FetchAttribute(shading.translation, index, instance, translation);
+            FetchAttribute(shading.instanceRect, index, instance, rect);
+            FetchAttribute(shading.instanceFlipped, index, instance, flipped);
+            FetchAttribute(shading.vertexColor, index, instance, color);
+
+            position.x = model[0] * vertex[0] + model[2] * vertex[1] + translation[0];
+            position.y = model[1] * vertex[0] + model[3] * vertex[1] + translation[1];
+
+            float x = vertex[0] + (1.0f - 2.0f * vertex[0]) * flipped[0];
+            float y = vertex[1] + (1.0f - 2.0f * vertex[1]) * flipped[1];
+            SetTexCoords(x, y, rect, shading.textureSize, out);
+            break;
+        }
+        }
+
+        glm::vec4 clip = shading.projection * position;
+        float w = clip.w != 0.0f ? clip.w : 1.0f;
+        out.x = shading.viewport[0] + (clip.x / w + 1.0f) * 0.5f * shading.viewport[2];
+        out.y = shading.height - (shading.viewport[1] + (clip.y / w + 1.0f) * 0.5f * shading.viewport[3]);
+        out.r = color[0];
+        out.g = color[1];
+        out.b = color[2];
+        out.a = color[3];
+    }
+
+    void Assemble(JGLRasterizer *rasterizer, GLenum mode, const std::vector<JRasterVertex> &vertices)
+    {
+        int count = (int)vertices.size();
+        switch (mode)
+        {
+        case GL_TRIANGLES:
+            for (int i = 2; i < count; i += 3)
+                rasterizer->AddTriangle(vertices[i - 2], vertices[i - 1], vertices[i]);
+            break;
+        case GL_TRIANGLE_STRIP:
+            for (int i = 2; i < count; i++)
+                rasterizer->AddTriangle(vertices[i - 2], vertices[i - 1], vertices[i]);
+            break;
+        case GL_TRIANGLE_FAN:
+            for (int i = 2; i < count; i++)
+                rasterizer->AddTriangle(vertices[0], vertices[i - 1], vertices[i]);
+            break;
+        case GL_LINES:
+            for (int i = 1; i < count; i += 2)
+                rasterizer->AddLine(vertices[i - 1], vertices[i], gState.lineWidth);
+            break;
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            for (int i = 1; i < count; i++)
+                rasterizer->AddLine(vertices[i - 1], vertices[i], gState.lineWidth);
+            if (mode == GL_LINE_LOOP && count > 2)
+                rasterizer->AddLine(vertices[count - 1], vertices[0], gState.lineWidth);
+            break;
+        case GL_POINTS:
+            for (int i = 0; i < count; i++)
+                rasterizer->AddPoint(vertices[i], 1.0f);
+            break;
+        }
+    }
+
+    // Run a draw through the emulated program into the rasterizer.
+    void Rasterize(GLenum mode, GLint first, GLsizei count, GLenum type, const void *indices, GLsizei instances)
+    {
+        JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+        if (!rasterizer->IsEnabled() || count <= 0)
+            return;
+
+        std::map<GLuint, HeadlessProgram>::iterator programIt = gState.programs.find(gState.program);
+        if (programIt == gState.programs.end())
+            return;
+        HeadlessProgram &program = programIt->second;
+
+        // vertex indices of the draw
+        std::vector<int> elements(count);
+        if (indices == NULL && type == GL_NONE)
+        {
+            for (int i = 0; i < count; i++)
+                elements[i] = first + i;
+        }
+        else
+        {
+            const unsigned char *data = (const unsigned char*)indices;
+            GLuint elementBuffer = gState.vertexArrays[gState.vertexArray].elementBuffer;
+            if (elementBuffer)
+            {
+                std::vector<unsigned char> &buffer = gState.buffers[elementBuffer];
+                if ((size_t)indices + (size_t)count * GetTypeBytes(type) > buffer.size())
+                    return;
+                data = &buffer[0] + (size_t)indices;
+            }
+            else if (data == NULL)
+                return;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (type == GL_UNSIGNED_BYTE)
+                    elements[i] = data[i];
+                else if (type == GL_UNSIGNED_SHORT)
+                    elements[i] = ((const unsigned short*)data)[i];
+                else
+                    elements[i] = ((const unsigned int*)data)[i];
+            }
+        }
+
+        AttributeSource sources[7];
+        const char *names[7] = { "vertex", "texCoord", "color", "model", "translation", "spriteRect", "flipped" };
+        const AttributeSource *resolved[7];
+        for (int i = 0; i < 7; i++)
+        {
+            // uniforms of the same name belong to other programs
+            bool isAttribute = i == 0
+                || (i == 1 && program.kind == PROGRAM_SPRITE_BATCH)
+                || (i == 2 && (program.kind == PROGRAM_PRIMITIVE || program.kind == PROGRAM_SPRITE_BATCH || program.kind == PROGRAM_SPRITE_INSTANCED))
+                || (i >= 3 && program.kind == PROGRAM_SPRITE_INSTANCED);
+            resolved[i] = isAttribute && ResolveAttribute(program, names[i], sources[i]) ? &sources[i] : NULL;
+        }
+
+        Shading shading;
+        shading.kind = program.kind;
+        shading.projection = glm::make_mat4(GetUniform(program, "projection"));
+        shading.model = glm::make_mat4(GetUniform(program, "model"));
+        shading.color = GetUniform(program, "color");
+        shading.spriteRect = GetUniform(program, "spriteRect");
+        shading.textureSize = GetUniform(program, "textureSize");
+        shading.flipped = GetUniform(program, "flipped");
+        shading.vertex = resolved[0];
+        shading.texCoord = resolved[1];
+        shading.vertexColor = resolved[2];
+        shading.instanceModel = resolved[3];
+        shading.translation = resolved[4];
+        shading.instanceRect = resolved[5];
+        shading.instanceFlipped = resolved[6];
+
+        if (gState.viewport[2] > 0 && gState.viewport[3] > 0)
+        {
+            for (int i = 0; i < 4; i++)
+                shading.viewport[i] = (float)gState.viewport[i];
+        }
+        else
+        {
+            shading.viewport[0] = shading.viewport[1] = 0.0f;
+            shading.viewport[2] = (float)rasterizer->GetWidth();
+            shading.viewport[3] = (float)rasterizer->GetHeight();
+        }
+        shading.height = (float)rasterizer->GetHeight();
+
+        JRasterState state;
+        memset(&state, 0, sizeof(state));
+        state.blend = gState.blend;
+        state.blendSrc = gState.blendSrc;
+        state.blendDest = gState.blendDest;
+        if (program.kind != PROGRAM_SIMPLE && program.kind != PROGRAM_PRIMITIVE)
+        {
+            int unit = (int)GetUniform(program, "image")[0];
+            if (unit < 0 || unit >= HEADLESS_TEXTURE_UNITS)
+                unit = 0;
+
+            std::map<GLuint, HeadlessTexture>::iterator it = gState.textureObjects.find(gState.textures[unit]);
+            if (it == gState.textureObjects.end() || it->second.pixels.empty())
+                return;
+
+            HeadlessTexture &texture = it->second;
+            state.texture.pixels = &texture.pixels[0];
+            state.texture.width = texture.width;
+            state.texture.height = texture.height;
+            state.texture.minFilter = texture.minFilter;
+            state.texture.magFilter = texture.magFilter;
+            state.texture.wrapS = texture.wrapS;
+            state.texture.wrapT = texture.wrapT;
+        }
+        rasterizer->BeginDraw(state);
+
+        int minIndex = elements[0], maxIndex = elements[0];
+        for (int i = 1; i < count; i++)
+        {
+            minIndex = std::min(minIndex, elements[i]);
+            maxIndex = std::max(maxIndex, elements[i]);
+        }
+
+        std::vector<JRasterVertex> shaded(maxIndex - minIndex + 1);
+        std::vector<JRasterVertex> vertices(count);
+        for (int instance = 0; instance < std::max(instances, 1); instance++)
+        {
+            for (int i = minIndex; i <= maxIndex; i++)
+                ShadeVertex(shading, i, instance, shaded[i - minIndex]);
+            for (int i = 0; i < count; i++)
+                vertices[i] = shaded[elements[i] - minIndex];
+            Assemble(rasterizer, mode, vertices);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// JGLRecorder
+
+JGLRecorder* JGLRecorder::mInstance = NULL;
+
+JGLRecorder* JGLRecorder::GetInstance()
+{
+    if (mInstance == NULL)
+        mInstance = new JGLRecorder();
+
+    return mInstance;
+}
+
+void JGLRecorder::Destroy()
+{
+    if (mInstance)
+    {
+        delete mInstance;
+        mInstance = NULL;
+    }
+}
+
+JGLRecorder::JGLRecorder()
+{
+    mMode = GL_RECORDER_COUNT;
+    mTextureMemory = 0;
+    ResetStats();
+}
+
+JGLRecorder::~JGLRecorder()
+{
+}
+
+void JGLRecorder::ResetStats()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void JGLRecorder::Record(const JGLCall &call)
+{
+    // allocations are tracked in every mode, switching modes must not
+    // leave the total off
+    mTextureMemory += call.memory;
+
+    if (mMode == GL_RECORDER_NULL)
+        return;
+
+    mStats.calls++;
+    switch (call.kind)
+    {
+    case GL_CALL_DRAW:
+        mStats.drawCalls++;
+        mStats.vertices += (long)call.count * (call.instances > 0 ? call.instances : 1);
+        break;
+    case GL_CALL_STATE:
+        mStats.stateChanges++;
+        if (call.redundant)
+            mStats.redundantStateChanges++;
+        break;
+    case GL_CALL_UNIFORM:
+        mStats.uniformUploads++;
+        break;
+    case GL_CALL_BUFFER_UPLOAD:
+        mStats.bufferUploads++;
+        mStats.bufferUploadBytes += call.bytes;
+        break;
+    case GL_CALL_TEXTURE_UPLOAD:
+        mStats.textureUploads++;
+        mStats.textureUploadBytes += call.bytes;
+        break;
+    }
+
+    if (mMode == GL_RECORDER_RECORD)
+        mLog.push_back(call);
+}
+
+void JGLRecorder::Dump(FILE *file) const
+{
+    for (int i = 0; i < (int)mLog.size(); i++)
+    {
+        const JGLCall &call = mLog[i];
+        fprintf(file, "%-24s target=0x%04X object=%u count=%d", call.name, call.target, call.object, call.count);
+        if (call.instances > 0)
+            fprintf(file, " instances=%d", call.instances);
+        if (call.bytes > 0)
+            fprintf(file, " bytes=%ld", call.bytes);
+        if (call.memory != 0)
+            fprintf(file, " memory=%+ld", call.memory);
+        if (call.redundant)
+            fprintf(file, " redundant");
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "calls %d, draws %d, vertices %ld\n", mStats.calls, mStats.drawCalls, mStats.vertices);
+    fprintf(file, "state changes %d (%d redundant), uniforms %d\n", mStats.stateChanges, mStats.redundantStateChanges, mStats.uniformUploads);
+    fprintf(file, "buffer uploads %d (%ld bytes), texture uploads %d (%ld bytes)\n", mStats.bufferUploads, mStats.bufferUploadBytes, mStats.textureUploads, mStats.textureUploadBytes);
+    fprintf(file, "texture memory %ld bytes\n", mTextureMemory);
+}
+
+//------------------------------------------------------------------------------------------------
+// state
+
+void glActiveTexture(GLenum texture)
+{
+    int unit = (int)(texture - GL_TEXTURE0);
+    if (unit < 0 || unit >= HEADLESS_TEXTURE_UNITS)
+        unit = 0;
+    RecordState("glActiveTexture", texture, 0, unit == gState.textureUnit);
+    gState.textureUnit = unit;
+}
+
+void glBindBuffer(GLenum target, GLuint buffer)
+{
+    // the element buffer binding belongs to the vertex array
+    GLuint *bound = target == GL_ELEMENT_ARRAY_BUFFER ? &gState.vertexArrays[gState.vertexArray].elementBuffer : &gState.arrayBuffer;
+    RecordState("glBindBuffer", target, buffer, *bound == buffer);
+    *bound = buffer;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    bool redundant = gState.framebuffer == framebuffer;
+    RecordState("glBindFramebuffer", target, framebuffer, redundant);
+    if (!redundant)
+    {
+        StoreFramebuffer();
+        gState.framebuffer = framebuffer;
+        LoadFramebuffer();
+    }
+}
+
+void glBindTexture(GLenum target, GLuint texture)
+{
+    GLuint &bound = gState.textures[gState.textureUnit];
+    RecordState("glBindTexture", target, texture, bound == texture);
+    bound = texture;
+}
+
+void glBindVertexArray(GLuint array)
+{
+    RecordState("glBindVertexArray", 0, array, gState.vertexArray == array);
+    gState.vertexArray = array;
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    RecordState("glBlendFunc", (sfactor << 16) | dfactor, 0, gState.blendSrc == sfactor && gState.blendDest == dfactor);
+    gState.blendSrc = sfactor;
+    gState.blendDest = dfactor;
+}
+
+void glEnable(GLenum cap)
+{
+    bool *enabled = GetCapability(cap);
+    RecordState("glEnable", cap, 0, enabled && *enabled);
+    if (enabled)
+        *enabled = true;
+}
+
+void glDisable(GLenum cap)
+{
+    bool *enabled = GetCapability(cap);
+    RecordState("glDisable", cap, 0, enabled && !*enabled);
+    if (enabled)
+        *enabled = false;
+}
+
+GLboolean glIsEnabled(GLenum cap)
+{
+    bool *enabled = GetCapability(cap);
+    return enabled && *enabled ? GL_TRUE : GL_FALSE;
+}
+
+void glLineWidth(GLfloat width)
+{
+    RecordState("glLineWidth", 0, 0, gState.lineWidth == width);
+    gState.lineWidth = width;
+}
+
+void glUseProgram(GLuint program)
+{
+    RecordState("glUseProgram", 0, program, gState.program == program);
+    gState.program = program;
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    bool redundant = gState.viewport[0] == x && gState.viewport[1] == y && gState.viewport[2] == width && gState.viewport[3] == height;
+    RecordState("glViewport", 0, 0, redundant);
+    gState.viewport[0] = x;
+    gState.viewport[1] = y;
+    gState.viewport[2] = width;
+    gState.viewport[3] = height;
+}
+
+void glTexParameteri(GLenum /*target*/, GLenum pname, GLint param)
+{
+    HeadlessTexture *texture = GetBoundTexture();
+    if (texture)
+    {
+        FinishRaster();
+        switch (pname)
+        {
+        case GL_TEXTURE_MIN_FILTER: texture->minFilter = param; break;
+        case GL_TEXTURE_MAG_FILTER: texture->magFilter = param; break;
+        case GL_TEXTURE_WRAP_S:     texture->wrapS = param; break;
+        case GL_TEXTURE_WRAP_T:     texture->wrapT = param; break;
+        }
+    }
+    RecordState("glTexParameteri", pname, gState.textures[gState.textureUnit], false);
+}
+
+void glEnableVertexAttribArray(GLuint index)
+{
+    if (index < HEADLESS_VERTEX_ATTRIBUTES)
+        gState.vertexArrays[gState.vertexArray].attributes[index].enabled = true;
+    RecordState("glEnableVertexAttribArray", 0, index, false);
+}
+
+void glVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    if (index < HEADLESS_VERTEX_ATTRIBUTES)
+        gState.vertexArrays[gState.vertexArray].attributes[index].divisor = divisor;
+    RecordState("glVertexAttribDivisor", 0, index, false);
+}
+
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+    if (index < HEADLESS_VERTEX_ATTRIBUTES)
+    {
+        HeadlessAttribute &attribute = gState.vertexArrays[gState.vertexArray].attributes[index];
+        attribute.size = size;
+        attribute.type = type;
+        attribute.normalized = normalized != GL_FALSE;
+        attribute.stride = stride;
+        attribute.buffer = gState.arrayBuffer;
+        attribute.pointer = (const unsigned char*)pointer;
+    }
+    RecordState("glVertexAttribPointer", type, index, false);
+}
+
+//------------------------------------------------------------------------------------------------
+// uniforms
+
+void glUniform1f(GLint location, GLfloat v0)
+{
+    SetUniform(location, 1, &v0);
+    RecordOther("glUniform1f", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniform1i(GLint location, GLint v0)
+{
+    GLfloat value = (GLfloat)v0;
+    SetUniform(location, 1, &value);
+    RecordOther("glUniform1i", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+    GLfloat values[2] = { v0, v1 };
+    SetUniform(location, 2, values);
+    RecordOther("glUniform2f", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniform2i(GLint location, GLint v0, GLint v1)
+{
+    GLfloat values[2] = { (GLfloat)v0, (GLfloat)v1 };
+    SetUniform(location, 2, values);
+    RecordOther("glUniform2i", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+    GLfloat values[3] = { v0, v1, v2 };
+    SetUniform(location, 3, values);
+    RecordOther("glUniform3f", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    GLfloat values[4] = { v0, v1, v2, v3 };
+    SetUniform(location, 4, values);
+    RecordOther("glUniform4f", GL_CALL_UNIFORM, gState.program, 1);
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean /*transpose*/, const GLfloat *value)
+{
+    if (count > 0)
+        SetUniform(location, 16, value);
+    RecordOther("glUniformMatrix4fv", GL_CALL_UNIFORM, gState.program, count);
+}
+
+//------------------------------------------------------------------------------------------------
+// draws
+
+void glClear(GLbitfield mask)
+{
+    JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+    if (rasterizer->IsEnabled() && (mask & GL_COLOR_BUFFER_BIT))
+        rasterizer->Clear(gState.clearColor[0], gState.clearColor[1], gState.clearColor[2], gState.clearColor[3]);
+    RecordCall("glClear", GL_CALL_OTHER, mask, 0, 0, 0, 0, 0, false);
+}
+
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
+{
+    gState.clearColor[0] = red;
+    gState.clearColor[1] = green;
+    gState.clearColor[2] = blue;
+    gState.clearColor[3] = alpha;
+    RecordState("glClearColor", 0, 0, false);
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    Rasterize(mode, first, count, GL_NONE, NULL, 0);
+    RecordDraw("glDrawArrays", mode, count, 0);
+}
+
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+    Rasterize(mode, first, count, GL_NONE, NULL, instancecount);
+    RecordDraw("glDrawArraysInstanced", mode, count, instancecount);
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    Rasterize(mode, 0, count, type, indices, 0);
+    RecordDraw("glDrawElements", mode, count, 0);
+}
+
+void glFlush(void)
+{
+    FinishRaster();
+    RecordOther("glFlush", GL_CALL_OTHER, 0, 0);
+}
+
+GLenum glGetError(void)
+{
+    return GL_NO_ERROR;
+}
+
+// ETC1 is left out so that loading it goes through the CPU decoder
+static const GLenum COMPRESSED_FORMATS[] =
+{
+    GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+    GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC
+};
+
+void glGetIntegerv(GLenum pname, GLint *data)
+{
+    switch (pname)
+    {
+    case GL_VIEWPORT:
+        for (int i = 0; i < 4; i++)
+            data[i] = gState.viewport[i];
+        break;
+    case GL_NUM_PROGRAM_BINARY_FORMATS:
+        data[0] = 1;
+        break;
+    case GL_PROGRAM_BINARY_FORMATS:
+        data[0] = GL_PROGRAM_BINARY_HEADLESS;
+        break;
+    case GL_NUM_COMPRESSED_TEXTURE_FORMATS:
+        data[0] = sizeof(COMPRESSED_FORMATS) / sizeof(COMPRESSED_FORMATS[0]);
+        break;
+    case GL_COMPRESSED_TEXTURE_FORMATS:
+        for (size_t i = 0; i < sizeof(COMPRESSED_FORMATS) / sizeof(COMPRESSED_FORMATS[0]); i++)
+            data[i] = COMPRESSED_FORMATS[i];
+        break;
+    default:
+        data[0] = 0;
+        break;
+    }
+}
+
+const GLubyte* glGetString(GLenum name)
+{
+    switch (name)
+    {
+    case GL_VENDOR:
+        return (const GLubyte*)"JGE";
+    case GL_RENDERER:
+        return (const GLubyte*)"JGLRecorder";
+    case GL_VERSION:
+        return (const GLubyte*)"OpenGL ES 3.0 headless";
+    case GL_EXTENSIONS:
+        return (const GLubyte*)"GL_EXT_texture_compression_s3tc GL_OES_texture_npot";
+    default:
+        return NULL;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+// buffers
+
+void glGenBuffers(GLsizei n, GLuint *buffers)
+{
+    GenNames("glGenBuffers", n, buffers);
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint *buffers)
+{
+    for (int i = 0; i < n; i++)
+    {
+        gState.buffers.erase(buffers[i]);
+        if (gState.arrayBuffer == buffers[i])
+            gState.arrayBuffer = 0;
+    }
+    RecordOther("glDeleteBuffers", GL_CALL_OBJECT, n > 0 ? buffers[0] : 0, n);
+}
+
+void glGenVertexArrays(GLsizei n, GLuint *arrays)
+{
+    GenNames("glGenVertexArrays", n, arrays);
+}
+
+void glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (arrays[i] == 0)
+            continue;
+        gState.vertexArrays.erase(arrays[i]);
+        if (gState.vertexArray == arrays[i])
+            gState.vertexArray = 0;
+    }
+    RecordOther("glDeleteVertexArrays", GL_CALL_OBJECT, n > 0 ? arrays[0] : 0, n);
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum /*usage*/)
+{
+    GLuint buffer = target == GL_ELEMENT_ARRAY_BUFFER ? gState.vertexArrays[gState.vertexArray].elementBuffer : gState.arrayBuffer;
+    if (buffer)
+    {
+        std::vector<unsigned char> &contents = gState.buffers[buffer];
+        contents.assign(size, 0);
+        if (data && size > 0)
+            memcpy(&contents[0], data, size);
+    }
+
+    // allocating without data uploads nothing
+    RecordCall("glBufferData", GL_CALL_BUFFER_UPLOAD, target, buffer, 0, 0, data ? (long)size : 0, 0, false);
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    GLuint buffer = target == GL_ELEMENT_ARRAY_BUFFER ? gState.vertexArrays[gState.vertexArray].elementBuffer : gState.arrayBuffer;
+    if (buffer)
+    {
+        std::vector<unsigned char> &contents = gState.buffers[buffer];
+        if (data && offset >= 0 && offset + size <= (GLsizeiptr)contents.size())
+            memcpy(&contents[offset], data, size);
+    }
+
+    RecordCall("glBufferSubData", GL_CALL_BUFFER_UPLOAD, target, buffer, 0, 0, (long)size, 0, false);
+}
+
+//------------------------------------------------------------------------------------------------
+// textures
+
+void glGenTextures(GLsizei n, GLuint *textures)
+{
+    GenNames("glGenTextures", n, textures);
+    for (int i = 0; i < n; i++)
+    {
+        HeadlessTexture &texture = gState.textureObjects[textures[i]];
+        texture.baseBytes = 0;
+        texture.memory = 0;
+        texture.width = texture.height = 0;
+        texture.minFilter = GL_NEAREST_MIPMAP_LINEAR;
+        texture.magFilter = GL_LINEAR;
+        texture.wrapS = texture.wrapT = GL_REPEAT;
+    }
+}
+
+void glDeleteTextures(GLsizei n, const GLuint *textures)
+{
+    FinishRaster();
+
+    long memory = 0;
+    for (int i = 0; i < n; i++)
+    {
+        std::map<GLuint, HeadlessTexture>::iterator it = gState.textureObjects.find(textures[i]);
+        if (it != gState.textureObjects.end())
+        {
+            memory -= it->second.memory;
+            gState.textureObjects.erase(it);
+        }
+        for (int unit = 0; unit < HEADLESS_TEXTURE_UNITS; unit++)
+            if (gState.textures[unit] == textures[i])
+                gState.textures[unit] = 0;
+    }
+    RecordCall("glDeleteTextures", GL_CALL_OBJECT, 0, n > 0 ? textures[0] : 0, n, 0, 0, memory, false);
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint /*internalformat*/, GLsizei width, GLsizei height, GLint /*border*/, GLenum format, GLenum type, const void *pixels)
+{
+    GLuint name = gState.textures[gState.textureUnit];
+    long bytes = (long)width * height * GetPixelBytes(format, type);
+
+    long memory = 0;
+    HeadlessTexture *texture = GetBoundTexture();
+    if (texture)
+    {
+        if (level == 0)
+        {
+            FinishRaster();
+
+            // redefining the base level drops the mipmaps
+            memory = bytes - texture->memory;
+            texture->baseBytes = bytes;
+            texture->memory = bytes;
+
+            texture->width = width;
+            texture->height = height;
+            texture->pixels.assign((size_t)width * height * 4, 0);
+            if (pixels && type == GL_UNSIGNED_BYTE)
+                ConvertPixels((const unsigned char*)pixels, format, width * height, &texture->pixels[0]);
+        }
+        else
+        {
+            memory = bytes;
+            texture->memory += bytes;
+        }
+    }
+
+    RecordCall("glTexImage2D", GL_CALL_TEXTURE_UPLOAD, target, name, 0, 0, pixels ? bytes : 0, memory, false);
+}
+
+void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint /*border*/, GLsizei imageSize, const void *data)
+{
+    GLuint name = gState.textures[gState.textureUnit];
+
+    long memory = 0;
+    HeadlessTexture *texture = GetBoundTexture();
+    if (texture)
+    {
+        if (level == 0)
+        {
+            FinishRaster();
+
+            memory = imageSize - texture->memory;
+            texture->baseBytes = imageSize;
+            texture->memory = imageSize;
+
+            // kept expanded for the rasterizer
+            texture->width = width;
+            texture->height = height;
+            texture->pixels.assign((size_t)width * height * 4, 0);
+            if (data)
+                JTextureDecoder::Decode(internalformat, (const unsigned char*)data, width, height, &texture->pixels[0]);
+        }
+        else
+        {
+            memory = imageSize;
+            texture->memory += imageSize;
+        }
+    }
+
+    RecordCall("glCompressedTexImage2D", GL_CALL_TEXTURE_UPLOAD, target, name, 0, 0, data ? imageSize : 0, memory, false);
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+    long bytes = (long)width * height * GetPixelBytes(format, type);
+
+    HeadlessTexture *texture = GetBoundTexture();
+    if (texture && level == 0 && pixels && type == GL_UNSIGNED_BYTE
+        && xoffset >= 0 && yoffset >= 0 && xoffset + width <= texture->width && yoffset + height <= texture->height)
+    {
+        FinishRaster();
+
+        int pitch = width * GetPixelBytes(format, type);
+        for (int y = 0; y < height; y++)
+        {
+            const unsigned char *src = (const unsigned char*)pixels + y * pitch;
+            ConvertPixels(src, format, width, &texture->pixels[((size_t)(yoffset + y) * texture->width + xoffset) * 4]);
+        }
+    }
+
+    RecordCall("glTexSubImage2D", GL_CALL_TEXTURE_UPLOAD, target, gState.textures[gState.textureUnit], 0, 0, bytes, 0, false);
+}
+
+void glGenerateMipmap(GLenum target)
+{
+    GLuint name = gState.textures[gState.textureUnit];
+
+    long memory = 0;
+    HeadlessTexture *texture = GetBoundTexture();
+    if (texture)
+    {
+        // the mip chain adds a third of the base level
+        long total = texture->baseBytes + texture->baseBytes / 3;
+        memory = total - texture->memory;
+        texture->memory = total;
+    }
+
+    RecordCall("glGenerateMipmap", GL_CALL_TEXTURE_UPLOAD, target, name, 0, 0, 0, memory, false);
+}
+
+//------------------------------------------------------------------------------------------------
+// framebuffers
+
+void glGenFramebuffers(GLsizei n, GLuint *framebuffers)
+{
+    GenNames("glGenFramebuffers", n, framebuffers);
+    for (int i = 0; i < n; i++)
+        gState.framebuffers[framebuffers[i]] = 0;
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (framebuffers[i] == gState.framebuffer)
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        gState.framebuffers.erase(framebuffers[i]);
+    }
+    RecordOther("glDeleteFramebuffers", GL_CALL_OBJECT, n > 0 ? framebuffers[0] : 0, n);
+}
+
+void glFramebufferTexture2D(GLenum /*target*/, GLenum attachment, GLenum /*textarget*/, GLuint texture, GLint /*level*/)
+{
+    if (gState.framebuffer != 0 && attachment == GL_COLOR_ATTACHMENT0)
+    {
+        StoreFramebuffer();
+        gState.framebuffers[gState.framebuffer] = texture;
+        LoadFramebuffer();
+    }
+    RecordOther("glFramebufferTexture2D", GL_CALL_OBJECT, texture, 1);
+}
+
+GLenum glCheckFramebufferStatus(GLenum /*target*/)
+{
+    RecordOther("glCheckFramebufferStatus", GL_CALL_OTHER, gState.framebuffer, 0);
+    if (gState.framebuffer == 0)
+        return GL_FRAMEBUFFER_COMPLETE;
+
+    std::map<GLuint, GLuint>::iterator it = gState.framebuffers.find(gState.framebuffer);
+    if (it == gState.framebuffers.end() || gState.textureObjects.find(it->second) == gState.textureObjects.end())
+        return GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT;
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+//------------------------------------------------------------------------------------------------
+// shaders
+
+GLuint glCreateShader(GLenum /*type*/)
+{
+    GLuint name = gState.nextName++;
+    RecordOther("glCreateShader", GL_CALL_OBJECT, name, 1);
+    return name;
+}
+
+void glDeleteShader(GLuint shader)
+{
+    gState.shaderSources.erase(shader);
+    RecordOther("glDeleteShader", GL_CALL_OBJECT, shader, 1);
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length)
+{
+    std::string &source = gState.shaderSources[shader];
+    source.clear();
+    for (int i = 0; i < count; i++)
+    {
+        if (length && length[i] >= 0)
+            source.append(string[i], length[i]);
+        else
+            source.append(string[i]);
+    }
+    RecordOther("glShaderSource", GL_CALL_OTHER, shader, count);
+}
+
+void glCompileShader(GLuint shader)
+{
+    RecordOther("glCompileShader", GL_CALL_OTHER, shader, 0);
+}
+
+void glGetShaderiv(GLuint /*shader*/, GLenum pname, GLint *params)
+{
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void glGetShaderInfoLog(GLuint /*shader*/, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+    WriteInfoLog(bufSize, length, infoLog);
+}
+
+GLuint glCreateProgram(void)
+{
+    GLuint name = gState.nextName++;
+    gState.programs[name].kind = PROGRAM_SIMPLE;
+    gState.programs[name].linked = false;
+    RecordOther("glCreateProgram", GL_CALL_OBJECT, name, 1);
+    return name;
+}
+
+void glDeleteProgram(GLuint program)
+{
+    gState.programs.erase(program);
+    if (gState.program == program)
+        gState.program = 0;
+    RecordOther("glDeleteProgram", GL_CALL_OBJECT, program, 1);
+}
+
+void glAttachShader(GLuint program, GLuint shader)
+{
+    gState.programs[program].shaders.push_back(shader);
+    RecordOther("glAttachShader", GL_CALL_OTHER, program, 1);
+}
+
+void glLinkProgram(GLuint program)
+{
+    HeadlessProgram &linked = gState.programs[program];
+
+    std::string source;
+    for (int i = 0; i < (int)linked.shaders.size(); i++)
+        source += gState.shaderSources[linked.shaders[i]];
+
+    LinkSource(linked, source);
+
+    RecordOther("glLinkProgram", GL_CALL_OTHER, program, 0);
+}
+
+void glProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length)
+{
+    HeadlessProgram &loaded = gState.programs[program];
+
+    // binaries of other GLs are rejected, as a driver does after an update
+    if (binaryFormat == GL_PROGRAM_BINARY_HEADLESS && length > 0)
+        LinkSource(loaded, std::string((const char*)binary, length));
+    else
+        loaded.linked = false;
+
+    RecordOther("glProgramBinary", GL_CALL_OTHER, program, 0);
+}
+
+void glGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary)
+{
+    const std::string &source = gState.programs[program].source;
+
+    GLsizei count = std::min((GLsizei)source.size(), bufSize);
+    memcpy(binary, source.data(), count);
+    if (length)
+        *length = count;
+    *binaryFormat = GL_PROGRAM_BINARY_HEADLESS;
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params)
+{
+    HeadlessProgram &queried = gState.programs[program];
+
+    switch (pname)
+    {
+    case GL_LINK_STATUS:
+        *params = queried.linked ? GL_TRUE : GL_FALSE;
+        break;
+    case GL_PROGRAM_BINARY_LENGTH:
+        *params = (GLint)queried.source.size();
+        break;
+    case GL_ACTIVE_ATTRIBUTES:
+        *params = (GLint)queried.activeAttributes.size();
+        break;
+    case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH:
+        *params = GetMaxNameLength(queried.activeAttributes);
+        break;
+    case GL_ACTIVE_UNIFORMS:
+        *params = (GLint)queried.activeUniforms.size();
+        break;
+    case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+        *params = GetMaxNameLength(queried.activeUniforms);
+        break;
+    default:
+        *params = 0;
+        break;
+    }
+}
+
+void glGetProgramInfoLog(GLuint /*program*/, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+    WriteInfoLog(bufSize, length, infoLog);
+}
+
+void glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+    GetActiveVariable(gState.programs[program].activeAttributes, index, bufSize, length, size, type, name);
+}
+
+void glGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+    GetActiveVariable(gState.programs[program].activeUniforms, index, bufSize, length, size, type, name);
+}
+
+GLint glGetAttribLocation(GLuint program, const GLchar *name)
+{
+    return GetLocation(gState.programs[program].attribLocations, name);
+}
+
+GLint glGetUniformLocation(GLuint program, const GLchar *name)
+{
+    return GetLocation(gState.programs[program].uniformLocations, name);
+}
+
+#endif
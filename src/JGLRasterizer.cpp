@@ -0,0 +1,618 @@
+#ifdef JGE_HEADLESS
+
+#include "../include/JGLRasterizer.h"
+#include "../include/JThreadPool.h"
+#include "../include/JTypes.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include <libpng16/png.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RASTER_NEON
+#endif
+
+//------------------------------------------------------------------------------------------------
+// 4 wide float vectors, comparisons give all bits set in the lanes passing
+
+#if defined(RASTER_SSE)
+
+typedef __m128 vfloat;
+
+static inline vfloat VSplat(float f) { return _mm_set1_ps(f); }
+static inline vfloat VSet(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline vfloat VLoad(const float *p) { return _mm_loadu_ps(p); }
+static inline void VStore(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat VMin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat VMax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat VCmpGt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline vfloat VCmpGe(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat VAnd(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline int VMask(vfloat m) { return _mm_movemask_ps(m); }
+
+#elif defined(RASTER_NEON)
+
+typedef float32x4_t vfloat;
+
+static inline vfloat VSplat(float f) { return vdupq_n_f32(f); }
+static inline vfloat VSet(float a, float b, float c, float d) { float f[4] = { a, b, c, d }; return vld1q_f32(f); }
+static inline vfloat VLoad(const float *p) { return vld1q_f32(p); }
+static inline void VStore(float *p, vfloat v) { vst1q_f32(p, v); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat VMin(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline vfloat VMax(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline vfloat VCmpGt(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+static inline vfloat VCmpGe(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+static inline vfloat VAnd(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+static inline int VMask(vfloat m)
+{
+    uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(m), 31);
+    return (int)(vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) | (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3));
+}
+
+#else
+
+struct vfloat { float f[4]; };
+
+static inline vfloat VSplat(float f) { vfloat r = { { f, f, f, f } }; return r; }
+static inline vfloat VSet(float a, float b, float c, float d) { vfloat r = { { a, b, c, d } }; return r; }
+static inline vfloat VLoad(const float *p) { vfloat r = { { p[0], p[1], p[2], p[3] } }; return r; }
+static inline void VStore(float *p, vfloat v) { for (int i = 0; i < 4; i++) p[i] = v.f[i]; }
+#define RASTER_SCALAR_OP(name, expr) static inline vfloat name(vfloat a, vfloat b) { vfloat r; for (int i = 0; i < 4; i++) r.f[i] = (expr); return r; }
+RASTER_SCALAR_OP(VAdd, a.f[i] + b.f[i])
+RASTER_SCALAR_OP(VSub, a.f[i] - b.f[i])
+RASTER_SCALAR_OP(VMul, a.f[i] * b.f[i])
+RASTER_SCALAR_OP(VMin, a.f[i] < b.f[i] ? a.f[i] : b.f[i])
+RASTER_SCALAR_OP(VMax, a.f[i] > b.f[i] ? a.f[i] : b.f[i])
+RASTER_SCALAR_OP(VCmpGt, a.f[i] > b.f[i] ? 1.0f : 0.0f)
+RASTER_SCALAR_OP(VCmpGe, a.f[i] >= b.f[i] ? 1.0f : 0.0f)
+RASTER_SCALAR_OP(VAnd, (a.f[i] != 0.0f && b.f[i] != 0.0f) ? 1.0f : 0.0f)
+#undef RASTER_SCALAR_OP
+static inline int VMask(vfloat m) { return (m.f[0] != 0.0f) | ((m.f[1] != 0.0f) << 1) | ((m.f[2] != 0.0f) << 2) | ((m.f[3] != 0.0f) << 3); }
+
+#endif
+
+//------------------------------------------------------------------------------------------------
+// sampling and blending
+
+static inline int WrapTexel(int i, int size, GLenum wrap)
+{
+    if (wrap == GL_REPEAT)
+    {
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+    if (wrap == GL_MIRRORED_REPEAT)
+    {
+        int period = size * 2;
+        i %= period;
+        if (i < 0)
+            i += period;
+        return i < size ? i : period - 1 - i;
+    }
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+static inline const unsigned char* GetTexel(const JRasterTexture &texture, int x, int y)
+{
+    x = WrapTexel(x, texture.width, texture.wrapS);
+    y = WrapTexel(y, texture.height, texture.wrapT);
+    return texture.pixels + (y * texture.width + x) * 4;
+}
+
+static inline bool IsNearest(GLenum filter)
+{
+    return filter == GL_NEAREST || filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_NEAREST_MIPMAP_LINEAR;
+}
+
+// Sample the base level, rgba receives 0 to 1.
+static void Sample(const JRasterTexture &texture, bool nearest, float u, float v, float *rgba)
+{
+    float fx = u * texture.width;
+    float fy = v * texture.height;
+
+    if (nearest)
+    {
+        const unsigned char *texel = GetTexel(texture, (int)floorf(fx), (int)floorf(fy));
+        for (int c = 0; c < 4; c++)
+            rgba[c] = texel[c] * (1.0f / 255.0f);
+        return;
+    }
+
+    fx -= 0.5f;
+    fy -= 0.5f;
+    float x0 = floorf(fx);
+    float y0 = floorf(fy);
+    float tx = fx - x0;
+    float ty = fy - y0;
+    int ix = (int)x0;
+    int iy = (int)y0;
+
+    const unsigned char *t00 = GetTexel(texture, ix, iy);
+    const unsigned char *t10 = GetTexel(texture, ix + 1, iy);
+    const unsigned char *t01 = GetTexel(texture, ix, iy + 1);
+    const unsigned char *t11 = GetTexel(texture, ix + 1, iy + 1);
+    for (int c = 0; c < 4; c++)
+    {
+        float top = t00[c] + (t10[c] - t00[c]) * tx;
+        float bottom = t01[c] + (t11[c] - t01[c]) * tx;
+        rgba[c] = (top + (bottom - top) * ty) * (1.0f / 255.0f);
+    }
+}
+
+static void BlendFactor(GLenum factor, const vfloat *src, const vfloat *dst, vfloat *out)
+{
+    vfloat one = VSplat(1.0f);
+    for (int c = 0; c < 4; c++)
+    {
+        switch (factor)
+        {
+        case GL_ZERO:                   out[c] = VSplat(0.0f); break;
+        case GL_SRC_COLOR:              out[c] = src[c]; break;
+        case GL_ONE_MINUS_SRC_COLOR:    out[c] = VSub(one, src[c]); break;
+        case GL_SRC_ALPHA:              out[c] = src[3]; break;
+        case GL_ONE_MINUS_SRC_ALPHA:    out[c] = VSub(one, src[3]); break;
+        case GL_DST_ALPHA:              out[c] = dst[3]; break;
+        case GL_ONE_MINUS_DST_ALPHA:    out[c] = VSub(one, dst[3]); break;
+        case GL_DST_COLOR:              out[c] = dst[c]; break;
+        case GL_ONE_MINUS_DST_COLOR:    out[c] = VSub(one, dst[c]); break;
+        case GL_SRC_ALPHA_SATURATE:     out[c] = c == 3 ? one : VMin(src[3], VSub(one, dst[3])); break;
+        default:                        out[c] = one; break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+JGLRasterizer* JGLRasterizer::mInstance = NULL;
+
+JGLRasterizer* JGLRasterizer::GetInstance()
+{
+    if (mInstance == NULL)
+        mInstance = new JGLRasterizer();
+
+    return mInstance;
+}
+
+void JGLRasterizer::Destroy()
+{
+    if (mInstance)
+    {
+        delete mInstance;
+        mInstance = NULL;
+    }
+}
+
+JGLRasterizer::JGLRasterizer()
+{
+    mEnabled = false;
+    mWidth = mHeight = 0;
+    mTilesX = mTilesY = 0;
+    ResetStats();
+    SetFramebufferSize(SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+JGLRasterizer::~JGLRasterizer()
+{
+}
+
+void JGLRasterizer::SetEnabled(bool enabled)
+{
+    if (!enabled)
+        Finish();
+    mEnabled = enabled;
+}
+
+void JGLRasterizer::SetFramebufferSize(int width, int height)
+{
+    Finish();
+
+    mWidth = width;
+    mHeight = height;
+    mPixels.assign((size_t)width * height * 4, 0);
+
+    mTilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    mTilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    mTiles.clear();
+    mTiles.resize(mTilesX * mTilesY);
+    mTileFragments.assign(mTilesX * mTilesY, 0);
+}
+
+void JGLRasterizer::SetFramebuffer(int width, int height, const unsigned char *pixels)
+{
+    SetFramebufferSize(width, height);
+    if (pixels)
+        memcpy(&mPixels[0], pixels, mPixels.size());
+}
+
+const unsigned char* JGLRasterizer::GetPixels()
+{
+    Finish();
+    return &mPixels[0];
+}
+
+void JGLRasterizer::Clear(float r, float g, float b, float a)
+{
+    Finish();
+
+    unsigned char color[4];
+    color[0] = (unsigned char)(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+    color[1] = (unsigned char)(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+    color[2] = (unsigned char)(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+    color[3] = (unsigned char)(std::min(std::max(a, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+    for (size_t i = 0; i < mPixels.size(); i += 4)
+        memcpy(&mPixels[i], color, 4);
+}
+
+void JGLRasterizer::BeginDraw(const JRasterState &state)
+{
+    mStates.push_back(state);
+}
+
+void JGLRasterizer::AddTriangle(const JRasterVertex &v0, const JRasterVertex &v1, const JRasterVertex &v2)
+{
+    if (mStates.empty())
+        return;
+
+    const JRasterVertex *v[3] = { &v0, &v1, &v2 };
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (!(fabsf(area) > 0.0f) || !isfinite(area))
+        return;
+
+    // no culling, turn every triangle clockwise on screen
+    if (area < 0.0f)
+    {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    Triangle tri;
+    float minX = v0.x, maxX = v0.x, minY = v0.y, maxY = v0.y;
+    for (int k = 0; k < 3; k++)
+    {
+        // edge opposite of vertex k, positive on the side of vertex k
+        const JRasterVertex *a = v[(k + 1) % 3];
+        const JRasterVertex *b = v[(k + 2) % 3];
+        float dx = b->x - a->x;
+        float dy = b->y - a->y;
+        tri.edgeA[k] = -dy;
+        tri.edgeB[k] = dx;
+        tri.edgeC[k] = dy * a->x - dx * a->y;
+        tri.topLeft[k] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+
+        minX = std::min(minX, v[k]->x);
+        maxX = std::max(maxX, v[k]->x);
+        minY = std::min(minY, v[k]->y);
+        maxY = std::max(maxY, v[k]->y);
+    }
+
+    // gradients from the differences to vertex 0, so attributes equal on
+    // all vertices come out exact
+    float x1 = v[1]->x - v[0]->x, y1 = v[1]->y - v[0]->y;
+    float x2 = v[2]->x - v[0]->x, y2 = v[2]->y - v[0]->y;
+    float attributes[3][6];
+    for (int k = 0; k < 3; k++)
+    {
+        attributes[k][0] = v[k]->u;
+        attributes[k][1] = v[k]->v;
+        attributes[k][2] = v[k]->r;
+        attributes[k][3] = v[k]->g;
+        attributes[k][4] = v[k]->b;
+        attributes[k][5] = v[k]->a;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        float a1 = attributes[1][i] - attributes[0][i];
+        float a2 = attributes[2][i] - attributes[0][i];
+        float dx = (a1 * y2 - a2 * y1) / area;
+        float dy = (a2 * x1 - a1 * x2) / area;
+
+        tri.plane[i][0] = dx;
+        tri.plane[i][1] = dy;
+        tri.plane[i][2] = attributes[0][i] - dx * v[0]->x - dy * v[0]->y;
+    }
+
+    tri.minX = std::max((int)floorf(minX), 0);
+    tri.minY = std::max((int)floorf(minY), 0);
+    tri.maxX = std::min((int)ceilf(maxX), mWidth - 1);
+    tri.maxY = std::min((int)ceilf(maxY), mHeight - 1);
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+        return;
+
+    const JRasterTexture &texture = mStates.back().texture;
+    float texelArea = fabsf(tri.plane[0][0] * tri.plane[1][1] - tri.plane[0][1] * tri.plane[1][0]) * texture.width * texture.height;
+    tri.minify = texelArea > 1.0f;
+
+    if ((int)mTriangles.size() >= RASTER_MAX_PENDING_TRIANGLES)
+        Finish();
+
+    tri.state = (int)mStates.size() - 1;
+    int index = (int)mTriangles.size();
+    mTriangles.push_back(tri);
+
+    int tileX0 = tri.minX / RASTER_TILE_SIZE;
+    int tileX1 = tri.maxX / RASTER_TILE_SIZE;
+    int tileY0 = tri.minY / RASTER_TILE_SIZE;
+    int tileY1 = tri.maxY / RASTER_TILE_SIZE;
+    for (int ty = tileY0; ty <= tileY1; ty++)
+        for (int tx = tileX0; tx <= tileX1; tx++)
+            mTiles[ty * mTilesX + tx].push_back(index);
+
+    mStats.triangles++;
+    mStats.tileTriangles += (tileX1 - tileX0 + 1) * (tileY1 - tileY0 + 1);
+}
+
+void JGLRasterizer::AddLine(const JRasterVertex &v0, const JRasterVertex &v1, float width)
+{
+    float dx = v1.x - v0.x;
+    float dy = v1.y - v0.y;
+    float length = sqrtf(dx * dx + dy * dy);
+    if (length <= 0.0f)
+        return;
+
+    float nx = -dy / length * width * 0.5f;
+    float ny = dx / length * width * 0.5f;
+
+    JRasterVertex corners[4] = { v0, v1, v1, v0 };
+    corners[0].x += nx; corners[0].y += ny;
+    corners[1].x += nx; corners[1].y += ny;
+    corners[2].x -= nx; corners[2].y -= ny;
+    corners[3].x -= nx; corners[3].y -= ny;
+
+    AddTriangle(corners[0], corners[1], corners[2]);
+    AddTriangle(corners[0], corners[2], corners[3]);
+}
+
+void JGLRasterizer::AddPoint(const JRasterVertex &v, float size)
+{
+    float half = size * 0.5f;
+
+    JRasterVertex corners[4] = { v, v, v, v };
+    corners[0].x -= half; corners[0].y -= half;
+    corners[1].x += half; corners[1].y -= half;
+    corners[2].x += half; corners[2].y += half;
+    corners[3].x -= half; corners[3].y += half;
+
+    AddTriangle(corners[0], corners[1], corners[2]);
+    AddTriangle(corners[0], corners[2], corners[3]);
+}
+
+void JGLRasterizer::Finish()
+{
+    if (mTriangles.empty())
+    {
+        if (mStates.size() > 1)
+            mStates.erase(mStates.begin(), mStates.end() - 1);
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<int> busyTiles;
+    for (int i = 0; i < (int)mTiles.size(); i++)
+        if (!mTiles[i].empty())
+            busyTiles.push_back(i);
+
+    JThreadPool::GetInstance()->Run((int)busyTiles.size(), [this, &busyTiles](int task, int /*thread*/) {
+        RasterizeTile(busyTiles[task]);
+    });
+
+    for (int i = 0; i < (int)busyTiles.size(); i++)
+    {
+        mStats.fragments += mTileFragments[busyTiles[i]];
+        mTileFragments[busyTiles[i]] = 0;
+        mTiles[busyTiles[i]].clear();
+    }
+    mTriangles.clear();
+
+    // the draw in progress keeps adding triangles with its state
+    if (mStates.size() > 1)
+        mStates.erase(mStates.begin(), mStates.end() - 1);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    mStats.rasterTime += elapsed.count();
+}
+
+void JGLRasterizer::ResetStats()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void JGLRasterizer::RasterizeTile(int tile)
+{
+    int x0 = (tile % mTilesX) * RASTER_TILE_SIZE;
+    int y0 = (tile / mTilesX) * RASTER_TILE_SIZE;
+    int x1 = std::min(x0 + RASTER_TILE_SIZE, mWidth);
+    int y1 = std::min(y0 + RASTER_TILE_SIZE, mHeight);
+
+    long fragments = 0;
+    const std::vector<int> &triangles = mTiles[tile];
+    for (int i = 0; i < (int)triangles.size(); i++)
+        RasterizeTriangle(mTriangles[triangles[i]], x0, y0, x1, y1, fragments);
+
+    mTileFragments[tile] = fragments;
+}
+
+void JGLRasterizer::RasterizeTriangle(const Triangle &tri, int x0, int y0, int x1, int y1, long &fragments)
+{
+    int startX = std::max(tri.minX, x0) & ~3;
+    int endX = std::min(tri.maxX + 1, x1);
+    int startY = std::max(tri.minY, y0);
+    int endY = std::min(tri.maxY + 1, y1);
+
+    const JRasterState &state = mStates[tri.state];
+    const JRasterTexture &texture = state.texture;
+    bool textured = texture.pixels != NULL;
+    bool nearest = IsNearest(tri.minify ? texture.minFilter : texture.magFilter);
+
+    vfloat zero = VSplat(0.0f);
+    vfloat one = VSplat(1.0f);
+    vfloat laneX = VSet(0.5f, 1.5f, 2.5f, 3.5f);
+    vfloat limitX = VSplat((float)endX);
+
+    vfloat edgeA[3], edgeB[3], edgeC[3];
+    for (int k = 0; k < 3; k++)
+    {
+        edgeA[k] = VSplat(tri.edgeA[k]);
+        edgeB[k] = VSplat(tri.edgeB[k]);
+        edgeC[k] = VSplat(tri.edgeC[k]);
+    }
+
+    vfloat plane[6][3];
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 3; j++)
+            plane[i][j] = VSplat(tri.plane[i][j]);
+
+    for (int y = startY; y < endY; y++)
+    {
+        vfloat py = VSplat(y + 0.5f);
+        unsigned char *row = &mPixels[(size_t)y * mWidth * 4];
+
+        for (int x = startX; x < endX; x += 4)
+        {
+            vfloat px = VAdd(VSplat((float)x), laneX);
+
+            vfloat inside = VCmpGt(limitX, px);
+            for (int k = 0; k < 3; k++)
+            {
+                vfloat e = VAdd(VAdd(VMul(edgeA[k], px), VMul(edgeB[k], py)), edgeC[k]);
+                inside = VAnd(inside, tri.topLeft[k] ? VCmpGe(e, zero) : VCmpGt(e, zero));
+            }
+
+            int mask = VMask(inside);
+            if (mask == 0)
+                continue;
+
+            // u, v, r, g, b, a at the 4 pixel centers
+            vfloat values[6];
+            for (int i = 0; i < 6; i++)
+                values[i] = VAdd(VAdd(VMul(plane[i][0], px), VMul(plane[i][1], py)), plane[i][2]);
+
+            vfloat src[4] = { values[2], values[3], values[4], values[5] };
+            if (textured)
+            {
+                float u[4], v[4];
+                float texel[4][4] = { { 0 } };
+                VStore(u, values[0]);
+                VStore(v, values[1]);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (!(mask & (1 << lane)))
+                        continue;
+
+                    float rgba[4];
+                    Sample(texture, nearest, u[lane], v[lane], rgba);
+                    for (int c = 0; c < 4; c++)
+                        texel[c][lane] = rgba[c];
+                }
+                for (int c = 0; c < 4; c++)
+                    src[c] = VMul(src[c], VLoad(texel[c]));
+            }
+            for (int c = 0; c < 4; c++)
+                src[c] = VMin(VMax(src[c], zero), one);
+
+            unsigned char *pixel = row + x * 4;
+            vfloat out[4];
+            if (state.blend)
+            {
+                float dstValues[4][4] = { { 0 } };
+                for (int lane = 0; lane < 4; lane++)
+                    if (mask & (1 << lane))
+                        for (int c = 0; c < 4; c++)
+                            dstValues[c][lane] = pixel[lane * 4 + c] * (1.0f / 255.0f);
+
+                vfloat dst[4], srcFactor[4], dstFactor[4];
+                for (int c = 0; c < 4; c++)
+                    dst[c] = VLoad(dstValues[c]);
+                BlendFactor(state.blendSrc, src, dst, srcFactor);
+                BlendFactor(state.blendDest, src, dst, dstFactor);
+                for (int c = 0; c < 4; c++)
+                    out[c] = VMin(VAdd(VMul(src[c], srcFactor[c]), VMul(dst[c], dstFactor[c])), one);
+            }
+            else
+            {
+                for (int c = 0; c < 4; c++)
+                    out[c] = src[c];
+            }
+
+            float result[4][4];
+            for (int c = 0; c < 4; c++)
+                VStore(result[c], VAdd(VMul(out[c], VSplat(255.0f)), VSplat(0.5f)));
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (!(mask & (1 << lane)))
+                    continue;
+                for (int c = 0; c < 4; c++)
+                    pixel[lane * 4 + c] = (unsigned char)result[c][lane];
+                fragments++;
+            }
+        }
+    }
+}
+
+bool JGLRasterizer::SavePNG(const char *filename)
+{
+    Finish();
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    image.width = mWidth;
+    image.height = mHeight;
+    image.format = PNG_FORMAT_RGBA;
+
+    return png_image_write_to_file(&image, filename, 0, &mPixels[0], mWidth * 4, NULL) != 0;
+}
+
+int JGLRasterizer::ComparePNG(const char *filename, int tolerance)
+{
+    Finish();
+
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, filename))
+        return -1;
+
+    if ((int)image.width != mWidth || (int)image.height != mHeight)
+    {
+        png_image_free(&image);
+        return -1;
+    }
+
+    image.format = PNG_FORMAT_RGBA;
+    std::vector<unsigned char> golden(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, NULL, &golden[0], mWidth * 4, NULL))
+        return -1;
+
+    int differing = 0;
+    for (size_t i = 0; i < mPixels.size(); i += 4)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            if (abs((int)mPixels[i + c] - (int)golden[i + c]) > tolerance)
+            {
+                differing++;
+                break;
+            }
+        }
+    }
+
+    return differing;
+}
+
+#endif
@@ -17,9 +17,9 @@ JLBFont::JLBFont(const char *fontname, int lineheight)
 	mRotation = mSpacing = 0.0f;
 	mTracking = 0.0f;
 	mColor = ARGB(255,255,255,255);
+	mShadowColor = ARGB(200,0,0,0);
 
 	mTexture = NULL;
-	mQuad = NULL;
 	mBase = 0;
 	
 	char filename[256];
@@ -36,15 +36,12 @@ JLBFont::JLBFont(const char *fontname, int lineheight)
 	fileSys->CloseFile();
  	
     sprintf(filename, "%s.png", fontname);
-	mTexture = JResourceManager::LoadTextureFromFile(filename);
+	// shared with other fonts of the same image
+	mTexture = JResourceManager::AcquireTexture(filename);
 
 	if (mTexture == NULL) return;
 	
 	mHeight = (float) lineheight;
-	
-	mQuad = new JQuad(mTexture, 0.0f, 0.0f, 16.0f, mHeight);
-	mShadowQuad = new JQuad(mTexture, 0.0f, 0.0f, 16.0f, mHeight);
-	SetShadowColor(ARGB(200,0,0,0));
 
 	float a, b, c;
 
@@ -73,95 +70,177 @@ JLBFont::JLBFont(const char *fontname, int lineheight)
 
 		y += cellHeight;
 	}
-      
+
+	// the glyphs of these characters sit a little lower in the font images
+	static const char lowered[] = "wzK<";
+	for (const char *p = lowered; *p; p++)
+	{
+		mYPos[*p - 32] += 0.3f;
+		mYPos[*p - 32 + 128] += 0.3f;
+	}
 }
  					    
  					    
 JLBFont::~JLBFont()
 {
-	if (mQuad)
-		delete mQuad;
-
-	if (mShadowQuad)
-		delete mShadowQuad;
-
 	if (mTexture) 
-		delete mTexture;
+		JResourceManager::ReleaseTexture(mTexture);
 	
 //	JGERelease();
 }
 
 
-void JLBFont::DrawString(const char *string, float x, float y, int align)
+bool JLBFont::RunKey::operator<(const RunKey &other) const
 {
-	char *p = (char*)string;
-	float dx = x, dy = y;
+	if (scale != other.scale) return scale < other.scale;
+	if (rotation != other.rotation) return rotation < other.rotation;
+	if (tracking != other.tracking) return tracking < other.tracking;
+	if (align != other.align) return align < other.align;
+	if (base != other.base) return base < other.base;
+	return text < other.text;
+}
 
-	if (mQuad == NULL) return;
-	
+
+void JLBFont::LayoutString(const char *string, int align, std::vector<JSpriteVertex> &vertices) const
+{
+	vertices.clear();
+
+	float dx = 0.0f;
 	float width = GetStringWidth(string);
-			  
+
 	if (align == JGETEXT_RIGHT)
 		dx -= width;
 	else if (align == JGETEXT_CENTER)
 		dx -= width/2;
 
-	int index;
-	while (*p)
+	JQuad glyph(mTexture, 0.0f, 0.0f, 16.0f, mHeight);
+	JSprite sprite;
+
+	for (const char *p = string; *p; p++)
 	{
-		index = (*p - 32)+mBase;
-		//mQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-		if (*p == 'w' || *p == 'z' || *p == 'K' || *p == '<') {
-            mQuad->SetTextureRect(mXPos[index], mYPos[index]+0.3, mCharWidth[index], mHeight);
-        }
-        else {
-            mQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-        }
-
-		mRenderer->RenderQuad(mQuad, dx, dy, mRotation, mScale, mScale);
+		if (*p < 32) continue;
+
+		int index = (*p - 32)+mBase;
+		glyph.SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
+		JSpriteRenderer::SetSprite(&glyph, dx, 0.0f, mRotation, mScale, mScale, sprite);
+
+		vertices.resize(vertices.size() + 4);
+		JSpriteRenderer::BuildQuad(sprite, &vertices[vertices.size() - 4]);
+
 		dx += (mCharWidth[index] + mTracking) * mScale;
-		p++;
+	}
+}
+
+
+const std::vector<JSpriteVertex>& JLBFont::GetRun(const char *string, int align)
+{
+	RunKey key;
+	key.text = string;
+	key.scale = mScale;
+	key.rotation = mRotation;
+	key.tracking = mTracking;
+	key.align = align;
+	key.base = mBase;
+
+	unsigned int frame = mRenderer->GetFrameCount();
+
+	std::map<RunKey, GlyphRun>::iterator it = mRuns.find(key);
+	if (it != mRuns.end())
+	{
+		it->second.lastFrame = frame;
+		return it->second.vertices;
+	}
+
+	if (mRuns.size() >= FONT_RUN_CACHE_SIZE)
+	{
+		std::map<RunKey, GlyphRun>::iterator oldest = mRuns.begin();
+		for (it = mRuns.begin(); it != mRuns.end(); ++it)
+			if (frame - it->second.lastFrame > frame - oldest->second.lastFrame)
+				oldest = it;
+
+		// all drawn this frame, more strings than the cache holds
+		if (oldest->second.lastFrame == frame)
+		{
+			LayoutString(string, align, mLayout);
+			return mLayout;
+		}
 
-   }
-  
+		mRuns.erase(oldest);
+	}
+
+	GlyphRun &run = mRuns[key];
+	run.lastFrame = frame;
+	LayoutString(string, align, run.vertices);
+	return run.vertices;
+}
+
+
+static JSpriteVertex* PlaceGlyphs(const std::vector<JSpriteVertex> &glyphs, float x, float y, PIXEL_TYPE color, JSpriteVertex *v)
+{
+	GLuint rgba = ARGB_TO_RGBA8(color);
+
+	for (size_t i = 0; i < glyphs.size(); i++, v++)
+	{
+		*v = glyphs[i];
+		v->x += x;
+		v->y += y;
+		v->color = rgba;
+	}
+
+	return v;
+}
+
+
+void JLBFont::DrawRun(const std::vector<JSpriteVertex> &glyphs, float x, float y, bool shadowed)
+{
+	if (glyphs.empty()) return;
+
+	mVertices.resize(shadowed ? glyphs.size() * 2 : glyphs.size());
+
+	// shadows first, so that no shadow covers a neighbouring glyph
+	JSpriteVertex *v = &mVertices[0];
+	if (shadowed)
+		v = PlaceGlyphs(glyphs, x+1, y+1, mShadowColor, v);
+	PlaceGlyphs(glyphs, x, y, mColor, v);
+
+	mRenderer->RenderQuads(mTexture, &mVertices[0], (int)mVertices.size() / 4);
+}
+
+
+void JLBFont::DrawString(const char *string, float x, float y, int align)
+{
+	if (mTexture == NULL) return;
+
+	DrawRun(GetRun(string, align), x, y, false);
 }
 
 void JLBFont::DrawShadowedString(const char *string, float x, float y, int align)
 {
-	char *p = (char*)string;
-	float dx = x, dy = y;
+	if (mTexture == NULL) return;
+
+	DrawRun(GetRun(string, align), x, y, true);
+}
+
+
+void JLBFont::RecordString(JRenderQueue &queue, const char *string, float x, float y, int align) const
+{
+	if (mTexture == NULL) return;
 
-	if (mQuad == NULL) return;
-	
-	float width = GetStringWidth(string);
-			  
-	if (align == JGETEXT_RIGHT)
-		dx -= width;
-	else if (align == JGETEXT_CENTER)
-		dx -= width/2;
+	// private buffers, the cache may be in use by other threads
+	std::vector<JSpriteVertex> glyphs;
+	LayoutString(string, align, glyphs);
+	if (glyphs.empty()) return;
 
-	int index;
-	while (*p)
-	{
-		index = (*p - 32)+mBase;
-		//mShadowQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-		//mQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-
-		if (*p == 'w' || *p == 'z' || *p == 'K' || *p == '<') {
-			mShadowQuad->SetTextureRect(mXPos[index], mYPos[index]+0.3, mCharWidth[index], mHeight);
-            mQuad->SetTextureRect(mXPos[index], mYPos[index]+0.3, mCharWidth[index], mHeight);
-        }
-        else {
-			mShadowQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-            mQuad->SetTextureRect(mXPos[index], mYPos[index], mCharWidth[index], mHeight);
-        }
-		mRenderer->RenderQuad(mShadowQuad, dx+1, dy+1, mRotation, mScale, mScale);
-		mRenderer->RenderQuad(mQuad, dx, dy, mRotation, mScale, mScale);
-		dx += (mCharWidth[index] + mTracking) * mScale;
-		p++;
+	std::vector<JSpriteVertex> vertices(glyphs.size());
+	PlaceGlyphs(glyphs, x, y, mColor, &vertices[0]);
 
-   }
-  
+	queue.AddQuads(mTexture, &vertices[0], (int)vertices.size() / 4);
+}
+
+
+void JLBFont::ClearCache()
+{
+	mRuns.clear();
 }
 
 
@@ -181,12 +260,11 @@ void JLBFont::printf(float x, float y, const char *format, ...)
 void JLBFont::SetColor(PIXEL_TYPE color)
 {
     mColor = color;
-	mQuad->SetColor(mColor);
 }
 
 void JLBFont::SetShadowColor(PIXEL_TYPE color)
 {
-	mShadowQuad->SetColor(color);
+	mShadowColor = color;
 }
 
 
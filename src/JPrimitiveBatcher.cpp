@@ -0,0 +1,206 @@
+#include "../include/JPrimitiveBatcher.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+JPrimitiveBatcher::JPrimitiveBatcher(JShader &shader, JStreamBuffer *vertexStream, JStreamBuffer *indexStream)
+{
+    mRenderState = JRenderState::GetInstance();
+    mShader = shader;
+    mVertexStream = vertexStream;
+    mIndexStream = indexStream;
+    mMode = GL_TRIANGLES;
+    mLineWidth = mBatchLineWidth = 1.0f;
+
+    mVertices.reserve(PRIMITIVE_BATCH_MAX_VERTICES);
+    mIndices.reserve(PRIMITIVE_BATCH_MAX_VERTICES * 3);
+
+    glGenVertexArrays(1, &mVAO);
+
+    mRenderState->BindVertexArray(mVAO);
+
+    // both streams are bound to the VAO, offsets change on every flush
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, mVertexStream->GetBuffer());
+    mRenderState->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexStream->GetBuffer());
+
+    mVertexLocation = glGetAttribLocation(mShader.Program, "vertex");
+    mColorLocation = glGetAttribLocation(mShader.Program, "color");
+
+    glEnableVertexAttribArray(mVertexLocation);
+    glVertexAttribPointer(mVertexLocation, 2, GL_FLOAT, GL_FALSE, sizeof(JColorVertex), (GLvoid*)offsetof(JColorVertex, x));
+    glEnableVertexAttribArray(mColorLocation);
+    glVertexAttribPointer(mColorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(JColorVertex), (GLvoid*)offsetof(JColorVertex, color));
+
+    mRenderState->BindVertexArray(0);
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+JPrimitiveBatcher::~JPrimitiveBatcher()
+{
+    mRenderState->DeleteVertexArray(mVAO);
+}
+
+void JPrimitiveBatcher::SetLineWidth(float width)
+{
+    mLineWidth = width;
+}
+
+GLushort JPrimitiveBatcher::Reserve(GLenum mode, int vertexCount)
+{
+    if (!mIndices.empty())
+    {
+        int reason = -1;
+        if (mode != mMode)
+            reason = BATCH_BREAK_MODE;
+        else if (mode == GL_LINES && mLineWidth != mBatchLineWidth)
+            reason = BATCH_BREAK_LINE_WIDTH;
+        else if (mVertices.size() + vertexCount > PRIMITIVE_BATCH_MAX_VERTICES)
+            reason = BATCH_BREAK_FULL;
+
+        if (reason >= 0)
+        {
+            mRenderState->CountBatchBreak(reason);
+            Flush();
+        }
+    }
+
+    mMode = mode;
+    mBatchLineWidth = mLineWidth;
+
+    return (GLushort)mVertices.size();
+}
+
+GLenum JPrimitiveBatcher::GetListMode(GLenum mode, int count)
+{
+    if (count <= 0)
+        return GL_NONE;
+
+    // JRenderer splits larger primitives, this only catches direct callers
+    if (count > PRIMITIVE_BATCH_MAX_VERTICES)
+    {
+        printf("Vertex buffer too small for %d vertices\n", count);
+        return GL_NONE;
+    }
+
+    switch (mode)
+    {
+    case GL_TRIANGLES:
+    case GL_TRIANGLE_FAN:
+    case GL_TRIANGLE_STRIP:
+        return (count < 3) ? GL_NONE : GL_TRIANGLES;
+    case GL_LINES:
+    case GL_LINE_LOOP:
+    case GL_LINE_STRIP:
+        return (count < 2) ? GL_NONE : GL_LINES;
+    default:
+        return GL_POINTS;
+    }
+}
+
+void JPrimitiveBatcher::AppendPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color,
+                                        GLushort base, std::vector<JColorVertex> &vertices, std::vector<GLushort> &indices)
+{
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    for (int i = 0; i < count; i++)
+    {
+        JColorVertex v = { x[i], y[i], rgba };
+        vertices.push_back(v);
+    }
+
+    switch (mode)
+    {
+    case GL_TRIANGLE_FAN:
+        for (int i = 1; i < count - 1; i++)
+        {
+            indices.push_back(base);
+            indices.push_back(base + i);
+            indices.push_back(base + i + 1);
+        }
+        break;
+    case GL_TRIANGLE_STRIP:
+        for (int i = 0; i < count - 2; i++)
+        {
+            // keep the winding of odd triangles consistent with GL
+            indices.push_back(base + i + (i & 1));
+            indices.push_back(base + i + 1 - (i & 1));
+            indices.push_back(base + i + 2);
+        }
+        break;
+    case GL_LINE_LOOP:
+    case GL_LINE_STRIP:
+        for (int i = 0; i < count - 1; i++)
+        {
+            indices.push_back(base + i);
+            indices.push_back(base + i + 1);
+        }
+        if (mode == GL_LINE_LOOP)
+        {
+            indices.push_back(base + count - 1);
+            indices.push_back(base);
+        }
+        break;
+    default:
+        // GL_TRIANGLES, GL_LINES and GL_POINTS are lists already
+        for (int i = 0; i < count; i++)
+            indices.push_back(base + i);
+        break;
+    }
+}
+
+void JPrimitiveBatcher::AddPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color)
+{
+    GLenum listMode = GetListMode(mode, count);
+    if (listMode == GL_NONE)
+        return;
+
+    GLushort base = Reserve(listMode, count);
+    AppendPrimitive(mode, x, y, count, color, base, mVertices, mIndices);
+}
+
+void JPrimitiveBatcher::AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount)
+{
+    if (vertexCount <= 0)
+        return;
+
+    // JRenderer splits larger lists, this only catches direct callers
+    if (vertexCount > PRIMITIVE_BATCH_MAX_VERTICES)
+    {
+        printf("Vertex buffer too small for %d vertices\n", vertexCount);
+        return;
+    }
+
+    GLushort base = Reserve(mode, vertexCount);
+
+    mVertices.insert(mVertices.end(), vertices, vertices + vertexCount);
+    for (int i = 0; i < indexCount; i++)
+        mIndices.push_back(base + indices[i]);
+}
+
+void JPrimitiveBatcher::Flush()
+{
+    if (mIndices.empty())
+        return;
+
+    mRenderState->BeginSubmit();
+
+    mShader.Use();
+
+    if (mMode == GL_LINES)
+        glLineWidth(mBatchLineWidth);
+
+    mRenderState->BindVertexArray(mVAO);
+
+    GLintptr vertexOffset = mVertexStream->Upload(&mVertices[0], mVertices.size() * sizeof(JColorVertex));
+    glVertexAttribPointer(mVertexLocation, 2, GL_FLOAT, GL_FALSE, sizeof(JColorVertex), (GLvoid*)(vertexOffset + offsetof(JColorVertex, x)));
+    glVertexAttribPointer(mColorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(JColorVertex), (GLvoid*)(vertexOffset + offsetof(JColorVertex, color)));
+
+    GLintptr indexOffset = mIndexStream->Upload(&mIndices[0], mIndices.size() * sizeof(GLushort));
+
+    glDrawElements(mMode, (GLsizei)mIndices.size(), GL_UNSIGNED_SHORT, (GLvoid*)indexOffset);
+    mRenderState->CountDraw((int)mIndices.size());
+
+    mVertices.clear();
+    mIndices.clear();
+
+    mRenderState->EndSubmit();
+}
@@ -0,0 +1,277 @@
+#include "../include/JRenderQueue.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+// shader part of the key
+enum
+{
+	RENDER_SHADER_SPRITE,
+	RENDER_SHADER_PRIMITIVE
+};
+
+JRenderQueue::JRenderQueue()
+{
+    mLayer = 0;
+    mDepth = 0;
+    mBlendSrc = BLEND_SRC_ALPHA;
+    mBlendDest = BLEND_ONE_MINUS_SRC_ALPHA;
+    mTextureFilter = TEX_FILTER_NONE;
+}
+
+JRenderQueue::~JRenderQueue()
+{
+}
+
+void JRenderQueue::SetLayer(int layer)
+{
+    if (layer < 0)
+        layer = 0;
+    else if (layer >= RENDER_QUEUE_LAYERS)
+        layer = RENDER_QUEUE_LAYERS - 1;
+
+    mLayer = layer;
+}
+
+void JRenderQueue::SetDepth(int depth)
+{
+    if (depth < -RENDER_KEY_DEPTH_BIAS)
+        depth = -RENDER_KEY_DEPTH_BIAS;
+    else if (depth >= RENDER_KEY_DEPTH_BIAS)
+        depth = RENDER_KEY_DEPTH_BIAS - 1;
+
+    mDepth = depth;
+}
+
+void JRenderQueue::SetLayerStable(int layer, bool stable)
+{
+    if (layer >= 0 && layer < RENDER_QUEUE_LAYERS)
+        mStableLayers.set(layer, stable);
+}
+
+bool JRenderQueue::IsLayerStable(int layer) const
+{
+    return layer >= 0 && layer < RENDER_QUEUE_LAYERS && mStableLayers.test(layer);
+}
+
+void JRenderQueue::SetBlend(int src, int dest)
+{
+    mBlendSrc = src;
+    mBlendDest = dest;
+}
+
+void JRenderQueue::SetTextureFilter(int filter)
+{
+    mTextureFilter = filter;
+}
+
+int JRenderQueue::GetBlendId(int src, int dest)
+{
+    for (size_t i = 0; i < mBlendModes.size(); i++)
+    {
+        if (mBlendModes[i].first == src && mBlendModes[i].second == dest)
+            return (int)i;
+    }
+
+    if (mBlendModes.size() < RENDER_QUEUE_BLEND_MODES)
+    {
+        mBlendModes.push_back(std::make_pair(src, dest));
+        return (int)mBlendModes.size() - 1;
+    }
+
+    // out of ids, the command still draws right but groups with other modes
+    return RENDER_QUEUE_BLEND_MODES - 1;
+}
+
+void JRenderQueue::Record(JRenderCommand &command, int shaderId, GLuint textureId)
+{
+    uint64_t key = (uint64_t)mLayer << RENDER_KEY_LAYER_SHIFT;
+    key |= (uint64_t)((mDepth + RENDER_KEY_DEPTH_BIAS) & RENDER_KEY_DEPTH_MASK);
+
+    if (!mStableLayers.test(mLayer))
+    {
+        key |= (uint64_t)shaderId << RENDER_KEY_SHADER_SHIFT;
+        key |= (uint64_t)GetBlendId(command.blendSrc, command.blendDest) << RENDER_KEY_BLEND_SHIFT;
+        key |= (uint64_t)(textureId & RENDER_KEY_TEXTURE_MASK) << RENDER_KEY_TEXTURE_SHIFT;
+    }
+
+    SortEntry entry;
+    entry.key = key;
+    entry.index = (int)mCommands.size();
+
+    mSortEntries.push_back(entry);
+    mCommands.push_back(command);
+}
+
+void JRenderQueue::AddSprite(const JSprite &sprite, int blendSrc, int blendDest)
+{
+    JRenderCommand command;
+    command.type = RENDER_COMMAND_QUAD;
+    command.texture = sprite.texture;
+    command.textureFilter = sprite.textureFilter;
+    command.blendSrc = blendSrc;
+    command.blendDest = blendDest;
+    command.mode = GL_TRIANGLES;
+    command.lineWidth = 1.0f;
+    command.firstVertex = (int)mQuadVertices.size();
+    command.vertexCount = 4;
+    command.firstIndex = 0;
+    command.indexCount = 0;
+
+    mQuadVertices.resize(mQuadVertices.size() + 4);
+    JSpriteRenderer::BuildQuad(sprite, &mQuadVertices[command.firstVertex]);
+
+    Record(command, RENDER_SHADER_SPRITE, sprite.texture ? sprite.texture->mTexId : 0);
+}
+
+void JRenderQueue::AddQuads(JTexture *texture, const JSpriteVertex *vertices, int quadCount)
+{
+    AddQuads(texture, mTextureFilter, vertices, quadCount, mBlendSrc, mBlendDest);
+}
+
+void JRenderQueue::AddQuads(JTexture *texture, int textureFilter, const JSpriteVertex *vertices, int quadCount, int blendSrc, int blendDest)
+{
+    if (quadCount <= 0)
+        return;
+
+    JRenderCommand command;
+    command.type = RENDER_COMMAND_QUAD;
+    command.texture = texture;
+    command.textureFilter = textureFilter;
+    command.blendSrc = blendSrc;
+    command.blendDest = blendDest;
+    command.mode = GL_TRIANGLES;
+    command.lineWidth = 1.0f;
+    command.firstVertex = (int)mQuadVertices.size();
+    command.vertexCount = quadCount * 4;
+    command.firstIndex = 0;
+    command.indexCount = 0;
+
+    mQuadVertices.insert(mQuadVertices.end(), vertices, vertices + command.vertexCount);
+
+    Record(command, RENDER_SHADER_SPRITE, texture ? texture->mTexId : 0);
+}
+
+void JRenderQueue::AddPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color,
+                                float lineWidth, int blendSrc, int blendDest)
+{
+    GLenum listMode = JPrimitiveBatcher::GetListMode(mode, count);
+    if (listMode == GL_NONE)
+        return;
+
+    JRenderCommand command;
+    command.type = RENDER_COMMAND_PRIMITIVE;
+    command.texture = NULL;
+    command.textureFilter = TEX_FILTER_NONE;
+    command.blendSrc = blendSrc;
+    command.blendDest = blendDest;
+    command.mode = listMode;
+    command.lineWidth = lineWidth;
+    command.firstVertex = (int)mPrimitiveVertices.size();
+    command.vertexCount = count;
+    command.firstIndex = (int)mPrimitiveIndices.size();
+
+    JPrimitiveBatcher::AppendPrimitive(mode, x, y, count, color, 0, mPrimitiveVertices, mPrimitiveIndices);
+    command.indexCount = (int)mPrimitiveIndices.size() - command.firstIndex;
+
+    Record(command, RENDER_SHADER_PRIMITIVE, 0);
+}
+
+void JRenderQueue::AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount,
+                              float lineWidth, int blendSrc, int blendDest)
+{
+    if (vertexCount <= 0 || indexCount <= 0)
+        return;
+
+    // JRenderer splits larger lists, this only catches direct callers
+    if (vertexCount > PRIMITIVE_BATCH_MAX_VERTICES)
+    {
+        printf("Vertex buffer too small for %d vertices\n", vertexCount);
+        return;
+    }
+
+    JRenderCommand command;
+    command.type = RENDER_COMMAND_PRIMITIVE;
+    command.texture = NULL;
+    command.textureFilter = TEX_FILTER_NONE;
+    command.blendSrc = blendSrc;
+    command.blendDest = blendDest;
+    command.mode = mode;
+    command.lineWidth = lineWidth;
+    command.firstVertex = (int)mPrimitiveVertices.size();
+    command.vertexCount = vertexCount;
+    command.firstIndex = (int)mPrimitiveIndices.size();
+    command.indexCount = indexCount;
+
+    mPrimitiveVertices.insert(mPrimitiveVertices.end(), vertices, vertices + vertexCount);
+    mPrimitiveIndices.insert(mPrimitiveIndices.end(), indices, indices + indexCount);
+
+    Record(command, RENDER_SHADER_PRIMITIVE, 0);
+}
+
+void JRenderQueue::AddQuad(const JQuad *quad, float xo, float yo, float angle, float xScale, float yScale)
+{
+    JSprite sprite;
+    JSpriteRenderer::SetSprite(quad, xo, yo, angle, xScale, yScale, sprite);
+    sprite.textureFilter = mTextureFilter;
+
+    AddSprite(sprite, mBlendSrc, mBlendDest);
+}
+
+void JRenderQueue::Append(JRenderQueue &other)
+{
+    int firstCommand = (int)mCommands.size();
+    int firstQuadVertex = (int)mQuadVertices.size();
+    int firstPrimitiveVertex = (int)mPrimitiveVertices.size();
+    int firstPrimitiveIndex = (int)mPrimitiveIndices.size();
+
+    mQuadVertices.insert(mQuadVertices.end(), other.mQuadVertices.begin(), other.mQuadVertices.end());
+    mPrimitiveVertices.insert(mPrimitiveVertices.end(), other.mPrimitiveVertices.begin(), other.mPrimitiveVertices.end());
+    mPrimitiveIndices.insert(mPrimitiveIndices.end(), other.mPrimitiveIndices.begin(), other.mPrimitiveIndices.end());
+
+    const uint64_t blendMask = (uint64_t)(RENDER_QUEUE_BLEND_MODES - 1) << RENDER_KEY_BLEND_SHIFT;
+
+    for (size_t i = 0; i < other.mSortEntries.size(); i++)
+    {
+        JRenderCommand command = other.mCommands[other.mSortEntries[i].index];
+        if (command.type == RENDER_COMMAND_QUAD)
+        {
+            command.firstVertex += firstQuadVertex;
+        }
+        else
+        {
+            command.firstVertex += firstPrimitiveVertex;
+            command.firstIndex += firstPrimitiveIndex;
+        }
+
+        // blend ids are private to each queue
+        SortEntry entry = other.mSortEntries[i];
+        if (!other.IsLayerStable((int)(entry.key >> RENDER_KEY_LAYER_SHIFT)))
+        {
+            entry.key &= ~blendMask;
+            entry.key |= (uint64_t)GetBlendId(command.blendSrc, command.blendDest) << RENDER_KEY_BLEND_SHIFT;
+        }
+        entry.index = firstCommand + (int)i;
+
+        mSortEntries.push_back(entry);
+        mCommands.push_back(command);
+    }
+
+    other.Clear();
+}
+
+void JRenderQueue::Sort()
+{
+    // the index breaks ties, which keeps recording order without a stable sort
+    std::sort(mSortEntries.begin(), mSortEntries.end());
+}
+
+void JRenderQueue::Clear()
+{
+    mCommands.clear();
+    mSortEntries.clear();
+    mQuadVertices.clear();
+    mPrimitiveVertices.clear();
+    mPrimitiveIndices.clear();
+}
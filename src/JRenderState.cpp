@@ -0,0 +1,283 @@
+#include "../include/JRenderState.h"
+
+#include <stddef.h>
+
+JRenderState* JRenderState::mInstance = NULL;
+
+JRenderState* JRenderState::GetInstance()
+{
+	if (mInstance == NULL)
+	{
+		mInstance = new JRenderState();
+	}
+
+	return mInstance;
+}
+
+
+void JRenderState::Destroy()
+{
+	if (mInstance)
+	{
+		delete mInstance;
+		mInstance = NULL;
+	}
+}
+
+
+JRenderState::JRenderState()
+{
+	mSubmitDepth = 0;
+	Invalidate();
+	ResetCounters();
+}
+
+
+JRenderState::~JRenderState()
+{
+}
+
+
+void JRenderState::Invalidate()
+{
+	mProgram = RENDER_STATE_UNKNOWN;
+	mActiveTexture = RENDER_STATE_UNKNOWN;
+	for (int i = 0; i < RENDER_STATE_TEXTURE_UNITS; i++)
+		mTextures[i] = RENDER_STATE_UNKNOWN;
+	mBlendSrc = RENDER_STATE_UNKNOWN;
+	mBlendDest = RENDER_STATE_UNKNOWN;
+	mArrayBuffer = RENDER_STATE_UNKNOWN;
+	mElementBuffer = RENDER_STATE_UNKNOWN;
+	mVertexArray = RENDER_STATE_UNKNOWN;
+}
+
+
+void JRenderState::ResetCounters()
+{
+	for (int i = 0; i < STATE_CALL_COUNT; i++)
+	{
+		mIssued[i] = 0;
+		mSkipped[i] = 0;
+	}
+
+	mDrawCalls = 0;
+	mVertices = 0;
+	mUploadBytes = 0;
+	for (int i = 0; i < BATCH_BREAK_COUNT; i++)
+		mBatchBreaks[i] = 0;
+	mCulledQuads = 0;
+	mSubmitTime = 0.0f;
+}
+
+
+void JRenderState::BeginSubmit()
+{
+	if (mSubmitDepth++ == 0)
+		mSubmitStart = std::chrono::steady_clock::now();
+}
+
+
+void JRenderState::EndSubmit()
+{
+	if (--mSubmitDepth == 0)
+	{
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - mSubmitStart;
+		mSubmitTime += elapsed.count();
+	}
+}
+
+
+int JRenderState::GetTotalIssuedCount() const
+{
+	int total = 0;
+	for (int i = 0; i < STATE_CALL_COUNT; i++)
+		total += mIssued[i];
+	return total;
+}
+
+
+int JRenderState::GetTotalSkippedCount() const
+{
+	int total = 0;
+	for (int i = 0; i < STATE_CALL_COUNT; i++)
+		total += mSkipped[i];
+	return total;
+}
+
+
+void JRenderState::UseProgram(GLuint program)
+{
+	if (Changed(STATE_CALL_USE_PROGRAM, program != mProgram))
+	{
+		mProgram = program;
+		glUseProgram(program);
+	}
+}
+
+
+void JRenderState::ActiveTexture(GLenum unit)
+{
+	if (Changed(STATE_CALL_ACTIVE_TEXTURE, unit != mActiveTexture))
+	{
+		mActiveTexture = unit;
+		glActiveTexture(unit);
+	}
+}
+
+
+void JRenderState::BindTexture(GLuint texture)
+{
+	int unit = (mActiveTexture == RENDER_STATE_UNKNOWN) ? -1 : (int)(mActiveTexture - GL_TEXTURE0);
+
+	if (unit < 0 || unit >= RENDER_STATE_TEXTURE_UNITS)
+	{
+		// unit not tracked, nothing can be assumed
+		Changed(STATE_CALL_BIND_TEXTURE, true);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		return;
+	}
+
+	if (Changed(STATE_CALL_BIND_TEXTURE, texture != mTextures[unit]))
+	{
+		mTextures[unit] = texture;
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+}
+
+
+void JRenderState::SetTextureFilter(JTexture *tex, bool linear)
+{
+	if (tex->mMipmapped)
+		SetTextureFilter(tex, linear ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST, linear ? GL_LINEAR : GL_NEAREST);
+	else
+		SetTextureFilter(tex, linear ? GL_LINEAR : GL_NEAREST, linear ? GL_LINEAR : GL_NEAREST);
+}
+
+void JRenderState::SetTextureFilter(JTexture *tex, GLint minFilter, GLint magFilter)
+{
+	bool minChanged = Changed(STATE_CALL_TEX_PARAMETER, tex->mMinFilter != minFilter);
+	bool magChanged = Changed(STATE_CALL_TEX_PARAMETER, tex->mMagFilter != magFilter);
+
+	if (minChanged || magChanged)
+		BindTexture(tex->mTexId);
+
+	if (minChanged)
+	{
+		tex->mMinFilter = minFilter;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+	}
+	if (magChanged)
+	{
+		tex->mMagFilter = magFilter;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+	}
+}
+
+
+void JRenderState::SetTextureWrap(JTexture *tex, GLint wrapS, GLint wrapT)
+{
+	bool sChanged = Changed(STATE_CALL_TEX_PARAMETER, tex->mWrapS != wrapS);
+	bool tChanged = Changed(STATE_CALL_TEX_PARAMETER, tex->mWrapT != wrapT);
+
+	if (sChanged || tChanged)
+		BindTexture(tex->mTexId);
+
+	if (sChanged)
+	{
+		tex->mWrapS = wrapS;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+	}
+	if (tChanged)
+	{
+		tex->mWrapT = wrapT;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+	}
+}
+
+
+void JRenderState::BlendFunc(GLenum src, GLenum dest)
+{
+	if (Changed(STATE_CALL_BLEND_FUNC, src != mBlendSrc || dest != mBlendDest))
+	{
+		mBlendSrc = src;
+		mBlendDest = dest;
+		glBlendFunc(src, dest);
+	}
+}
+
+
+void JRenderState::BindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint *bound = NULL;
+	if (target == GL_ARRAY_BUFFER)
+		bound = &mArrayBuffer;
+	else if (target == GL_ELEMENT_ARRAY_BUFFER)
+		bound = &mElementBuffer;
+
+	if (bound == NULL)
+	{
+		Changed(STATE_CALL_BIND_BUFFER, true);
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Changed(STATE_CALL_BIND_BUFFER, buffer != *bound))
+	{
+		*bound = buffer;
+		glBindBuffer(target, buffer);
+	}
+}
+
+
+void JRenderState::BindVertexArray(GLuint vao)
+{
+	if (Changed(STATE_CALL_BIND_VERTEX_ARRAY, vao != mVertexArray))
+	{
+		mVertexArray = vao;
+		// element buffer binding is part of the vertex array state
+		mElementBuffer = RENDER_STATE_UNKNOWN;
+		glBindVertexArray(vao);
+	}
+}
+
+
+void JRenderState::DeleteTexture(GLuint texture)
+{
+	// GL rebinds 0 wherever a deleted texture was bound
+	for (int i = 0; i < RENDER_STATE_TEXTURE_UNITS; i++)
+	{
+		if (mTextures[i] == texture)
+			mTextures[i] = 0;
+	}
+	glDeleteTextures(1, &texture);
+}
+
+
+void JRenderState::DeleteProgram(GLuint program)
+{
+	// a program in use is only flagged for deletion, forget it anyway
+	if (mProgram == program)
+		mProgram = RENDER_STATE_UNKNOWN;
+	glDeleteProgram(program);
+}
+
+
+void JRenderState::DeleteBuffer(GLuint buffer)
+{
+	if (mArrayBuffer == buffer)
+		mArrayBuffer = 0;
+	if (mElementBuffer == buffer)
+		mElementBuffer = 0;
+	glDeleteBuffers(1, &buffer);
+}
+
+
+void JRenderState::DeleteVertexArray(GLuint vao)
+{
+	if (mVertexArray == vao)
+	{
+		mVertexArray = 0;
+		mElementBuffer = RENDER_STATE_UNKNOWN;
+	}
+	glDeleteVertexArrays(1, &vao);
+}
@@ -1,6 +1,8 @@
 #include "../include/JGE.h"
 #include "../include/JRenderer.h"
 #include "../include/JResourceManager.h"
+#include "../include/JRenderState.h"
+#include "../include/JTextureLoader.h"
 
 JQuad::JQuad(JTexture *tex, float x, float y, float width, float height)
 		:mTex(tex), mX(x), mY(y), mWidth(width), mHeight(height)
@@ -51,14 +53,21 @@ JTexture::JTexture()
 
 JTexture::~JTexture()
 {
+	if (mLoading)
+		JTextureLoader::GetInstance()->Cancel(this);
+
 	if (mTexId != -1)
-		glDeleteTextures(1, &mTexId);
+		JRenderState::GetInstance()->DeleteTexture(mTexId);
+
+	if (mFramebufferId != 0)
+		glDeleteFramebuffers(1, &mFramebufferId);
 }
 
 void JTexture::UpdateBits(int width, int height, PIXEL_TYPE* bits)
 {
-	glBindTexture(GL_TEXTURE_2D, mTexId);
+	JRenderState::GetInstance()->BindTexture(mTexId);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, bits);
+	JRenderState::GetInstance()->CountUpload(width * height * sizeof(PIXEL_TYPE));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -86,10 +95,29 @@ void JRenderer::InitRenderer()
     mCurrTexBlendSrc = BLEND_SRC_ALPHA;
     mCurrTexBlendDest = BLEND_ONE_MINUS_SRC_ALPHA;
 
+    mSpriteBackend = SPRITE_BACKEND_BATCHED;
+
+    mAppliedTexBlendSrc = mCurrTexBlendSrc;
+    mAppliedTexBlendDest = mCurrTexBlendDest;
+
+    mRenderQueue = NULL;
+    mRenderQueueEnabled = false;
+
     // Load shaders
+    std::chrono::steady_clock::time_point shaderStart = std::chrono::steady_clock::now();
     JResourceManager::LoadShader("sprite.vert", "sprite.frag", nullptr, "sprite");
     glm::mat4 projection = glm::ortho(0.0f, static_cast<GLfloat>(SCREEN_WIDTH_F),
         static_cast<GLfloat>(SCREEN_HEIGHT_F), 0.0f, -1.0f, 1.0f);
+    mProjection = projection;
+    mViewWidth = SCREEN_WIDTH_F;
+    mViewHeight = SCREEN_HEIGHT_F;
+    mScreenProjection = projection;
+    mScreenViewWidth = SCREEN_WIDTH_F;
+    mScreenViewHeight = SCREEN_HEIGHT_F;
+    mScreenViewport[0] = mScreenViewport[1] = 0;
+    mScreenViewport[2] = SCREEN_WIDTH;
+    mScreenViewport[3] = SCREEN_HEIGHT;
+    mCullingEnabled = true;
     JShader spriteShader = JResourceManager::GetShader("sprite");
     spriteShader.Use();
     spriteShader.SetInteger("image", 0);
@@ -99,16 +127,58 @@ void JRenderer::InitRenderer()
     JShader simpleShader = JResourceManager::GetShader("simple");
     simpleShader.Use();
     simpleShader.SetMatrix4("projection", projection);
-    colorUniformLoc = glGetUniformLocation(simpleShader.Program, "color");
+
+    JResourceManager::LoadShader("primitive.vert", "primitive.frag", nullptr, "primitive");
+    JShader primitiveShader = JResourceManager::GetShader("primitive");
+    primitiveShader.Use();
+    primitiveShader.SetMatrix4("projection", projection);
+
+    JResourceManager::LoadShader("sprite_batch.vert", "sprite_batch.frag", nullptr, "sprite_batch");
+    JShader spriteBatchShader = JResourceManager::GetShader("sprite_batch");
+    spriteBatchShader.Use();
+    spriteBatchShader.SetInteger("image", 0);
+    spriteBatchShader.SetMatrix4("projection", projection);
+
+    JResourceManager::LoadShader("sprite_instanced.vert", "sprite_batch.frag", nullptr, "sprite_instanced");
+    JShader spriteInstancedShader = JResourceManager::GetShader("sprite_instanced");
+    spriteInstancedShader.Use();
+    spriteInstancedShader.SetInteger("image", 0);
+    spriteInstancedShader.SetMatrix4("projection", projection);
+
+    static const char *projectedShaders[PROJECTED_SHADERS] = { "sprite", "simple", "primitive", "sprite_batch", "sprite_instanced" };
+    for (int i = 0; i < PROJECTED_SHADERS; i++)
+    {
+        mProjectedShaders[i] = JResourceManager::GetShaderId(projectedShaders[i]);
+        mProjectionUniforms[i] = JResourceManager::GetShader(mProjectedShaders[i]).GetUniform<glm::mat4>("projection");
+    }
+
+    mShaderLoadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+
+    // Streaming buffers, grown on demand
+    mVertexStream = new JStreamBuffer(GL_ARRAY_BUFFER, 256 * 1024);
+    mIndexStream = new JStreamBuffer(GL_ELEMENT_ARRAY_BUFFER, 64 * 1024);
 
     // Load sprite renderer
-    mSpriteRenderer = new JSpriteRenderer(spriteShader);
+    mSpriteRenderer = new JSpriteRenderer(spriteShader, spriteBatchShader, spriteInstancedShader, mVertexStream);
 
-    // Load Vertex Buffer Object
-    JRenderer::InitVBO();
+    // Load primitive batcher
+    mPrimitiveBatcher = new JPrimitiveBatcher(primitiveShader, mVertexStream, mIndexStream);
+    mRenderQueue = new JRenderQueue();
 
     glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    JRenderState::GetInstance()->BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    mFrameCount = 0;
+
+#ifdef JGE_GPU_TIMER
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    mGpuTimerSupported = extensions != NULL && strstr(extensions, "GL_EXT_disjoint_timer_query") != NULL;
+    if (mGpuTimerSupported)
+        glGenQueriesEXT(GPU_TIMER_QUERIES, mGpuQueries);
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++)
+        mGpuQueryPending[i] = false;
+    mGpuQueryActive = false;
+#endif
 }
 
 void JRenderer::Destroy()
@@ -119,6 +189,8 @@ void JRenderer::Destroy()
 		delete mInstance;
 		mInstance = NULL;
 	}
+
+	JRenderState::Destroy();
 }
 
 JRenderer::JRenderer()
@@ -130,31 +202,38 @@ JRenderer::~JRenderer()
 {
 }
 
-void JRenderer::InitVBO()
+void JRenderer::DestroyRenderer()
 {
-    bufferSize = 360;
-    elementBufferSize = 360;
-
-    JShader shader = JResourceManager::GetShader("simple").Use();
+	SAFE_DELETE(mSpriteRenderer);
+	SAFE_DELETE(mPrimitiveBatcher);
+	SAFE_DELETE(mRenderQueue);
+	SAFE_DELETE(mVertexStream);
+	SAFE_DELETE(mIndexStream);
 
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, bufferSize * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+#ifdef JGE_GPU_TIMER
+	if (mGpuTimerSupported)
+		glDeleteQueriesEXT(GPU_TIMER_QUERIES, mGpuQueries);
+#endif
 
-    GLint vertexLocation = glGetAttribLocation(shader.Program, "vertex");
-    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(vertexLocation);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
-
-void JRenderer::DestroyRenderer()
-{
 	JResourceManager::Clear();
 }
 
 void JRenderer::BeginScene()
 {
+	JRenderState::GetInstance()->ResetCounters();
+	mFrameStart = std::chrono::steady_clock::now();
+
+	// textures loaded in the background, within the upload budget
+	JTextureLoader::GetInstance()->Update();
+
+#ifdef JGE_GPU_TIMER
+	// a query still pending from GPU_TIMER_QUERIES frames ago leaves this frame untimed
+	int query = mFrameCount % GPU_TIMER_QUERIES;
+	mGpuQueryActive = mGpuTimerSupported && !mGpuQueryPending[query];
+	if (mGpuQueryActive)
+		glBeginQueryEXT(GL_TIME_ELAPSED_EXT, mGpuQueries[query]);
+#endif
+
 	glClearColor(0.9f, 0.9f, 0.9f, 1.0f);
 	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		// Clear Screen And Depth Buffer
 }
@@ -162,9 +241,225 @@ void JRenderer::BeginScene()
 
 void JRenderer::EndScene()
 {
+	FlushBatch();
+
+	JRenderState *renderState = JRenderState::GetInstance();
+	JRenderStats &stats = mFrameStats[mFrameCount % RENDER_STATS_HISTORY];
+
+	stats.frame = mFrameCount;
+	stats.drawCalls = renderState->GetDrawCount();
+	stats.vertices = renderState->GetVertexCount();
+	stats.uploadBytes = renderState->GetUploadBytes();
+	stats.textureBinds = renderState->GetIssuedCount(STATE_CALL_BIND_TEXTURE);
+	stats.programSwitches = renderState->GetIssuedCount(STATE_CALL_USE_PROGRAM);
+	stats.stateChanges = renderState->GetTotalIssuedCount();
+	stats.redundantStateChanges = renderState->GetTotalSkippedCount();
+	for (int i = 0; i < BATCH_BREAK_COUNT; i++)
+		stats.batchBreaks[i] = renderState->GetBatchBreakCount(i);
+	stats.culledQuads = renderState->GetCulledCount();
+	stats.submitTime = renderState->GetSubmitTime();
+	std::chrono::duration<float, std::milli> frameTime = std::chrono::steady_clock::now() - mFrameStart;
+	stats.frameTime = frameTime.count();
+	stats.gpuTime = -1.0f;
+
+#ifdef JGE_GPU_TIMER
+	if (mGpuQueryActive)
+	{
+		int query = mFrameCount % GPU_TIMER_QUERIES;
+		glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+		mGpuQueryFrames[query] = mFrameCount;
+		mGpuQueryPending[query] = true;
+		mGpuQueryActive = false;
+	}
+#endif
+
+	mFrameCount++;
+
+#ifdef JGE_GPU_TIMER
+	ReadGpuTimers();
+#endif
+
+	mVertexStream->NextFrame();
+	mIndexStream->NextFrame();
+	mTriangulator.NextFrame();
 	// glFlush ();
 }
 
+const JRenderStats* JRenderer::GetFrameStats(int framesAgo) const
+{
+	if (framesAgo < 0 || framesAgo >= GetFrameStatsCount())
+		return NULL;
+
+	return &mFrameStats[(mFrameCount - 1 - framesAgo) % RENDER_STATS_HISTORY];
+}
+
+int JRenderer::GetFrameStatsCount() const
+{
+	return (mFrameCount < RENDER_STATS_HISTORY) ? (int)mFrameCount : RENDER_STATS_HISTORY;
+}
+
+#ifdef JGE_GPU_TIMER
+void JRenderer::ReadGpuTimers()
+{
+	// disjoint results, from a clock change or a context loss, are meaningless
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+	for (int i = 0; i < GPU_TIMER_QUERIES; i++)
+	{
+		if (!mGpuQueryPending[i])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectivEXT(mGpuQueries[i], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+		if (!available)
+			continue;
+
+		GLuint64EXT elapsed = 0;
+		glGetQueryObjectui64vEXT(mGpuQueries[i], GL_QUERY_RESULT_EXT, &elapsed);
+		mGpuQueryPending[i] = false;
+
+		unsigned int frame = mGpuQueryFrames[i];
+		if (!disjoint && mFrameCount - frame <= RENDER_STATS_HISTORY)
+			mFrameStats[frame % RENDER_STATS_HISTORY].gpuTime = elapsed / 1000000.0f;
+	}
+}
+#endif
+
+void JRenderer::EnableSpriteBatching(bool flag)
+{
+	SetSpriteBackend(flag ? SPRITE_BACKEND_BATCHED : SPRITE_BACKEND_IMMEDIATE);
+}
+
+void JRenderer::SetSpriteBackend(int backend)
+{
+	if (backend != mSpriteBackend)
+	{
+		FlushBatch();
+		mSpriteBackend = backend;
+	}
+}
+
+void JRenderer::FlushBatch()
+{
+	if (!mRenderQueue->IsEmpty())
+		SubmitRenderQueue();
+
+	FlushBatchers(BATCH_BREAK_FLUSH);
+
+	// leave GL with the blending set by the application
+	ApplyTexBlend(mCurrTexBlendSrc, mCurrTexBlendDest);
+}
+
+void JRenderer::FlushBatchers(int reason)
+{
+	if (mSpriteRenderer->HasPendingSprites() || mPrimitiveBatcher->HasPendingPrimitives())
+		JRenderState::GetInstance()->CountBatchBreak(reason);
+
+	mSpriteRenderer->Flush();
+	mPrimitiveBatcher->Flush();
+}
+
+void JRenderer::ApplyTexBlend(int src, int dest)
+{
+	if (src != mAppliedTexBlendSrc || dest != mAppliedTexBlendDest)
+	{
+		FlushBatchers(BATCH_BREAK_BLEND);
+
+		mAppliedTexBlendSrc = src;
+		mAppliedTexBlendDest = dest;
+
+		JRenderState::GetInstance()->BlendFunc(src, dest);
+	}
+}
+
+void JRenderer::SubmitRenderQueue()
+{
+	JRenderState::GetInstance()->BeginSubmit();
+
+	mRenderQueue->Sort();
+
+	float lineWidth = mPrimitiveBatcher->GetLineWidth();
+
+	int count = mRenderQueue->GetCommandCount();
+	for (int i = 0; i < count; i++)
+	{
+		const JRenderCommand &command = mRenderQueue->GetSortedCommand(i);
+
+		ApplyTexBlend(command.blendSrc, command.blendDest);
+
+		if (command.type == RENDER_COMMAND_QUAD)
+		{
+			BeginSprites();
+			const JSpriteVertex *vertices = mRenderQueue->GetQuadVertices(command);
+			for (int j = 0; j < command.vertexCount; j += 4)
+				mSpriteRenderer->AddQuad(command.texture, command.textureFilter, vertices + j);
+		}
+		else
+		{
+			BeginPrimitives();
+			mPrimitiveBatcher->SetLineWidth(command.lineWidth);
+			mPrimitiveBatcher->AddIndexed(command.mode, mRenderQueue->GetPrimitiveVertices(command), command.vertexCount,
+										  mRenderQueue->GetPrimitiveIndices(command), command.indexCount);
+		}
+	}
+
+	mPrimitiveBatcher->SetLineWidth(lineWidth);
+	mRenderQueue->Clear();
+
+	JRenderState::GetInstance()->EndSubmit();
+}
+
+void JRenderer::EnableRenderQueue(bool flag)
+{
+	if (flag != mRenderQueueEnabled)
+	{
+		FlushBatch();
+		mRenderQueueEnabled = flag;
+	}
+}
+
+void JRenderer::MergeRenderQueue(JRenderQueue &queue)
+{
+	mRenderQueue->Append(queue);
+
+	if (!mRenderQueueEnabled)
+		FlushBatch();
+}
+
+void JRenderer::SetRenderLayer(int layer)
+{
+	mRenderQueue->SetLayer(layer);
+}
+
+void JRenderer::SetRenderDepth(int depth)
+{
+	mRenderQueue->SetDepth(depth);
+}
+
+void JRenderer::SetLayerStable(int layer, bool stable)
+{
+	mRenderQueue->SetLayerStable(layer, stable);
+}
+
+void JRenderer::BeginSprites()
+{
+	if (mPrimitiveBatcher->HasPendingPrimitives())
+	{
+		JRenderState::GetInstance()->CountBatchBreak(BATCH_BREAK_BATCHER);
+		mPrimitiveBatcher->Flush();
+	}
+}
+
+void JRenderer::BeginPrimitives()
+{
+	if (mSpriteRenderer->HasPendingSprites())
+	{
+		JRenderState::GetInstance()->CountBatchBreak(BATCH_BREAK_BATCHER);
+		mSpriteRenderer->Flush();
+	}
+}
+
 void JRenderer::EnableTextureFilter(bool flag)
 {
 	if (flag)
@@ -194,11 +489,10 @@ JTexture* JRenderer::CreateTexture(int width, int height )
 
 		memset(buffer, 0, size);
 
-		glBindTexture(GL_TEXTURE_2D, texid);
-
-		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+		JRenderState::GetInstance()->BindTexture(texid);
+		JRenderState::GetInstance()->SetTextureFilter(tex, GL_LINEAR, GL_LINEAR);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+		JRenderState::GetInstance()->CountUpload(size);
 
 		delete buffer;
 
@@ -210,6 +504,8 @@ JTexture* JRenderer::CreateTexture(int width, int height )
 
 void JRenderer::ClearScreen(PIXEL_TYPE color)
 {
+	FlushBatch();
+
 	JColor col;
 	col.color = color;
 	glClearColor(col.r / 255.f, 
@@ -219,35 +515,137 @@ void JRenderer::ClearScreen(PIXEL_TYPE color)
 	glClear (GL_COLOR_BUFFER_BIT);
 }
 
-void JRenderer::SetTexBlend(int src, int dest)
+JTexture* JRenderer::CreateRenderTarget(int width, int height)
 {
-	if (src != mCurrTexBlendSrc || dest != mCurrTexBlendDest)
+	JTexture *tex = new JTexture();
+	tex->mWidth = width;
+	tex->mHeight = height;
+	tex->mTexWidth = width;
+	tex->mTexHeight = height;
+
+	GLuint texid;
+	glGenTextures(1, &texid);
+	tex->mTexId = texid;
+
+	JRenderState *renderState = JRenderState::GetInstance();
+	renderState->BindTexture(texid);
+	renderState->SetTextureFilter(tex, GL_LINEAR, GL_LINEAR);
+	renderState->SetTextureWrap(tex, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	tex->mFramebufferId = fbo;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texid, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	JTexture *current = GetRenderTarget();
+	glBindFramebuffer(GL_FRAMEBUFFER, current ? current->mFramebufferId : 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
 	{
-		mCurrTexBlendSrc = src;
-		mCurrTexBlendDest = dest;
-		
-		glBlendFunc(src, dest);
+		delete tex;
+		return NULL;
 	}
-}
 
+	return tex;
+}
 
-void JRenderer::SetTexBlendSrc(int src)
+void JRenderer::BeginRenderTarget(JTexture *target, bool clear)
 {
-	if (src != mCurrTexBlendSrc)
+	FlushBatch();
+
+	// the screen viewport may follow the window, as in the emscripten example
+	if (mRenderTargets.empty())
 	{
-		mCurrTexBlendSrc = src;
-		glBlendFunc(mCurrTexBlendSrc, mCurrTexBlendDest);
+		glGetIntegerv(GL_VIEWPORT, mScreenViewport);
+		mScreenProjection = mProjection;
+		mScreenViewWidth = mViewWidth;
+		mScreenViewHeight = mViewHeight;
+	}
+
+	mRenderTargets.push_back(target);
+	BindRenderTarget(target);
+
+	if (clear)
+	{
+		// Enable2D leaves scissoring on, which would clip the clear to the screen box
+		GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+		if (scissor)
+			glDisable(GL_SCISSOR_TEST);
+
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		if (scissor)
+			glEnable(GL_SCISSOR_TEST);
 	}
 }
 
+void JRenderer::EndRenderTarget()
+{
+	if (mRenderTargets.empty())
+		return;
 
-void JRenderer::SetTexBlendDest(int dest)
+	FlushBatch();
+
+	mRenderTargets.pop_back();
+	BindRenderTarget(GetRenderTarget());
+}
+
+void JRenderer::BindRenderTarget(JTexture *target)
 {
-	if (dest != mCurrTexBlendDest)
+	if (target)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, target->mFramebufferId);
+		glViewport(0, 0, target->mTexWidth, target->mTexHeight);
+
+		// bottom-up, so that the first row of the texture is the top of the drawing
+		mProjection = glm::ortho(0.0f, (float)target->mTexWidth, 0.0f, (float)target->mTexHeight, -1.0f, 1.0f);
+		mViewWidth = (float)target->mTexWidth;
+		mViewHeight = (float)target->mTexHeight;
+	}
+	else
 	{
-		mCurrTexBlendDest = dest;
-		glBlendFunc(mCurrTexBlendSrc, mCurrTexBlendDest);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(mScreenViewport[0], mScreenViewport[1], mScreenViewport[2], mScreenViewport[3]);
+
+		mProjection = mScreenProjection;
+		mViewWidth = mScreenViewWidth;
+		mViewHeight = mScreenViewHeight;
 	}
+
+	for (int i = 0; i < PROJECTED_SHADERS; i++)
+		SetShaderProjection(i, mProjection);
+}
+
+void JRenderer::SetShaderProjection(int shader, const glm::mat4 &projection)
+{
+	JResourceManager::GetShader(mProjectedShaders[shader]).Set(mProjectionUniforms[shader], projection, true);
+}
+
+void JRenderer::SetTexBlend(int src, int dest)
+{
+	mCurrTexBlendSrc = src;
+	mCurrTexBlendDest = dest;
+
+	// queued commands carry their own blending
+	if (!mRenderQueueEnabled)
+		ApplyTexBlend(src, dest);
+}
+
+
+void JRenderer::SetTexBlendSrc(int src)
+{
+	SetTexBlend(src, mCurrTexBlendDest);
+}
+
+
+void JRenderer::SetTexBlendDest(int dest)
+{
+	SetTexBlend(mCurrTexBlendSrc, dest);
 }
 
 
@@ -261,98 +659,312 @@ void JRenderer::RenderQuad(JQuad* quad, float xo, float yo, float angle, float x
 {
     static JSprite sprite;
 
-    const float colorNormalization = 1.0f / 255.0f;
-
-    sprite.texture = quad->mTex;
-    sprite.spriteRect = {quad->mX, quad->mY, quad->mWidth, quad->mHeight};
-    sprite.position = {xo, yo};
-    sprite.hotspot = {quad->mHotSpotX, quad->mHotSpotY};
-    sprite.scale = {xScale, yScale};
-    sprite.rotate = angle;
-    sprite.hFlipped = quad->mHFlipped;
-    sprite.vFlipped = quad->mVFlipped;
-    sprite.color = glm::vec4(quad->mColor.r, quad->mColor.g, quad->mColor.b, quad->mColor.a) * colorNormalization;
+    JSpriteRenderer::SetSprite(quad, xo, yo, angle, xScale, yScale, sprite);
     sprite.textureFilter = mCurrentTextureFilter;
 
-    mSpriteRenderer->DrawSprite(sprite);
+    if (mCullingEnabled)
+    {
+        float bounds[4];
+        JSpriteRenderer::GetBounds(sprite, bounds);
+        if (bounds[2] <= 0.0f || bounds[3] <= 0.0f || bounds[0] >= mViewWidth || bounds[1] >= mViewHeight)
+        {
+            JRenderState::GetInstance()->CountCulled();
+            return;
+        }
+    }
+
+    if (mRenderQueueEnabled)
+    {
+        mRenderQueue->AddSprite(sprite, mCurrTexBlendSrc, mCurrTexBlendDest);
+        return;
+    }
+
+    BeginSprites();
+
+    switch (mSpriteBackend)
+    {
+    case SPRITE_BACKEND_BATCHED:
+        mSpriteRenderer->AddSprite(sprite);
+        break;
+    case SPRITE_BACKEND_INSTANCED:
+        mSpriteRenderer->AddSpriteInstance(sprite);
+        break;
+    default:
+        mSpriteRenderer->DrawSprite(sprite);
+        break;
+    }
 }
 
-// void JRenderer::RenderQuadBatch(JQuad* quad, float xo, float yo, float angle, float xScale, float yScale)
-// {
-//     static JSprite sprite;
+void JRenderer::RenderQuads(JTexture *texture, const JSpriteVertex *vertices, int quadCount)
+{
+    if (quadCount <= 0)
+        return;
+
+    if (mCullingEnabled)
+    {
+        float left = vertices[0].x, top = vertices[0].y;
+        float right = left, bottom = top;
+        for (int i = 1; i < quadCount * 4; i++)
+        {
+            left = std::min(left, vertices[i].x);
+            top = std::min(top, vertices[i].y);
+            right = std::max(right, vertices[i].x);
+            bottom = std::max(bottom, vertices[i].y);
+        }
+
+        if (right <= 0.0f || bottom <= 0.0f || left >= mViewWidth || top >= mViewHeight)
+        {
+            JRenderState *renderState = JRenderState::GetInstance();
+            for (int i = 0; i < quadCount; i++)
+                renderState->CountCulled();
+            return;
+        }
+    }
+
+    if (mRenderQueueEnabled)
+    {
+        mRenderQueue->AddQuads(texture, mCurrentTextureFilter, vertices, quadCount, mCurrTexBlendSrc, mCurrTexBlendDest);
+        return;
+    }
 
-//     const float colorNormalization = 1.0f / 255.0f;
+    BeginSprites();
 
-//     sprite.texture = quad->mTex;
-//     sprite.spriteRect = {quad->mX, quad->mY, quad->mWidth, quad->mHeight};
-//     sprite.position = {xo, yo};
-//     sprite.hotspot = {quad->mHotSpotX, quad->mHotSpotY};
-//     sprite.scale = {xScale, yScale};
-//     sprite.rotate = angle;
-//     sprite.hFlipped = quad->mHFlipped;
-//     sprite.vFlipped = quad->mVFlipped;
-//     sprite.color = glm::vec4(quad->mColor.r, quad->mColor.g, quad->mColor.b, quad->mColor.a) * colorNormalization;
-//     sprite.textureFilter = mCurrentTextureFilter;
+    for (int i = 0; i < quadCount; i++)
+        mSpriteRenderer->AddQuad(texture, mCurrentTextureFilter, vertices + i * 4);
 
-//     //mSpriteRenderer->DrawSprite(sprite);
-// 	mSpriteBatch.push_back(sprite);
-// }
+    // the other backends draw right away, keep the order with what follows
+    if (mSpriteBackend != SPRITE_BACKEND_BATCHED)
+        mSpriteRenderer->Flush();
+}
 
 void JRenderer::DrawPolygon(float* x, float* y, int count, PIXEL_TYPE color, GLenum mode)
 {
-    JShader shader = JResourceManager::GetShader("simple").Use();
+    SubmitPrimitive(mode, x, y, count, color, mPrimitiveBatcher->GetLineWidth());
+}
 
-    int buf_size = 2 * count; // 2 coordinates per vertex
-    GLfloat vertices[buf_size]; 
-    for (int i = 0; i < count; i++) {
-        vertices[2 * i] = x[i];
-        vertices[2 * i + 1] = y[i];
+void JRenderer::SubmitPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color, float lineWidth)
+{
+    if (count > PRIMITIVE_BATCH_MAX_VERTICES)
+    {
+        SubmitSplitPrimitive(mode, x, y, count, color, lineWidth);
+        return;
     }
 
-    if (buf_size > bufferSize) {
-        printf("Vertex buffer too small! \n");
+    if (mRenderQueueEnabled)
+    {
+        mRenderQueue->AddPrimitive(mode, x, y, count, color, lineWidth, mCurrTexBlendSrc, mCurrTexBlendDest);
+        return;
+    }
+
+    BeginPrimitives();
+    mPrimitiveBatcher->SetLineWidth(lineWidth);
+    mPrimitiveBatcher->AddPrimitive(mode, x, y, count, color);
+}
+
+void JRenderer::SubmitSplitPrimitive(GLenum mode, const float *x, const float *y, int count, PIXEL_TYPE color, float lineWidth)
+{
+    const int maxVertices = PRIMITIVE_BATCH_MAX_VERTICES;
+
+    if (mode == GL_TRIANGLE_FAN)
+    {
+        // every piece starts from the first vertex and shares its last edge with the next one
+        static std::vector<float> pieceX;
+        static std::vector<float> pieceY;
+
+        for (int first = 1; first < count - 1; first += maxVertices - 2)
+        {
+            int size = std::min(count - first, maxVertices - 1);
+            pieceX.assign(1, x[0]);
+            pieceY.assign(1, y[0]);
+            pieceX.insert(pieceX.end(), x + first, x + first + size);
+            pieceY.insert(pieceY.end(), y + first, y + first + size);
+            SubmitPrimitive(GL_TRIANGLE_FAN, &pieceX[0], &pieceY[0], size + 1, color, lineWidth);
+        }
+        return;
+    }
+
+    // strips share their last vertices with the next piece, lists are cut between whole primitives
+    int overlap = 0;
+    int step = maxVertices;
+    switch (mode)
+    {
+    case GL_TRIANGLE_STRIP:
+        overlap = 2;    // an even step keeps the winding of the pieces
+        break;
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        overlap = 1;
+        break;
+    case GL_TRIANGLES:
+        step -= maxVertices % 3;
+        break;
+    case GL_LINES:
+        step -= maxVertices % 2;
+        break;
+    }
+
+    GLenum pieceMode = mode == GL_LINE_LOOP ? GL_LINE_STRIP : mode;
+    for (int first = 0; first + overlap < count; first += step - overlap)
+        SubmitPrimitive(pieceMode, x + first, y + first, std::min(count - first, step), color, lineWidth);
+
+    if (mode == GL_LINE_LOOP)
+    {
+        float closeX[2] = { x[count - 1], x[0] };
+        float closeY[2] = { y[count - 1], y[0] };
+        SubmitPrimitive(GL_LINES, closeX, closeY, 2, color, lineWidth);
+    }
+}
+
+void JRenderer::DrawPolyline(const float* x, const float* y, int count, float width, PIXEL_TYPE color, int join, int cap, bool closed)
+{
+    static std::vector<float> stripX;
+    static std::vector<float> stripY;
+
+    JStroker::Stroke(x, y, count, width, join, cap, closed, stripX, stripY);
+    if (!stripX.empty())
+        DrawStrip(&stripX[0], &stripY[0], (int)stripX.size(), color);
+}
+
+void JRenderer::DrawStrokedPath(const JStrokedPath &path, PIXEL_TYPE color)
+{
+    DrawStrip(path.GetX(), path.GetY(), path.GetVertexCount(), color);
+}
+
+void JRenderer::RenderStaticMesh(JStaticMesh *mesh, float x, float y, float angle, float xScale, float yScale)
+{
+    FlushBatch();
+
+    bool transformed = x != 0.0f || y != 0.0f || angle != 0.0f || xScale != 1.0f || yScale != 1.0f;
+    if (transformed)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+        model = glm::rotate(model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
+        model = glm::scale(model, glm::vec3(xScale, yScale, 1.0f));
+
+        // the mesh shaders have no model matrix, it goes into their projection
+        glm::mat4 projection = mProjection * model;
+        SetShaderProjection(PROJECTED_PRIMITIVE, projection);
+        SetShaderProjection(PROJECTED_SPRITE_BATCH, projection);
     }
 
-    JColor col;
-    col.color = color;
-    glUniform4f(colorUniformLoc, 
-                col.r / 255.f, 
-                col.g / 255.f, 
-                col.b / 255.f, 
-                col.a / 255.f);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, buf_size * sizeof(GLfloat), vertices, GL_DYNAMIC_DRAW);
-    
-    GLint vertexLocation = glGetAttribLocation(shader.Program, "vertex");
-    glEnableVertexAttribArray(vertexLocation);
-    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    mesh->Draw();
 
-    glDrawArrays(mode, 0, count);
+    if (transformed)
+    {
+        SetShaderProjection(PROJECTED_PRIMITIVE, mProjection);
+        SetShaderProjection(PROJECTED_SPRITE_BATCH, mProjection);
+    }
+}
 
-    glDisableVertexAttribArray(vertexLocation);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void JRenderer::DrawStrip(const float *x, const float *y, int count, PIXEL_TYPE color)
+{
+    // strips longer than a batch go out in pieces sharing their last pair
+    SubmitPrimitive(GL_TRIANGLE_STRIP, x, y, count, color, mPrimitiveBatcher->GetLineWidth());
 }
 
 void JRenderer::DrawPolygon(float x, float y, float size, int count, float startingAngle, PIXEL_TYPE color, GLenum mode)
 {
-	float angle = -startingAngle*RAD2DEG;
-	float steps = 360.0f/count;
+	if (count < 3)
+		return;
+
+	// too many sides for the indexed unit shapes, drawn in pieces
+	if (count > PRIMITIVE_BATCH_MAX_VERTICES)
+	{
+		std::vector<float> vertices_x(count);
+		std::vector<float> vertices_y(count);
+		for (int i=0; i<count; i++)
+		{
+			float angle = 2.0f*M_PI*i/count - startingAngle;
+			vertices_x[i] = x + size*cosf(angle);
+			vertices_y[i] = y + size*sinf(angle);
+		}
+		DrawPolygon(&vertices_x[0], &vertices_y[0], count, color, mode);
+		return;
+	}
+
+	const UnitShape &shape = GetUnitShape(count);
 
-	float vertices_x[count];
-	float vertices_y[count];
+	// rotate the unit shape once instead of evaluating sin/cos per vertex
+	float c = size*cosf(-startingAngle);
+	float s = size*sinf(-startingAngle);
 
-	for(int i=0; i<count;i++)
+	static std::vector<JColorVertex> vertices;
+	vertices.resize(count);
+
+	GLuint rgba = ARGB_TO_RGBA8(color);
+	for (int i=0; i<count; i++)
+	{
+		float ux = shape.cosSin[i*2];
+		float uy = shape.cosSin[i*2+1];
+		vertices[i].x = x + c*ux - s*uy;
+		vertices[i].y = y + s*ux + c*uy;
+		vertices[i].color = rgba;
+	}
+
+	if (mode == GL_TRIANGLE_FAN)
+		DrawIndexed(GL_TRIANGLES, &vertices[0], count, &shape.fillIndices[0], (int)shape.fillIndices.size());
+	else if (mode == GL_LINE_LOOP)
+		DrawIndexed(GL_LINES, &vertices[0], count, &shape.outlineIndices[0], (int)shape.outlineIndices.size());
+	else
 	{
-		vertices_x[i] = x+size*COSF((int)angle);
-		vertices_y[i] = y+size*SINF((int)angle);
+		float vertices_x[count];
+		float vertices_y[count];
+		for (int i=0; i<count; i++)
+		{
+			vertices_x[i] = vertices[i].x;
+			vertices_y[i] = vertices[i].y;
+		}
+		DrawPolygon(vertices_x, vertices_y, count, color, mode);
+	}
+}
+
+const JRenderer::UnitShape& JRenderer::GetUnitShape(int count)
+{
+	std::map<int, UnitShape>::iterator it = mUnitShapes.find(count);
+	if (it != mUnitShapes.end())
+		return it->second;
+
+	UnitShape &shape = mUnitShapes[count];
+	shape.cosSin.resize(count*2);
+	for (int i=0; i<count; i++)
+	{
+		float angle = 2.0f*M_PI*i/count;
+		shape.cosSin[i*2] = cosf(angle);
+		shape.cosSin[i*2+1] = sinf(angle);
+	}
+
+	for (int i=1; i<count-1; i++)
+	{
+		shape.fillIndices.push_back(0);
+		shape.fillIndices.push_back(i);
+		shape.fillIndices.push_back(i+1);
+	}
 
-		angle += steps;
-		if (angle >= 360.0f)
-			angle -= 360.0f;
+	for (int i=0; i<count; i++)
+	{
+		shape.outlineIndices.push_back(i);
+		shape.outlineIndices.push_back((i+1) % count);
 	}
 
-	DrawPolygon(vertices_x, vertices_y, count, color, mode);
+	return shape;
+}
+
+int JRenderer::GetCircleSegments(float radius)
+{
+	if (radius <= CIRCLE_TOLERANCE)
+		return CIRCLE_MIN_SEGMENTS;
+
+	// a chord of angle a strays r*(1-cos(a/2)) from the circle
+	int segments = (int)ceilf(M_PI / acosf(1.0f - CIRCLE_TOLERANCE/radius));
+
+	// multiples of 4 keep circles symmetric and share unit tables
+	segments = (segments + 3) & ~3;
+
+	if (segments < CIRCLE_MIN_SEGMENTS)
+		return CIRCLE_MIN_SEGMENTS;
+	if (segments > CIRCLE_MAX_SEGMENTS)
+		return CIRCLE_MAX_SEGMENTS;
+	return segments;
 }
 
 void JRenderer::FillRect(float x, float y, float width, float height, PIXEL_TYPE color)
@@ -372,30 +984,10 @@ void JRenderer::DrawRect(float x, float y, float width, float height, PIXEL_TYPE
 
 void JRenderer::DrawLine(float x1, float y1, float x2, float y2, PIXEL_TYPE color)
 {
-    GLfloat vertices[] = { x1, y1, x2, y2 };
-    glLineWidth(2.0f);
-
-    JShader shader = JResourceManager::GetShader("simple").Use();
+    float x[] = { x1, x2 };
+    float y[] = { y1, y2 };
 
-    JColor col;
-    col.color = color;
-    glUniform4f(colorUniformLoc, 
-                col.r / 255.f, 
-                col.g / 255.f, 
-                col.b / 255.f, 
-                col.a / 255.f);
-
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
-    
-    GLint vertexLocation = glGetAttribLocation(shader.Program, "vertex");
-    glEnableVertexAttribArray(vertexLocation);
-    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-    glDrawArrays(GL_LINES, 0, 2);
-
-    glDisableVertexAttribArray(vertexLocation);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    SubmitPrimitive(GL_LINES, x, y, 2, color, 2.0f);
 }
 
 void JRenderer::DrawLine(float x1, float y1, float x2, float y2, float lineWidth, PIXEL_TYPE color)
@@ -428,37 +1020,93 @@ void JRenderer::DrawLine(float x1, float y1, float x2, float y2, float lineWidth
 void JRenderer::FillPolygon(float* x, float* y, int count, PIXEL_TYPE color, bool convex)
 {
     if (convex) {
-        JShader shader = JResourceManager::GetShader("simple").Use();
-        
-        int buf_size = 2 * count;
-        GLfloat vertices[buf_size]; 
-        for (int i = 0; i < count; i++) {
-            vertices[2 * i] = x[i];
-            vertices[2 * i + 1] = y[i];
+        DrawPolygon(x, y, count, color, GL_TRIANGLE_FAN);
+    } else {
+        FillPolygon(x, y, &count, 1, color);
+    }
+}
+
+void JRenderer::FillPolygon(const float* x, const float* y, const int* ringCounts, int ringCount, PIXEL_TYPE color)
+{
+    const std::vector<GLushort> &indices = mTriangulator.Triangulate(x, y, ringCounts, ringCount);
+    if (indices.empty())
+        return;
+
+    int count = 0;
+    for (int i = 0; i < ringCount; i++)
+        count += ringCounts[i];
+
+    static std::vector<JColorVertex> vertices;
+    vertices.resize(count);
+
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    for (int i = 0; i < count; i++)
+    {
+        vertices[i].x = x[i];
+        vertices[i].y = y[i];
+        vertices[i].color = rgba;
+    }
+
+    DrawIndexed(GL_TRIANGLES, &vertices[0], count, &indices[0], (int)indices.size());
+}
+
+void JRenderer::DrawIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount)
+{
+    if (vertexCount > PRIMITIVE_BATCH_MAX_VERTICES)
+    {
+        DrawSplitIndexed(mode, vertices, vertexCount, indices, indexCount);
+        return;
+    }
+
+    if (mRenderQueueEnabled)
+    {
+        mRenderQueue->AddIndexed(mode, vertices, vertexCount, indices, indexCount, mPrimitiveBatcher->GetLineWidth(),
+                                 mCurrTexBlendSrc, mCurrTexBlendDest);
+        return;
+    }
+
+    BeginPrimitives();
+    mPrimitiveBatcher->AddIndexed(mode, vertices, vertexCount, indices, indexCount);
+}
+
+void JRenderer::DrawSplitIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount)
+{
+    // pieces of whole triangles or lines, their vertices copied and renumbered
+    static std::vector<int> pieceIndex;
+    static std::vector<JColorVertex> pieceVertices;
+    static std::vector<GLushort> pieceIndices;
+
+    int primitiveSize = mode == GL_TRIANGLES ? 3 : (mode == GL_LINES ? 2 : 1);
+    pieceIndex.assign(vertexCount, -1);
+    pieceVertices.clear();
+    pieceIndices.clear();
+
+    for (int first = 0; first + primitiveSize <= indexCount; first += primitiveSize)
+    {
+        if ((int)pieceVertices.size() + primitiveSize > PRIMITIVE_BATCH_MAX_VERTICES)
+        {
+            DrawIndexed(mode, &pieceVertices[0], (int)pieceVertices.size(), &pieceIndices[0], (int)pieceIndices.size());
+
+            for (size_t i = 0; i < pieceIndices.size(); i++)
+                pieceIndex[indices[first - pieceIndices.size() + i]] = -1;
+            pieceVertices.clear();
+            pieceIndices.clear();
         }
 
-        JColor col;
-        col.color = color;
-        glUniform4f(colorUniformLoc, 
-                    col.r / 255.f, 
-                    col.g / 255.f, 
-                    col.b / 255.f, 
-                    col.a / 255.f);
-
-        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-        glBufferData(GL_ARRAY_BUFFER, buf_size * sizeof(GLfloat), vertices, GL_DYNAMIC_DRAW);
-        
-        GLint vertexLocation = glGetAttribLocation(shader.Program, "vertex");
-        glEnableVertexAttribArray(vertexLocation);
-        glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glDrawArrays(GL_TRIANGLE_FAN, 0, count);
-
-        glDisableVertexAttribArray(vertexLocation);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    } else {
-        std::cerr << "Non-convex polygon handling is not implemented in this version." << std::endl;
+        for (int i = first; i < first + primitiveSize; i++)
+        {
+            int &index = pieceIndex[indices[i]];
+            if (index < 0)
+            {
+                index = (int)pieceVertices.size();
+                pieceVertices.push_back(vertices[indices[i]]);
+            }
+            pieceIndices.push_back((GLushort)index);
+        }
     }
+
+    if (!pieceIndices.empty())
+        DrawIndexed(mode, &pieceVertices[0], (int)pieceVertices.size(), &pieceIndices[0], (int)pieceIndices.size());
 }
 
 void JRenderer::FillPolygon(float x, float y, float size, int count, float startingAngle, PIXEL_TYPE color)
@@ -468,10 +1116,10 @@ void JRenderer::FillPolygon(float x, float y, float size, int count, float start
 
 void JRenderer::DrawCircle(float x, float y, float radius, PIXEL_TYPE color)
 {
-	DrawPolygon(x, y, radius, 180, 0, color);
+	DrawPolygon(x, y, radius, GetCircleSegments(radius), 0, color);
 }
 
 void JRenderer::FillCircle(float x, float y, float radius, PIXEL_TYPE color)
 {
-	FillPolygon(x, y, radius, 180, 0, color);
+	FillPolygon(x, y, radius, GetCircleSegments(radius), 0, color);
 }
\ No newline at end of file
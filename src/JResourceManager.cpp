@@ -1,132 +1,696 @@
 #include "../include/JResourceManager.h"
 
 #include <iostream>
-#include <sstream>
-#include <fstream>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <libpng16/png.h>
 #include "../include/JFileSystem.h"
+#include "../include/JRenderState.h"
+#include "../include/JAtlasFormat.h"
+#include "../include/JTextureDecoder.h"
+#include "../include/JTextureLoader.h"
+
+std::vector<JShader> JResourceManager::Shaders;
+std::map<std::string, int> JResourceManager::ShaderIds;
+std::map<JResourceManager::TextureKey, JResourceManager::CachedTexture> JResourceManager::Textures;
+std::map<JTexture*, JResourceManager::TextureKey> JResourceManager::TextureKeys;
+std::string JResourceManager::ShaderCacheDir;
+JTextureStats JResourceManager::TextureStats;
+std::vector<GLint> JResourceManager::CompressedFormats;
+bool JResourceManager::CompressedFormatsQueried = false;
+int JResourceManager::NPOTSupport = -1;
+
+// Header of the program binary cache files, followed by the binary.
+struct JProgramCacheHeader
+{
+	char magic[4];		// "JGPB"
+	GLenum format;		// binary format of the driver
+	uint32_t length;
+};
+
+// Header of KTX 1.1 files, followed by key and value data then by the levels, each after its size in a 32 bit word.
+struct JKTXHeader
+{
+	unsigned char identifier[12];
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+};
+
+static const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Largest ktx width and height taken, the texture size limit of the targets. Keeps level and decoded sizes far from wrapping.
+#define KTX_MAX_SIZE	16384
+
+// Compressed variants tried by LoadCompressedTexture, in order.
+static const char *COMPRESSED_SUFFIXES[] = { ".bc.ktx", ".etc2.ktx", ".etc1.ktx" };
+
+static int getNextPower2(int width)
+{
+	int b = width;
+	int n;
+	for (n = 0; b != 0; n++) b >>= 1;
+	b = 1 << n;
+	if (b == 2 * width) b >>= 1;
+	return b;
+}
+
+static uint64_t HashString(uint64_t hash, const char *text)
+{
+	// FNV-1a, the terminating zero included so that strings stay apart
+	do
+	{
+		hash ^= (unsigned char)*text;
+		hash *= 1099511628211ull;
+	} while (*text++);
 
-std::map<std::string, JShader> JResourceManager::Shaders;
+	return hash;
+}
+
+JShader& JResourceManager::LoadShader(const GLchar * vShaderFile, const GLchar * fShaderFile, const GLchar * gShaderFile, std::string name)
+{
+	int id = GetShaderId(name);
+	if (id < 0)
+	{
+		id = (int)Shaders.size();
+		ShaderIds[name] = id;
+		Shaders.push_back(JShader());
+	}
+
+	Shaders[id] = LoadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
+	Shaders[id].Id = id;
+	return Shaders[id];
+}
 
-JShader JResourceManager::LoadShader(const GLchar * vShaderFile, const GLchar * fShaderFile, const GLchar * gShaderFile, std::string name)
+JShader& JResourceManager::GetShader(const std::string &name)
 {
-	Shaders[name] = LoadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
-	return Shaders[name];
+	static JShader none;
+
+	int id = GetShaderId(name);
+	return id >= 0 ? Shaders[id] : none;
 }
 
-JShader JResourceManager::GetShader(std::string name)
+int JResourceManager::GetShaderId(const std::string &name)
 {
-	return Shaders[name];
+	std::map<std::string, int>::const_iterator it = ShaderIds.find(name);
+	return it != ShaderIds.end() ? it->second : -1;
 }
 
 void JResourceManager::Clear()
 {
 	// (Properly) delete all shaders	
-	for (auto iter : Shaders)
-		glDeleteProgram(iter.second.Program);
+	for (size_t i = 0; i < Shaders.size(); i++)
+		JRenderState::GetInstance()->DeleteProgram(Shaders[i].Program);
+
+	// cached textures go too, whatever their references
+	for (std::map<TextureKey, CachedTexture>::iterator it = Textures.begin(); it != Textures.end(); ++it)
+		delete it->second.mTexture;
+	Textures.clear();
+	TextureKeys.clear();
 }
 
 JShader JResourceManager::LoadShaderFromFile(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile)
 {
-	// 1. Retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	try
+	// 1. Retrieve the vertex/fragment source code, relative to the resource root
+	JFileSystem *fileSystem = JFileSystem::GetInstance();
+	std::vector<unsigned char> vertexData, fragmentData;
+	if (!fileSystem->ReadWholeFile(vShaderFile, vertexData) || !fileSystem->ReadWholeFile(fShaderFile, fragmentData))
+		std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+
+	std::string vertexCode(vertexData.begin(), vertexData.end());
+	std::string fragmentCode(fragmentData.begin(), fragmentData.end());
+
+	// 2. Take the binary saved by an earlier run, if the driver still accepts it
+	JShader shader;
+	std::string cacheFile;
+	if (!ShaderCacheDir.empty())
+	{
+		cacheFile = GetProgramCacheFile(vertexCode, fragmentCode);
+		if (LoadProgramBinary(shader, cacheFile))
+			return shader;
+	}
+
+	// 3. Now create shader object from source code
+	shader.Compile(vertexCode.c_str(), fragmentCode.c_str());
+
+	if (!cacheFile.empty())
+		SaveProgramBinary(shader, cacheFile);
+	return shader;
+}
+
+std::string JResourceManager::GetProgramCacheFile(const std::string &vertexCode, const std::string &fragmentCode)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashString(hash, vertexCode.c_str());
+	hash = HashString(hash, fragmentCode.c_str());
+
+	// binaries do not survive driver updates
+	GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i = 0; i < 3; i++)
 	{
-		// Open files
-		std::ifstream vertexShaderFile(vShaderFile);
-		std::ifstream fragmentShaderFile(fShaderFile);
-		std::stringstream vShaderStream, fShaderStream;
-		// Read file's buffer contents into streams
-		vShaderStream << vertexShaderFile.rdbuf();
-		fShaderStream << fragmentShaderFile.rdbuf();
-		// close file handlers
-		vertexShaderFile.close();
-		fragmentShaderFile.close();
-		// Convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		const GLubyte *driver = glGetString(driverStrings[i]);
+		hash = HashString(hash, driver ? (const char*)driver : "");
 	}
-	catch (std::exception e)
+
+	char name[32];
+	sprintf(name, "%016llx.bin", (unsigned long long)hash);
+	return ShaderCacheDir + name;
+}
+
+bool JResourceManager::LoadProgramBinary(JShader &shader, const std::string &file)
+{
+	FILE *in = fopen(file.c_str(), "rb");
+	if (in == NULL)
+		return false;
+
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+
+	JProgramCacheHeader header;
+	std::vector<unsigned char> binary;
+
+	// the length is checked against the file before allocating, a damaged file must not abort the start
+	bool valid = size >= (long)sizeof(header) && fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "JGPB", 4) == 0 &&
+		header.length > 0 && header.length <= (unsigned long)size - sizeof(header);
+	if (valid)
 	{
-		std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+		binary.resize(header.length);
+		valid = fread(&binary[0], 1, header.length, in) == header.length;
 	}
-	const GLchar *vShaderCode = vertexCode.c_str();
-	const GLchar *fShaderCode = fragmentCode.c_str();
-	// 2. Now create shader object from source code
-	JShader shader;
-	shader.Compile(vShaderCode, fShaderCode);
-	return shader;
+	fclose(in);
+
+	if (!valid)
+		return false;
+
+	// a rejected binary is overwritten once the sources are compiled
+	return shader.LoadBinary(header.format, &binary[0], (GLsizei)header.length);
 }
 
-JTexture* JResourceManager::LoadTextureFromFile(const char* filename)
+void JResourceManager::SaveProgramBinary(const JShader &shader, const std::string &file)
 {
-	TextureInfo textureInfo;
-	
-	textureInfo.mBits = NULL;
-	
-	if( !LoadPNG(textureInfo, filename) )
-		printf("Failed to load png %s \n", filename);
+	JProgramCacheHeader header;
+	std::vector<unsigned char> binary;
+	if (!shader.GetBinary(header.format, binary))
+		return;
+
+	memcpy(header.magic, "JGPB", 4);
+	header.length = (uint32_t)binary.size();
+
+	FILE *out = fopen(file.c_str(), "wb");
+	if (out == NULL)
+		return;
+
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(&binary[0], 1, binary.size(), out) == binary.size();
+	fclose(out);
+
+	// no partial file for the next run to trip on
+	if (!written)
+		remove(file.c_str());
+}
 
-	if (textureInfo.mBits == NULL)
+JTexture* JResourceManager::LoadTextureFromFile(const char* filename, int flags)
+{
+	TextureData data;
+	if (!ReadTexture(filename, flags, data))
 	{
 		printf("Failed to load texture %s \n", filename);
 		return NULL;
 	}
 
-	bool ret = false;
+	return CreateTexture(data, filename);
+}
+
+bool JResourceManager::ReadTexture(const char *filename, int flags, TextureData &data)
+{
+	if (!JFileSystem::GetInstance()->ReadWholeFile(filename, data.mFile))
+		return false;
+
+	size_t length = strlen(filename);
+	if (length > 4 && strcmp(filename + length - 4, ".ktx") == 0)
+	{
+		const CompressedInfo &info = data.mCompressed;
+		if (!ParseKTX(data.mFile, data.mCompressed))
+		{
+			printf("Invalid ktx %s \n", filename);
+			return false;
+		}
+
+		// levels are uploaded straight from the file data
+		if (IsCompressedFormatSupported(info.mFormat))
+		{
+			data.mIsCompressed = true;
+			return true;
+		}
+
+		// the GPU lacks the format, the base level is expanded and uploaded as a png is
+		TextureInfo &textureInfo = data.mImage;
+		textureInfo.mWidth = textureInfo.mTexWidth = textureInfo.mTrimWidth = info.mWidth;
+		textureInfo.mHeight = textureInfo.mTexHeight = textureInfo.mTrimHeight = info.mHeight;
+		textureInfo.mTrimX = textureInfo.mTrimY = 0;
+		textureInfo.mBits = new u8[(size_t)info.mWidth * info.mHeight * 4];
+
+		JTextureDecoder::Decode(info.mFormat, info.mLevels[0], info.mWidth, info.mHeight, textureInfo.mBits);
+		data.mIsDecoded = true;
+	}
+	else
+	{
+		bool powerOfTwo = (flags & TEX_LOAD_POT) != 0 || !IsNPOTSupported();
+		if (!LoadPNG(data.mImage, data.mFile, powerOfTwo) || data.mImage.mBits == NULL)
+		{
+			printf("Failed to load png %s \n", filename);
+			return false;
+		}
+
+		if (flags & TEX_LOAD_TRIM)
+			TrimImage(data.mImage, powerOfTwo);
+	}
+
+	std::vector<unsigned char>().swap(data.mFile);
+	return true;
+}
+
+JTexture* JResourceManager::CreateTexture(const TextureData &data, const char *filename)
+{
+	GLuint texid;
+	glGenTextures(1, &texid);
+	if (texid == 0)
+	{
+		printf("Failed to load texture %s \n", filename);
+		return NULL;
+	}
 
 	JTexture *tex = new JTexture();
+	tex->mTexId = texid;
+	UploadTexture(tex, data);
+
+	return tex;
+}
+
+void JResourceManager::UploadTexture(JTexture *tex, const TextureData &data)
+{
+	JRenderState *renderState = JRenderState::GetInstance();
+	renderState->BindTexture(tex->mTexId);
+
+	// renderState->SetTextureWrap(tex, GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT);
+	renderState->SetTextureWrap(tex, GL_REPEAT, GL_REPEAT);
+	renderState->SetTextureFilter(tex, GL_LINEAR, GL_LINEAR);
+
+	if (data.mIsCompressed)
+	{
+		const CompressedInfo &info = data.mCompressed;
+
+		tex->mWidth = tex->mTexWidth = tex->mTrimWidth = info.mWidth;
+		tex->mHeight = tex->mTexHeight = tex->mTrimHeight = info.mHeight;
+		tex->mTrimX = tex->mTrimY = 0;
+		tex->mTrimmed = false;
+		tex->mFormat = info.mFormat;
+		tex->mMemory = 0;
+
+		// levels missing from the file cannot be generated from compressed data
+		int uncompressed = 0;
+		for (size_t level = 0; level < info.mLevels.size(); level++)
+		{
+			int width = info.mWidth >> level > 0 ? info.mWidth >> level : 1;
+			int height = info.mHeight >> level > 0 ? info.mHeight >> level : 1;
+
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, info.mFormat, width, height, 0, info.mLevelSizes[level], info.mLevels[level]);
+			renderState->CountUpload(info.mLevelSizes[level]);
+
+			tex->mMemory += info.mLevelSizes[level];
+			uncompressed += getNextPower2(width) * getNextPower2(height) * sizeof(PIXEL_TYPE);
+		}
+
+		tex->mMemorySaved = uncompressed - tex->mMemory;
+		TextureStats.compressedTextures++;
 
- 	if (tex)
+		// the levels of the file are sampled, not just uploaded
+		tex->mMipmapped = info.mLevels.size() > 1;
+		renderState->SetTextureFilter(tex, true);
+	}
+	else
 	{
+		const TextureInfo &textureInfo = data.mImage;
+
 		tex->mWidth = textureInfo.mWidth;
 		tex->mHeight = textureInfo.mHeight;
 		tex->mTexWidth = textureInfo.mTexWidth;
 		tex->mTexHeight = textureInfo.mTexHeight;
 
-		GLuint texid; 
-		glGenTextures(1, &texid);
-		tex->mTexId = texid;
+		tex->mTrimX = textureInfo.mTrimX;
+		tex->mTrimY = textureInfo.mTrimY;
+		tex->mTrimWidth = textureInfo.mTrimWidth;
+		tex->mTrimHeight = textureInfo.mTrimHeight;
+		tex->mTrimmed = textureInfo.mTrimWidth != textureInfo.mWidth || textureInfo.mTrimHeight != textureInfo.mHeight;
+		tex->mFormat = GL_RGBA;
+		tex->mMipmapped = false;
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureInfo.mTexWidth, textureInfo.mTexHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureInfo.mBits);
+		renderState->CountUpload(textureInfo.mTexWidth * textureInfo.mTexHeight * sizeof(PIXEL_TYPE));
+
+		tex->mMemory = textureInfo.mTexWidth * textureInfo.mTexHeight * sizeof(PIXEL_TYPE);
+		tex->mMemorySaved = getNextPower2(textureInfo.mWidth) * getNextPower2(textureInfo.mHeight) * sizeof(PIXEL_TYPE) - tex->mMemory;
+
+		if (data.mIsDecoded)
+			TextureStats.decodedTextures++;
+	}
+
+	TextureStats.textures++;
+	TextureStats.memory += tex->mMemory;
+	TextureStats.memorySaved += tex->mMemorySaved;
+}
+
+JTexture* JResourceManager::AcquireTexture(const char* filename, int flags, bool async)
+{
+	TextureKey key(NormalizePath(filename), flags);
+
+	std::map<TextureKey, CachedTexture>::iterator it = Textures.find(key);
+	if (it != Textures.end())
+	{
+		it->second.mReferences++;
+		return it->second.mTexture;
+	}
+
+	JTexture *tex;
+	if (async)
+		tex = JTextureLoader::GetInstance()->LoadTexture(key.first.c_str(), flags);
+	else
+		tex = LoadTextureFromFile(key.first.c_str(), flags);
+
+	if (tex == NULL)
+		return NULL;
+
+	CachedTexture &cached = Textures[key];
+	cached.mTexture = tex;
+	cached.mReferences = 1;
+	TextureKeys[tex] = key;
+
+	return tex;
+}
+
+void JResourceManager::ReleaseTexture(JTexture *tex)
+{
+	std::map<JTexture*, TextureKey>::iterator keyIt = TextureKeys.find(tex);
+	if (keyIt == TextureKeys.end())
+		return;
+
+	std::map<TextureKey, CachedTexture>::iterator it = Textures.find(keyIt->second);
+	if (--it->second.mReferences > 0)
+		return;
+
+	// cancels the load of textures still queued
+	delete tex;
+	Textures.erase(it);
+	TextureKeys.erase(keyIt);
+}
+
+void JResourceManager::GetTextureUsage(std::vector<JTextureUsage> &usage)
+{
+	usage.clear();
+	usage.reserve(Textures.size());
+
+	for (std::map<TextureKey, CachedTexture>::const_iterator it = Textures.begin(); it != Textures.end(); ++it)
+	{
+		JTextureUsage entry;
+		entry.name = it->first.first;
+		entry.flags = it->first.second;
+		entry.references = it->second.mReferences;
+		entry.texture = it->second.mTexture;
+		entry.memory = it->second.mTexture->mMemory;
+		entry.memorySaved = it->second.mTexture->mMemorySaved;
+		usage.push_back(entry);
+	}
+}
+
+long JResourceManager::GetCachedTextureMemory()
+{
+	long memory = 0;
+	for (std::map<TextureKey, CachedTexture>::const_iterator it = Textures.begin(); it != Textures.end(); ++it)
+		memory += it->second.mTexture->mMemory;
+
+	return memory;
+}
 
-		if (texid != 0)
+std::string JResourceManager::NormalizePath(const std::string &path)
+{
+	// a device, as in ux0:data/, is kept apart for .. not to climb above it
+	std::string device;
+	size_t colon = path.find(':');
+	if (colon != std::string::npos && colon < path.find_first_of("/\\"))
+		device = path.substr(0, colon + 1);
+
+	std::vector<std::string> parts;
+	std::string part;
+
+	// a trailing separator flushes the last part
+	std::string slashed = path.substr(device.size()) + '/';
+	for (size_t i = 0; i < slashed.size(); i++)
+	{
+		char c = slashed[i] == '\\' ? '/' : slashed[i];
+		if (c != '/')
 		{
-			glBindTexture(GL_TEXTURE_2D, texid);
-
-			// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-			// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureInfo.mTexWidth, textureInfo.mTexHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureInfo.mBits);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			ret = true;
+			part += c;
+			continue;
 		}
+
+		if (part == ".." && !parts.empty() && parts.back() != "..")
+			parts.pop_back();
+		else if (!part.empty() && part != ".")
+			parts.push_back(part);
+		part.clear();
 	}
 
-	delete [] textureInfo.mBits;
+	std::string normalized = device;
+	if (path.size() > device.size() && (path[device.size()] == '/' || path[device.size()] == '\\'))
+		normalized += '/';
 
-	if (!ret)
+	for (size_t i = 0; i < parts.size(); i++)
 	{
-		if (tex)
-			delete tex;
-		tex = NULL;
-		printf("Failed to load texture %s \n", filename);
+		if (i > 0)
+			normalized += '/';
+		normalized += parts[i];
 	}
 
-	return tex;
+	return normalized;
 }
 
-static int getNextPower2(int width)
+JTexture* JResourceManager::LoadCompressedTexture(const char* name)
 {
-	int b = width;
-	int n;
-	for (n = 0; b != 0; n++) b >>= 1;
-	b = 1 << n;
-	if (b == 2 * width) b >>= 1;
-	return b;
+	JFileSystem *fileSystem = JFileSystem::GetInstance();
+
+	std::string fallback;
+
+	for (size_t i = 0; i < sizeof(COMPRESSED_SUFFIXES) / sizeof(COMPRESSED_SUFFIXES[0]); i++)
+	{
+		std::string filename = std::string(name) + COMPRESSED_SUFFIXES[i];
+
+		TextureData data;
+		if (!fileSystem->ReadWholeFile(filename, data.mFile) || !ParseKTX(data.mFile, data.mCompressed))
+			continue;
+
+		if (IsCompressedFormatSupported(data.mCompressed.mFormat))
+		{
+			data.mIsCompressed = true;
+			return CreateTexture(data, filename.c_str());
+		}
+
+		// expanded on the CPU if nothing better turns up
+		if (fallback.empty())
+			fallback = filename;
+	}
+
+	if (!fallback.empty())
+		return LoadTextureFromFile(fallback.c_str());
+
+	return LoadTextureFromFile((std::string(name) + ".png").c_str());
+}
+
+bool JResourceManager::IsCompressedFormatSupported(GLenum format)
+{
+	// asked once, the formats do not change while the context lives
+	if (!CompressedFormatsQueried)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+
+		CompressedFormats.resize(count > 0 ? count : 0);
+		if (count > 0)
+			glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &CompressedFormats[0]);
+
+		CompressedFormatsQueried = true;
+	}
+
+	for (size_t i = 0; i < CompressedFormats.size(); i++)
+		if ((GLenum)CompressedFormats[i] == format)
+			return true;
+
+	return false;
+}
+
+void JResourceManager::ResetTextureStats()
+{
+	memset(&TextureStats, 0, sizeof(TextureStats));
+}
+
+bool JResourceManager::IsNPOTSupported()
+{
+	if (NPOTSupport < 0)
+	{
+		// browsers report WebGL2 as OpenGL ES 3.0, GLES2 drivers may take any size through an extension
+		const char *version = (const char*)glGetString(GL_VERSION);
+		const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+
+		bool supported = version && strstr(version, "OpenGL ES 3") != NULL;
+		if (!supported && extensions)
+			supported = strstr(extensions, "GL_OES_texture_npot") != NULL || strstr(extensions, "GL_ARB_texture_non_power_of_two") != NULL;
+
+		NPOTSupport = supported ? 1 : 0;
+	}
+
+	return NPOTSupport == 1;
+}
+
+bool JResourceManager::ParseKTX(const std::vector<unsigned char> &data, CompressedInfo &info)
+{
+	if (data.size() < sizeof(JKTXHeader))
+		return false;
+
+	const JKTXHeader *header = (const JKTXHeader*)&data[0];
+	if (memcmp(header->identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 || header->endianness != 0x04030201)
+		return false;
+
+	// sizes come from untrusted files, bounded before any is used
+	if (header->pixelWidth == 0 || header->pixelWidth > KTX_MAX_SIZE || header->pixelHeight == 0 || header->pixelHeight > KTX_MAX_SIZE
+		|| header->numberOfMipmapLevels > 32 || header->bytesOfKeyValueData > data.size() - sizeof(JKTXHeader))
+		return false;
+
+	// single 2D images of the formats JTextureDecoder knows, which have no type
+	if (header->glType != 0 || !JTextureDecoder::IsSupported(header->glInternalFormat) || header->pixelDepth > 1
+		|| header->numberOfArrayElements > 1 || header->numberOfFaces != 1)
+		return false;
+
+	info.mFormat = header->glInternalFormat;
+	info.mWidth = header->pixelWidth;
+	info.mHeight = header->pixelHeight;
+	info.mLevels.clear();
+	info.mLevelSizes.clear();
+
+	size_t offset = sizeof(JKTXHeader) + header->bytesOfKeyValueData;
+	int levels = header->numberOfMipmapLevels > 0 ? header->numberOfMipmapLevels : 1;
+
+	for (int level = 0; level < levels; level++)
+	{
+		int width = info.mWidth >> level > 0 ? info.mWidth >> level : 1;
+		int height = info.mHeight >> level > 0 ? info.mHeight >> level : 1;
+
+		if (offset + 4 > data.size())
+			return false;
+
+		uint32_t size;
+		memcpy(&size, &data[offset], 4);
+		offset += 4;
+
+		if (size < JTextureDecoder::GetImageSize(info.mFormat, width, height) || size > data.size() - offset)
+			return false;
+
+		info.mLevels.push_back(&data[offset]);
+		info.mLevelSizes.push_back((int)size);
+
+		// levels start on 4 byte boundaries
+		offset += (size + 3) & ~3;
+	}
+
+	return true;
+}
+
+u8* JResourceManager::LoadImageBits(const char* filename, int &width, int &height, int &pitch)
+{
+	TextureInfo textureInfo;
+	std::vector<unsigned char> file;
+
+	if (!JFileSystem::GetInstance()->ReadWholeFile(filename, file) || !LoadPNG(textureInfo, file, false) || textureInfo.mBits == NULL)
+	{
+		printf("Failed to load png %s \n", filename);
+		return NULL;
+	}
+
+	width = textureInfo.mWidth;
+	height = textureInfo.mHeight;
+	pitch = textureInfo.mTexWidth;
+
+	return textureInfo.mBits;
+}
+
+JBakedAtlas* JResourceManager::LoadAtlas(const char* filename)
+{
+	std::vector<unsigned char> data;
+	if (!JFileSystem::GetInstance()->ReadWholeFile(filename, data) || data.size() < sizeof(JAtlasHeader))
+	{
+		printf("Failed to load atlas %s \n", filename);
+		return NULL;
+	}
+
+	// entries counted by division, the product could wrap on 32 bit targets
+	const JAtlasHeader *header = (const JAtlasHeader*)&data[0];
+	if (header->magic != ATLAS_MAGIC || header->version != ATLAS_VERSION ||
+		header->entryCount > (data.size() - sizeof(JAtlasHeader)) / sizeof(JAtlasEntry))
+	{
+		printf("Invalid atlas %s \n", filename);
+		return NULL;
+	}
+
+	JBakedAtlas *atlas = new JBakedAtlas();
+
+	// pages are named after the index
+	std::string base = filename;
+	size_t dot = base.rfind('.');
+	if (dot != std::string::npos)
+		base.erase(dot);
+
+	for (int i = 0; i < header->pageCount; i++)
+	{
+		char pageName[16];
+		sprintf(pageName, "_%d.png", i);
+
+		JTexture *page = AcquireTexture((base + pageName).c_str());
+		if (page == NULL)
+		{
+			delete atlas;
+			return NULL;
+		}
+		atlas->mPages.push_back(page);
+	}
+
+	const JAtlasEntry *entries = (const JAtlasEntry*)(header + 1);
+
+	atlas->mHashes.reserve(header->entryCount);
+	atlas->mQuads.reserve(header->entryCount);
+
+	for (uint32_t i = 0; i < header->entryCount; i++)
+	{
+		const JAtlasEntry &entry = entries[i];
+		if (entry.page >= atlas->mPages.size())
+			continue;
+
+		JQuad *quad = new JQuad(atlas->mPages[entry.page], entry.x, entry.y, entry.width, entry.height);
+		quad->SetHotSpot(entry.hotSpotX - entry.trimX, entry.hotSpotY - entry.trimY);
+
+		atlas->mHashes.push_back(entry.nameHash);
+		atlas->mQuads.push_back(quad);
+	}
+
+	return atlas;
 }
 
 static void PNGCustomWarningFn(png_structp png_ptr, png_const_charp warning_msg)
@@ -135,20 +699,26 @@ static void PNGCustomWarningFn(png_structp png_ptr, png_const_charp warning_msg)
 }
 
 
-static void PNGCustomReadDataFn(png_structp png_ptr, png_bytep data, png_size_t length)
+// Png data read from memory, so that decoding needs no JFileSystem state.
+struct PNGMemoryReader
 {
-	png_voidp io_ptr = png_get_io_ptr(png_ptr);
+	const unsigned char *data;
+	size_t size;
+	size_t offset;
+};
 
-	JFileSystem &fileSystem = *(JFileSystem *)io_ptr;
-	const size_t bytesRead = fileSystem.ReadFile(
-		(unsigned char *)data,
-		(size_t)length);
+static void PNGCustomReadDataFn(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	PNGMemoryReader *reader = (PNGMemoryReader *)png_get_io_ptr(png_ptr);
 
-	if ((png_size_t)bytesRead != length)
+	if (reader->offset + length > reader->size)
 		png_error(png_ptr, "Read Error!");
+
+	memcpy(data, reader->data + reader->offset, length);
+	reader->offset += length;
 }
 
-bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const char *filename)
+bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const std::vector<unsigned char> &file, bool powerOfTwo)
 {
 	textureInfo.mBits = NULL;
 
@@ -161,15 +731,11 @@ bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const char *filename)
     int bit_depth, color_type, interlace_type, x, y;
     DWORD* line;
 
-	JFileSystem* fileSystem = JFileSystem::GetInstance();
-	if (!fileSystem->OpenFile(filename)) return false;
+	PNGMemoryReader reader = { file.empty() ? NULL : &file[0], file.size(), 0 };
 
     png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (png_ptr == NULL) 
 	{
-        //fclose(fp);
-		fileSystem->CloseFile();
-
         return false;
     }
 
@@ -177,15 +743,12 @@ bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const char *filename)
     info_ptr = png_create_info_struct(png_ptr);
     if (info_ptr == NULL) 
 	{
-        //fclose(fp);
-		fileSystem->CloseFile();
-
         png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
 
         return false;
     }
     png_init_io(png_ptr, NULL);
-	png_set_read_fn(png_ptr, (png_voidp)fileSystem, PNGCustomReadDataFn);
+	png_set_read_fn(png_ptr, (png_voidp)&reader, PNGCustomReadDataFn);
 
     png_set_sig_bytes(png_ptr, sig_read);
     png_read_info(png_ptr, info_ptr);
@@ -200,16 +763,13 @@ bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const char *filename)
 	line = (DWORD*) malloc(width * 4);
     if (!line) 
 	{
-        //fclose(fp);
-		fileSystem->CloseFile();
-		
         png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
         return false;
     }
    
 
-	tw = getNextPower2(width);
-	th = getNextPower2(height);
+	tw = powerOfTwo ? getNextPower2(width) : width;
+	th = powerOfTwo ? getNextPower2(height) : height;
 		
 	int size = tw * th * 4;			// RGBA
 
@@ -249,15 +809,62 @@ bool JResourceManager::LoadPNG(TextureInfo &textureInfo, const char *filename)
 
     png_read_end(png_ptr, info_ptr);
     png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-	
-    //fclose(fp);
-	fileSystem->CloseFile();
 
 	textureInfo.mBits = buffer;
 	textureInfo.mWidth = width;
 	textureInfo.mHeight = height;
 	textureInfo.mTexWidth = tw;
 	textureInfo.mTexHeight = th;
+	textureInfo.mTrimX = 0;
+	textureInfo.mTrimY = 0;
+	textureInfo.mTrimWidth = width;
+	textureInfo.mTrimHeight = height;
 
 	return true;
+}
+
+void JResourceManager::TrimImage(TextureInfo &textureInfo, bool powerOfTwo)
+{
+	int left = textureInfo.mWidth, top = textureInfo.mHeight, right = -1, bottom = -1;
+
+	for (int y = 0; y < textureInfo.mHeight; y++)
+	{
+		const u8 *row = textureInfo.mBits + y * textureInfo.mTexWidth * 4;
+		for (int x = 0; x < textureInfo.mWidth; x++)
+		{
+			if (row[x * 4 + 3] == 0)
+				continue;
+
+			if (x < left) left = x;
+			if (x > right) right = x;
+			if (y < top) top = y;
+			bottom = y;
+		}
+	}
+
+	// an image with nothing to show keeps a texel
+	if (right < 0)
+		left = top = right = bottom = 0;
+
+	int width = right - left + 1;
+	int height = bottom - top + 1;
+	if (width == textureInfo.mWidth && height == textureInfo.mHeight)
+		return;
+
+	int tw = powerOfTwo ? getNextPower2(width) : width;
+	int th = powerOfTwo ? getNextPower2(height) : height;
+
+	u8 *buffer = new u8[tw * th * 4];
+	for (int y = 0; y < height; y++)
+		memcpy(buffer + y * tw * 4, textureInfo.mBits + ((top + y) * textureInfo.mTexWidth + left) * 4, width * 4);
+
+	delete [] textureInfo.mBits;
+
+	textureInfo.mBits = buffer;
+	textureInfo.mTexWidth = tw;
+	textureInfo.mTexHeight = th;
+	textureInfo.mTrimX = left;
+	textureInfo.mTrimY = top;
+	textureInfo.mTrimWidth = width;
+	textureInfo.mTrimHeight = height;
 }
\ No newline at end of file
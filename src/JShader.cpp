@@ -1,8 +1,9 @@
 #include "../include/JShader.h"
+#include "../include/JRenderState.h"
 
 JShader &JShader::Use()
 {
-	glUseProgram(this->Program);
+	JRenderState::GetInstance()->UseProgram(this->Program);
 	return *this;
 }
 
@@ -29,6 +30,157 @@ void JShader::Compile(const GLchar* vertexSource, const GLchar* fragmentSource)
 	// Delete the shaders as they're linked into our program now and no longer necessery
 	glDeleteShader(sVertex);
 	glDeleteShader(sFragment);
+	introspect();
+}
+
+bool JShader::LoadBinary(GLenum format, const void *binary, GLsizei length)
+{
+#ifdef JGE_PROGRAM_CACHE
+	this->Program = glCreateProgram();
+	glProgramBinary(this->Program, format, binary, length);
+
+	GLint success;
+	glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(this->Program);
+		this->Program = 0;
+		return false;
+	}
+
+	introspect();
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool JShader::GetBinary(GLenum &format, std::vector<unsigned char> &binary) const
+{
+#ifdef JGE_PROGRAM_CACHE
+	GLint formats = 0, length = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	glGetProgramiv(this->Program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formats <= 0 || length <= 0)
+		return false;
+
+	binary.resize(length);
+	GLsizei written = 0;
+	glGetProgramBinary(this->Program, length, &written, &format, &binary[0]);
+	binary.resize(written);
+	return written > 0;
+#else
+	return false;
+#endif
+}
+
+void JShader::introspect()
+{
+	Uniforms.clear();
+	Attributes.clear();
+
+	GLenum counts[2] = { GL_ACTIVE_UNIFORMS, GL_ACTIVE_ATTRIBUTES };
+	GLenum lengths[2] = { GL_ACTIVE_UNIFORM_MAX_LENGTH, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH };
+	std::vector<JShaderVariable> *lists[2] = { &Uniforms, &Attributes };
+
+	for (int i = 0; i < 2; i++)
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(this->Program, counts[i], &count);
+		glGetProgramiv(this->Program, lengths[i], &maxLength);
+
+		std::vector<GLchar> name(maxLength + 1);
+		for (GLint j = 0; j < count; j++)
+		{
+			JShaderVariable variable;
+			GLsizei length = 0;
+			if (i == 0)
+				glGetActiveUniform(this->Program, j, (GLsizei)name.size(), &length, &variable.Size, &variable.Type, &name[0]);
+			else
+				glGetActiveAttrib(this->Program, j, (GLsizei)name.size(), &length, &variable.Size, &variable.Type, &name[0]);
+
+			variable.Name.assign(&name[0], length);
+			size_t bracket = variable.Name.find('[');
+			if (bracket != std::string::npos)
+				variable.Name.erase(bracket);
+
+			if (i == 0)
+				variable.Location = glGetUniformLocation(this->Program, variable.Name.c_str());
+			else
+				variable.Location = glGetAttribLocation(this->Program, variable.Name.c_str());
+			lists[i]->push_back(variable);
+		}
+	}
+}
+
+GLint JShader::FindUniform(const GLchar *name, GLenum type) const
+{
+	for (size_t i = 0; i < Uniforms.size(); i++)
+	{
+		const JShaderVariable &uniform = Uniforms[i];
+		if (uniform.Name != name)
+			continue;
+
+		bool integer = uniform.Type == GL_INT || uniform.Type == GL_BOOL || uniform.Type == GL_SAMPLER_2D;
+		if (uniform.Type == type || (type == GL_INT && integer))
+			return uniform.Location;
+
+		std::cout << "| ERROR::SHADER: Uniform " << name << " is of type 0x" << std::hex << uniform.Type
+			<< ", not 0x" << type << std::dec << std::endl;
+		return -1;
+	}
+	return -1;
+}
+
+GLint JShader::GetAttribute(const GLchar *name) const
+{
+	for (size_t i = 0; i < Attributes.size(); i++)
+		if (Attributes[i].Name == name)
+			return Attributes[i].Location;
+	return -1;
+}
+
+void JShader::Set(const JUniform<GLfloat> &uniform, GLfloat value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform1f(uniform.Location, value);
+}
+void JShader::Set(const JUniform<GLint> &uniform, GLint value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform1i(uniform.Location, value);
+}
+void JShader::Set(const JUniform<glm::vec2> &uniform, const glm::vec2 &value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform2f(uniform.Location, value.x, value.y);
+}
+void JShader::Set(const JUniform<glm::vec3> &uniform, const glm::vec3 &value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform3f(uniform.Location, value.x, value.y, value.z);
+}
+void JShader::Set(const JUniform<glm::vec4> &uniform, const glm::vec4 &value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform4f(uniform.Location, value.x, value.y, value.z, value.w);
+}
+void JShader::Set(const JUniform<glm::ivec2> &uniform, const glm::ivec2 &value, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniform2i(uniform.Location, value.x, value.y);
+}
+void JShader::Set(const JUniform<glm::mat4> &uniform, const glm::mat4 &matrix, GLboolean useShader)
+{
+	if (useShader)
+		this->Use();
+	glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
 void JShader::SetFloat(const GLchar *name, GLfloat value, GLboolean useShader)
@@ -0,0 +1,111 @@
+#include "../include/JSkylinePacker.h"
+
+JSkylinePacker::JSkylinePacker(int width, int height)
+{
+    mWidth = width;
+    mHeight = height;
+    Reset();
+}
+
+void JSkylinePacker::Reset()
+{
+    Segment segment = { 0, 0, mWidth };
+
+    mSkyline.clear();
+    mSkyline.push_back(segment);
+    mUsedArea = 0;
+}
+
+float JSkylinePacker::GetOccupancy() const
+{
+    return (float)mUsedArea / ((float)mWidth * mHeight);
+}
+
+// Top position of a rectangle whose left edge starts at segment index, -1 if it does not fit.
+int JSkylinePacker::Fit(int index, int width, int height) const
+{
+    int x = mSkyline[index].x;
+    if (x + width > mWidth)
+        return -1;
+
+    int y = 0;
+    int widthLeft = width;
+    for (int i = index; widthLeft > 0; i++)
+    {
+        if (mSkyline[i].y > y)
+            y = mSkyline[i].y;
+        if (y + height > mHeight)
+            return -1;
+        widthLeft -= mSkyline[i].width;
+    }
+
+    return y;
+}
+
+bool JSkylinePacker::Insert(int width, int height, int &x, int &y)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    int bestIndex = -1;
+    int bestTop = mHeight + 1;
+    int bestWidth = mWidth + 1;
+
+    for (int i = 0; i < (int)mSkyline.size(); i++)
+    {
+        int top = Fit(i, width, height);
+        if (top < 0)
+            continue;
+
+        // lowest top edge first, then the narrowest segment to leave wide gaps alone
+        if (top + height < bestTop || (top + height == bestTop && mSkyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestTop = top + height;
+            bestWidth = mSkyline[i].width;
+            x = mSkyline[i].x;
+            y = top;
+        }
+    }
+
+    if (bestIndex < 0)
+        return false;
+
+    AddSegment(bestIndex, x, y, width, height);
+    mUsedArea += (long)width * height;
+    return true;
+}
+
+void JSkylinePacker::AddSegment(int index, int x, int y, int width, int height)
+{
+    Segment segment = { x, y + height, width };
+    mSkyline.insert(mSkyline.begin() + index, segment);
+
+    // cut the segments now under the new one
+    for (int i = index + 1; i < (int)mSkyline.size(); i++)
+    {
+        Segment &previous = mSkyline[i - 1];
+        int overlap = previous.x + previous.width - mSkyline[i].x;
+        if (overlap <= 0)
+            break;
+
+        mSkyline[i].x += overlap;
+        mSkyline[i].width -= overlap;
+        if (mSkyline[i].width > 0)
+            break;
+
+        mSkyline.erase(mSkyline.begin() + i);
+        i--;
+    }
+
+    // merge neighbours of the same height
+    for (int i = 0; i + 1 < (int)mSkyline.size(); i++)
+    {
+        if (mSkyline[i].y == mSkyline[i + 1].y)
+        {
+            mSkyline[i].width += mSkyline[i + 1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+            i--;
+        }
+    }
+}
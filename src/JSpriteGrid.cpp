@@ -0,0 +1,156 @@
+#include "../include/JSpriteGrid.h"
+#include "../include/JRenderer.h"
+
+#include <math.h>
+#include <algorithm>
+
+JSpriteGrid::JSpriteGrid(float width, float height, float cellSize)
+{
+    mCellSize = cellSize;
+    mCellsX = std::max(1, (int)ceilf(width / cellSize));
+    mCellsY = std::max(1, (int)ceilf(height / cellSize));
+    mCells.resize(mCellsX * mCellsY);
+
+    mCount = 0;
+    mMark = 0;
+}
+
+JSpriteGrid::~JSpriteGrid()
+{
+}
+
+void JSpriteGrid::GetCellRange(float left, float top, float right, float bottom, int *cells) const
+{
+    float limits[4] = { left, top, right, bottom };
+    int maxCells[4] = { mCellsX - 1, mCellsY - 1, mCellsX - 1, mCellsY - 1 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        // clamped as floats first, positions far away must not overflow
+        float cell = std::min(std::max(floorf(limits[i] / mCellSize), 0.0f), (float)maxCells[i]);
+        cells[i] = (int)cell;
+    }
+}
+
+void JSpriteGrid::Insert(int sprite)
+{
+    Entry &entry = mEntries[sprite];
+
+    JSprite bounded;
+    JSpriteRenderer::SetSprite(entry.quad, entry.x, entry.y, entry.angle, entry.xScale, entry.yScale, bounded);
+
+    float bounds[4];
+    JSpriteRenderer::GetBounds(bounded, bounds);
+    GetCellRange(bounds[0], bounds[1], bounds[2], bounds[3], entry.cells);
+
+    for (int y = entry.cells[1]; y <= entry.cells[3]; y++)
+        for (int x = entry.cells[0]; x <= entry.cells[2]; x++)
+            mCells[y * mCellsX + x].push_back(sprite);
+}
+
+void JSpriteGrid::Erase(int sprite)
+{
+    const Entry &entry = mEntries[sprite];
+
+    for (int y = entry.cells[1]; y <= entry.cells[3]; y++)
+    {
+        for (int x = entry.cells[0]; x <= entry.cells[2]; x++)
+        {
+            std::vector<int> &cell = mCells[y * mCellsX + x];
+            cell.erase(std::find(cell.begin(), cell.end(), sprite));
+        }
+    }
+}
+
+int JSpriteGrid::Add(JQuad *quad, float x, float y, float angle, float xScale, float yScale)
+{
+    Entry entry;
+    entry.quad = quad;
+    entry.x = x;
+    entry.y = y;
+    entry.angle = angle;
+    entry.xScale = xScale;
+    entry.yScale = yScale;
+
+    int sprite = (int)mEntries.size();
+    mEntries.push_back(entry);
+    mMarks.push_back(mMark);
+    Insert(sprite);
+
+    mCount++;
+    return sprite;
+}
+
+void JSpriteGrid::Move(int sprite, float x, float y)
+{
+    if (sprite < 0 || sprite >= (int)mEntries.size() || mEntries[sprite].quad == NULL)
+        return;
+
+    Erase(sprite);
+    mEntries[sprite].x = x;
+    mEntries[sprite].y = y;
+    Insert(sprite);
+}
+
+void JSpriteGrid::Remove(int sprite)
+{
+    if (sprite < 0 || sprite >= (int)mEntries.size() || mEntries[sprite].quad == NULL)
+        return;
+
+    Erase(sprite);
+    mEntries[sprite].quad = NULL;
+    mCount--;
+}
+
+void JSpriteGrid::Clear()
+{
+    for (size_t i = 0; i < mCells.size(); i++)
+        mCells[i].clear();
+
+    mEntries.clear();
+    mMarks.clear();
+    mVisible.clear();
+    mCount = 0;
+}
+
+void JSpriteGrid::Render(float viewX, float viewY)
+{
+    JRenderer *renderer = JRenderer::GetInstance();
+
+    int cells[4];
+    GetCellRange(viewX, viewY, viewX + renderer->GetViewWidth(), viewY + renderer->GetViewHeight(), cells);
+
+    if (++mMark == 0)
+    {
+        // wrapped around, old marks could match again
+        std::fill(mMarks.begin(), mMarks.end(), 0);
+        mMark = 1;
+    }
+
+    mVisible.clear();
+    for (int y = cells[1]; y <= cells[3]; y++)
+    {
+        for (int x = cells[0]; x <= cells[2]; x++)
+        {
+            const std::vector<int> &cell = mCells[y * mCellsX + x];
+            for (size_t i = 0; i < cell.size(); i++)
+            {
+                if (mMarks[cell[i]] != mMark)
+                {
+                    mMarks[cell[i]] = mMark;
+                    mVisible.push_back(cell[i]);
+                }
+            }
+        }
+    }
+
+    // back to the order of Add, the view spans several cells
+    std::sort(mVisible.begin(), mVisible.end());
+
+    // sprites of the cells walked may still be out of view, RenderQuad culls them
+    for (size_t i = 0; i < mVisible.size(); i++)
+    {
+        const Entry &entry = mEntries[mVisible[i]];
+        renderer->RenderQuad(entry.quad, entry.x - viewX, entry.y - viewY, entry.angle, entry.xScale, entry.yScale);
+    }
+}
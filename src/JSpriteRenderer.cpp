@@ -1,8 +1,45 @@
 #include "../include/JSpriteRenderer.h"
 
-JSpriteRenderer::JSpriteRenderer(JShader &shader) {
+#include <stddef.h>
+#include <algorithm>
+
+static_assert(sizeof(JSpriteInstance) == 48, "instance layout must match sprite_instanced.vert");
+
+struct JVertexAttribute { const char *name; GLint size; GLenum type; GLboolean normalized; size_t offset; };
+
+static const JVertexAttribute gBatchAttributes[SPRITE_BATCH_ATTRIBUTES] = {
+    { "vertex", 2, GL_FLOAT, GL_FALSE, offsetof(JSpriteVertex, x) },
+    { "texCoord", 2, GL_FLOAT, GL_FALSE, offsetof(JSpriteVertex, u) },
+    { "color", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(JSpriteVertex, color) }
+};
+
+static const JVertexAttribute gInstanceAttributes[SPRITE_INSTANCE_ATTRIBUTES] = {
+    { "model", 4, GL_FLOAT, GL_FALSE, offsetof(JSpriteInstance, model) },
+    { "translation", 2, GL_FLOAT, GL_FALSE, offsetof(JSpriteInstance, translation) },
+    { "spriteRect", 4, GL_FLOAT, GL_FALSE, offsetof(JSpriteInstance, spriteRect) },
+    { "color", 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(JSpriteInstance, color) },
+    { "flipped", 2, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(JSpriteInstance, flipped) }
+};
+
+// Point the attributes at data starting at base in the buffer bound to GL_ARRAY_BUFFER.
+static void PointAttributes(const JVertexAttribute *attributes, const GLint *locations, int count, GLsizei stride, GLintptr base)
+{
+    for (int i = 0; i < count; i++) {
+        if (locations[i] < 0)
+            continue;
+        glVertexAttribPointer(locations[i], attributes[i].size, attributes[i].type, attributes[i].normalized, stride, (GLvoid*)(base + attributes[i].offset));
+    }
+}
+
+JSpriteRenderer::JSpriteRenderer(JShader &shader, JShader &batchShader, JShader &instancedShader, JStreamBuffer *vertexStream) {
     this->shader = shader;
+    this->vertexStream = vertexStream;
+    mRenderState = JRenderState::GetInstance();
+    this->batchShader = batchShader;
+    this->instancedShader = instancedShader;
     initRenderData();
+    initBatchData();
+    initInstanceData();
 
     shader.Use();
     modelLocation = glGetUniformLocation(shader.Program, "model");
@@ -14,25 +51,30 @@ JSpriteRenderer::JSpriteRenderer(JShader &shader) {
 
 JSpriteRenderer::~JSpriteRenderer() {
     // 清理 VBO
-    glDeleteBuffers(1, &VBO);
+    mRenderState->DeleteBuffer(VBO);
+    mRenderState->DeleteBuffer(EBO);
+    mRenderState->DeleteVertexArray(VAO);
+
+    mRenderState->DeleteBuffer(batchEBO);
+    mRenderState->DeleteVertexArray(batchVAO);
+
+    mRenderState->DeleteVertexArray(instanceVAO);
 }
 
 void JSpriteRenderer::BindTexture(JTexture *tex, int textureFilter) {
-    glBindTexture(GL_TEXTURE_2D, tex->mTexId);
+    mRenderState->BindTexture(tex->mTexId);
 
-    if (textureFilter == TEX_FILTER_LINEAR) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    } else if (textureFilter == TEX_FILTER_NEAREST) {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    }
+    if (textureFilter == TEX_FILTER_LINEAR)
+        mRenderState->SetTextureFilter(tex, true);
+    else if (textureFilter == TEX_FILTER_NEAREST)
+        mRenderState->SetTextureFilter(tex, false);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    mRenderState->SetTextureWrap(tex, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 }
 
 void JSpriteRenderer::DrawSprite(JSprite &sprite) {
+    mRenderState->BeginSubmit();
+
     this->shader.Use();
 
     glm::mat4 model = glm::mat4(1.0f);
@@ -69,13 +111,15 @@ void JSpriteRenderer::DrawSprite(JSprite &sprite) {
     glUniform2i(flippedLocation, sprite.hFlipped, sprite.vFlipped);
     glUniform4f(colorLocation, sprite.color.x, sprite.color.y, sprite.color.z, sprite.color.w);
 
-    glActiveTexture(GL_TEXTURE0);
+    mRenderState->ActiveTexture(GL_TEXTURE0);
     BindTexture(sprite.texture, sprite.textureFilter);
 
     // 綁定 VAO 並繪製
-    glBindVertexArray(VAO);
+    mRenderState->BindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-    glBindVertexArray(0);
+    mRenderState->CountDraw(4);
+
+    mRenderState->EndSubmit();
 }
 
 void JSpriteRenderer::initRenderData() {
@@ -98,14 +142,14 @@ void JSpriteRenderer::initRenderData() {
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    mRenderState->BindVertexArray(VAO);
 
     // 設置 VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     // 設置 EBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    mRenderState->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
     // 設置頂點屬性指針
@@ -113,7 +157,328 @@ void JSpriteRenderer::initRenderData() {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
 
     // 解綁 VAO 和 VBO
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, 0);
+    mRenderState->BindVertexArray(0);
+}
+
+void JSpriteRenderer::initBatchData() {
+    mVertices.reserve(SPRITE_BATCH_MAX_QUADS * 4);
+    mQuadCount = 0;
+    mBatchTexture = NULL;
+    mBatchFilter = TEX_FILTER_NONE;
+
+    // the index pattern never changes, so it is generated once for the largest batch
+    std::vector<GLushort> indices(SPRITE_BATCH_MAX_QUADS * 6);
+    for (int i = 0; i < SPRITE_BATCH_MAX_QUADS; i++) {
+        GLushort base = (GLushort)(i * 4);
+        indices[i * 6 + 0] = base + 0;
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 2;
+        indices[i * 6 + 3] = base + 2;
+        indices[i * 6 + 4] = base + 3;
+        indices[i * 6 + 5] = base + 0;
+    }
+
+    glGenVertexArrays(1, &batchVAO);
+    glGenBuffers(1, &batchEBO);
+
+    mRenderState->BindVertexArray(batchVAO);
+
+    mRenderState->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, batchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+    // vertices live in the stream buffer, pointers are updated on every flush
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, vertexStream->GetBuffer());
+    for (int i = 0; i < SPRITE_BATCH_ATTRIBUTES; i++) {
+        batchLocations[i] = glGetAttribLocation(batchShader.Program, gBatchAttributes[i].name);
+        if (batchLocations[i] >= 0)
+            glEnableVertexAttribArray(batchLocations[i]);
+    }
+    PointAttributes(gBatchAttributes, batchLocations, SPRITE_BATCH_ATTRIBUTES, sizeof(JSpriteVertex), 0);
+
+    mRenderState->BindVertexArray(0);
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void JSpriteRenderer::AddSprite(JSprite &sprite) {
+    JSpriteVertex v[4];
+    BuildQuad(sprite, v);
+    AddQuad(sprite.texture, sprite.textureFilter, v);
+}
+
+void JSpriteRenderer::SetSprite(const JQuad *quad, float xo, float yo, float angle, float xScale, float yScale, JSprite &sprite) {
+    const float colorNormalization = 1.0f / 255.0f;
+
+    sprite.texture = quad->mTex;
+    sprite.spriteRect = {quad->mX, quad->mY, quad->mWidth, quad->mHeight};
+    sprite.position = {xo, yo};
+    sprite.hotspot = {quad->mHotSpotX, quad->mHotSpotY};
+    sprite.scale = {xScale, yScale};
+    sprite.rotate = angle;
+    sprite.hFlipped = quad->mHFlipped;
+    sprite.vFlipped = quad->mVFlipped;
+    sprite.color = glm::vec4(quad->mColor.r, quad->mColor.g, quad->mColor.b, quad->mColor.a) * colorNormalization;
+
+    const JTexture *tex = quad->mTex;
+    if (tex->mTrimmed) {
+        // quads address the whole image, cut them to the part stored and move the hotspot by the part cut
+        float left = std::max(quad->mX, (float)tex->mTrimX);
+        float top = std::max(quad->mY, (float)tex->mTrimY);
+        float right = std::min(quad->mX + quad->mWidth, (float)(tex->mTrimX + tex->mTrimWidth));
+        float bottom = std::min(quad->mY + quad->mHeight, (float)(tex->mTrimY + tex->mTrimHeight));
+
+        if (right <= left || bottom <= top) {
+            // only transparent borders under the quad
+            sprite.spriteRect = {0.0f, 0.0f, 1.0f, 1.0f};
+            sprite.color.w = 0.0f;
+            return;
+        }
+
+        sprite.spriteRect = {left - tex->mTrimX, top - tex->mTrimY, right - left, bottom - top};
+        sprite.hotspot.x -= quad->mHFlipped ? quad->mX + quad->mWidth - right : left - quad->mX;
+        sprite.hotspot.y -= quad->mVFlipped ? quad->mY + quad->mHeight - bottom : top - quad->mY;
+    }
+}
+
+void JSpriteRenderer::BuildQuad(const JSprite &sprite, JSpriteVertex *v) {
+    JTexture *tex = sprite.texture;
+
+    float w = 1.0f, h = 1.0f;
+    if (sprite.spriteRect[2] > 0.0f && sprite.spriteRect[3] > 0.0f) {
+        w = sprite.spriteRect[2];
+        h = sprite.spriteRect[3];
+    }
+
+    // same mapping as sprite.vert, including the one texel border fix
+    float invTexW = 1.0f / tex->mTexWidth;
+    float invTexH = 1.0f / tex->mTexHeight;
+    float u0 = sprite.spriteRect.x * invTexW;
+    float v0 = sprite.spriteRect.y * invTexH;
+    float u1 = (sprite.spriteRect.x + sprite.spriteRect.z - 1.0f) * invTexW;
+    float v1 = (sprite.spriteRect.y + sprite.spriteRect.w - 1.0f) * invTexH;
+    if (sprite.hFlipped) std::swap(u0, u1);
+    if (sprite.vFlipped) std::swap(v0, v1);
+
+    // corners relative to the hotspot, before rotation and scaling
+    float x0 = -sprite.hotspot.x;
+    float y0 = -sprite.hotspot.y;
+    float x1 = x0 + w;
+    float y1 = y0 + h;
+
+    float cosTheta = 1.0f, sinTheta = 0.0f;
+    if (sprite.rotate != 0.0f) {
+        cosTheta = cos(sprite.rotate);
+        sinTheta = sin(sprite.rotate);
+    }
+    float ax = cosTheta * sprite.scale.x, ay = sinTheta * sprite.scale.x;
+    float bx = -sinTheta * sprite.scale.y, by = cosTheta * sprite.scale.y;
+    float px = sprite.position.x, py = sprite.position.y;
+
+    GLuint color = ((GLuint)(sprite.color.x * 255.0f + 0.5f))
+                 | ((GLuint)(sprite.color.y * 255.0f + 0.5f) << 8)
+                 | ((GLuint)(sprite.color.z * 255.0f + 0.5f) << 16)
+                 | ((GLuint)(sprite.color.w * 255.0f + 0.5f) << 24);
+
+    v[0].x = ax * x0 + bx * y0 + px; v[0].y = ay * x0 + by * y0 + py; v[0].u = u0; v[0].v = v0;
+    v[1].x = ax * x1 + bx * y0 + px; v[1].y = ay * x1 + by * y0 + py; v[1].u = u1; v[1].v = v0;
+    v[2].x = ax * x1 + bx * y1 + px; v[2].y = ay * x1 + by * y1 + py; v[2].u = u1; v[2].v = v1;
+    v[3].x = ax * x0 + bx * y1 + px; v[3].y = ay * x0 + by * y1 + py; v[3].u = u0; v[3].v = v1;
+    v[0].color = v[1].color = v[2].color = v[3].color = color;
+}
+
+void JSpriteRenderer::GetBounds(const JSprite &sprite, float *bounds) {
+    float w = 1.0f, h = 1.0f;
+    if (sprite.spriteRect[2] > 0.0f && sprite.spriteRect[3] > 0.0f) {
+        w = sprite.spriteRect[2];
+        h = sprite.spriteRect[3];
+    }
+
+    float x0 = -sprite.hotspot.x;
+    float y0 = -sprite.hotspot.y;
+    float x1 = x0 + w;
+    float y1 = y0 + h;
+
+    if (sprite.rotate == 0.0f) {
+        // scales may be negative
+        float ax = x0 * sprite.scale.x, bx = x1 * sprite.scale.x;
+        float ay = y0 * sprite.scale.y, by = y1 * sprite.scale.y;
+        bounds[0] = sprite.position.x + std::min(ax, bx);
+        bounds[1] = sprite.position.y + std::min(ay, by);
+        bounds[2] = sprite.position.x + std::max(ax, bx);
+        bounds[3] = sprite.position.y + std::max(ay, by);
+        return;
+    }
+
+    float cosTheta = cos(sprite.rotate);
+    float sinTheta = sin(sprite.rotate);
+    float ax = cosTheta * sprite.scale.x, ay = sinTheta * sprite.scale.x;
+    float bx = -sinTheta * sprite.scale.y, by = cosTheta * sprite.scale.y;
+
+    float cx[4] = { x0, x1, x1, x0 };
+    float cy[4] = { y0, y0, y1, y1 };
+    for (int i = 0; i < 4; i++) {
+        float x = ax * cx[i] + bx * cy[i];
+        float y = ay * cx[i] + by * cy[i];
+        if (i == 0 || x < bounds[0]) bounds[0] = x;
+        if (i == 0 || y < bounds[1]) bounds[1] = y;
+        if (i == 0 || x > bounds[2]) bounds[2] = x;
+        if (i == 0 || y > bounds[3]) bounds[3] = y;
+    }
+    bounds[0] += sprite.position.x;
+    bounds[1] += sprite.position.y;
+    bounds[2] += sprite.position.x;
+    bounds[3] += sprite.position.y;
+}
+
+void JSpriteRenderer::AddQuad(JTexture *tex, int textureFilter, const JSpriteVertex *vertices) {
+    int reason = -1;
+    if (!mInstances.empty())
+        reason = BATCH_BREAK_BACKEND;
+    else if (mQuadCount > 0 && tex != mBatchTexture)
+        reason = BATCH_BREAK_TEXTURE;
+    else if (mQuadCount > 0 && textureFilter != mBatchFilter)
+        reason = BATCH_BREAK_FILTER;
+    else if (mQuadCount >= SPRITE_BATCH_MAX_QUADS)
+        reason = BATCH_BREAK_FULL;
+
+    if (reason >= 0) {
+        mRenderState->CountBatchBreak(reason);
+        Flush();
+    }
+
+    mBatchTexture = tex;
+    mBatchFilter = textureFilter;
+
+    mVertices.insert(mVertices.end(), vertices, vertices + 4);
+    mQuadCount++;
+}
+
+void JSpriteRenderer::Flush() {
+    if (mInstances.empty() && mQuadCount == 0)
+        return;
+
+    mRenderState->BeginSubmit();
+
+    if (!mInstances.empty()) {
+        this->instancedShader.Use();
+        glUniform2f(instanceTextureSizeLocation, mBatchTexture->mTexWidth, mBatchTexture->mTexHeight);
+
+        mRenderState->ActiveTexture(GL_TEXTURE0);
+        BindTexture(mBatchTexture, mBatchFilter);
+
+        mRenderState->BindVertexArray(instanceVAO);
+        GLintptr offset = vertexStream->Upload(&mInstances[0], mInstances.size() * sizeof(JSpriteInstance));
+        PointAttributes(gInstanceAttributes, instanceLocations, SPRITE_INSTANCE_ATTRIBUTES, sizeof(JSpriteInstance), offset);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, (GLsizei)mInstances.size());
+        mRenderState->CountDraw(4 * (int)mInstances.size());
+
+        mInstances.clear();
+    }
+
+    if (mQuadCount > 0) {
+        this->batchShader.Use();
+
+        mRenderState->ActiveTexture(GL_TEXTURE0);
+        BindTexture(mBatchTexture, mBatchFilter);
+
+        mRenderState->BindVertexArray(batchVAO);
+        GLintptr offset = vertexStream->Upload(&mVertices[0], mVertices.size() * sizeof(JSpriteVertex));
+        PointAttributes(gBatchAttributes, batchLocations, SPRITE_BATCH_ATTRIBUTES, sizeof(JSpriteVertex), offset);
+        glDrawElements(GL_TRIANGLES, mQuadCount * 6, GL_UNSIGNED_SHORT, (GLvoid*)0);
+        mRenderState->CountDraw(mQuadCount * 6);
+
+        mVertices.clear();
+        mQuadCount = 0;
+    }
+
+    mRenderState->EndSubmit();
+}
+
+void JSpriteRenderer::initInstanceData() {
+    mInstances.reserve(SPRITE_BATCH_MAX_QUADS);
+
+    instanceTextureSizeLocation = glGetUniformLocation(instancedShader.Program, "textureSize");
+
+    glGenVertexArrays(1, &instanceVAO);
+
+    mRenderState->BindVertexArray(instanceVAO);
+
+    // per vertex: the unit quad of the immediate path
+    GLint vertexLocation = glGetAttribLocation(instancedShader.Program, "vertex");
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, VBO);
+    glEnableVertexAttribArray(vertexLocation);
+    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+
+    // per instance, from the stream buffer
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, vertexStream->GetBuffer());
+    for (int i = 0; i < SPRITE_INSTANCE_ATTRIBUTES; i++) {
+        instanceLocations[i] = glGetAttribLocation(instancedShader.Program, gInstanceAttributes[i].name);
+        if (instanceLocations[i] < 0)
+            continue;
+        glEnableVertexAttribArray(instanceLocations[i]);
+        glVertexAttribDivisor(instanceLocations[i], 1);
+    }
+    PointAttributes(gInstanceAttributes, instanceLocations, SPRITE_INSTANCE_ATTRIBUTES, sizeof(JSpriteInstance), 0);
+
+    mRenderState->BindVertexArray(0);
+    mRenderState->BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void JSpriteRenderer::AddSpriteInstance(JSprite &sprite) {
+    int reason = -1;
+    if (mQuadCount > 0)
+        reason = BATCH_BREAK_BACKEND;
+    else if (!mInstances.empty() && sprite.texture != mBatchTexture)
+        reason = BATCH_BREAK_TEXTURE;
+    else if (!mInstances.empty() && sprite.textureFilter != mBatchFilter)
+        reason = BATCH_BREAK_FILTER;
+    else if (mInstances.size() >= SPRITE_BATCH_MAX_QUADS)
+        reason = BATCH_BREAK_FULL;
+
+    if (reason >= 0) {
+        mRenderState->CountBatchBreak(reason);
+        Flush();
+    }
+
+    mBatchTexture = sprite.texture;
+    mBatchFilter = sprite.textureFilter;
+
+    float w = 1.0f, h = 1.0f;
+    if (sprite.spriteRect[2] > 0.0f && sprite.spriteRect[3] > 0.0f) {
+        w = sprite.spriteRect[2];
+        h = sprite.spriteRect[3];
+    }
+
+    float cosTheta = 1.0f, sinTheta = 0.0f;
+    if (sprite.rotate != 0.0f) {
+        cosTheta = cos(sprite.rotate);
+        sinTheta = sin(sprite.rotate);
+    }
+    float ax = cosTheta * sprite.scale.x, ay = sinTheta * sprite.scale.x;
+    float bx = -sinTheta * sprite.scale.y, by = cosTheta * sprite.scale.y;
+
+    mInstances.push_back(JSpriteInstance());
+    JSpriteInstance &instance = mInstances.back();
+
+    // rotation and scale, then the sprite size so the shader only sees a unit quad
+    instance.model[0] = ax * w;
+    instance.model[1] = ay * w;
+    instance.model[2] = bx * h;
+    instance.model[3] = by * h;
+    instance.translation[0] = sprite.position.x - (ax * sprite.hotspot.x + bx * sprite.hotspot.y);
+    instance.translation[1] = sprite.position.y - (ay * sprite.hotspot.x + by * sprite.hotspot.y);
+
+    instance.spriteRect[0] = sprite.spriteRect.x;
+    instance.spriteRect[1] = sprite.spriteRect.y;
+    instance.spriteRect[2] = sprite.spriteRect.z;
+    instance.spriteRect[3] = sprite.spriteRect.w;
+
+    instance.color[0] = (GLubyte)(sprite.color.x * 255.0f + 0.5f);
+    instance.color[1] = (GLubyte)(sprite.color.y * 255.0f + 0.5f);
+    instance.color[2] = (GLubyte)(sprite.color.z * 255.0f + 0.5f);
+    instance.color[3] = (GLubyte)(sprite.color.w * 255.0f + 0.5f);
+
+    instance.flipped[0] = sprite.hFlipped ? 1 : 0;
+    instance.flipped[1] = sprite.vFlipped ? 1 : 0;
+    instance.padding[0] = instance.padding[1] = 0;
+}
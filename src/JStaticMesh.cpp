@@ -0,0 +1,318 @@
+#include "../include/JStaticMesh.h"
+#include "../include/JRenderer.h"
+#include "../include/JResourceManager.h"
+#include "../include/JRenderState.h"
+#include "../include/JStroker.h"
+
+#include <stddef.h>
+
+JStaticMesh::JStaticMesh()
+{
+    mColorShader = JResourceManager::GetShader("primitive");
+    mTextureShader = JResourceManager::GetShader("sprite_batch");
+
+    mVertexCount = 0;
+    mBuilt = false;
+
+    mVertexBuffer = mIndexBuffer = 0;
+    mColorVAO = mTextureVAO = 0;
+}
+
+JStaticMesh::~JStaticMesh()
+{
+    Clear();
+}
+
+void JStaticMesh::Clear()
+{
+    JRenderState *renderState = JRenderState::GetInstance();
+
+    if (mColorVAO != 0)
+        renderState->DeleteVertexArray(mColorVAO);
+    if (mTextureVAO != 0)
+        renderState->DeleteVertexArray(mTextureVAO);
+    if (mVertexBuffer != 0)
+        renderState->DeleteBuffer(mVertexBuffer);
+    if (mIndexBuffer != 0)
+        renderState->DeleteBuffer(mIndexBuffer);
+
+    mVertexBuffer = mIndexBuffer = 0;
+    mColorVAO = mTextureVAO = 0;
+
+    mVertices.clear();
+    mIndices.clear();
+    mSections.clear();
+    mVertexCount = 0;
+    mBuilt = false;
+}
+
+int JStaticMesh::Reserve(GLenum mode, JTexture *texture, int textureFilter, float lineWidth, int vertexCount, int indexCount)
+{
+    if (mBuilt || vertexCount <= 0 || indexCount <= 0 || mVertexCount + vertexCount > STATIC_MESH_MAX_VERTICES)
+        return -1;
+
+    if (mode != GL_LINES)
+        lineWidth = 0.0f;
+
+    if (mSections.empty() || mSections.back().mode != mode || mSections.back().texture != texture
+        || mSections.back().textureFilter != textureFilter || mSections.back().lineWidth != lineWidth)
+    {
+        Section section;
+        section.mode = mode;
+        section.texture = texture;
+        section.textureFilter = textureFilter;
+        section.lineWidth = lineWidth;
+        section.first = (int)mIndices.size();
+        section.count = 0;
+        mSections.push_back(section);
+    }
+
+    mSections.back().count += indexCount;
+
+    int base = mVertexCount;
+    mVertexCount += vertexCount;
+    return base;
+}
+
+void JStaticMesh::AddColorVertex(float x, float y, GLuint color)
+{
+    JSpriteVertex vertex;
+    vertex.x = x;
+    vertex.y = y;
+    vertex.u = vertex.v = 0.0f;
+    vertex.color = color;
+    mVertices.push_back(vertex);
+}
+
+void JStaticMesh::AddPolygon(const float *x, const float *y, int count, PIXEL_TYPE color)
+{
+    AddPolygon(x, y, &count, 1, color);
+}
+
+void JStaticMesh::AddPolygon(const float *x, const float *y, const int *ringCounts, int ringCount, PIXEL_TYPE color)
+{
+    const std::vector<GLushort> &indices = JRenderer::GetInstance()->GetTriangulator()->Triangulate(x, y, ringCounts, ringCount);
+    if (indices.empty())
+        return;
+
+    int count = 0;
+    for (int i = 0; i < ringCount; i++)
+        count += ringCounts[i];
+
+    int base = Reserve(GL_TRIANGLES, NULL, TEX_FILTER_NONE, 0.0f, count, (int)indices.size());
+    if (base < 0)
+        return;
+
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    for (int i = 0; i < count; i++)
+        AddColorVertex(x[i], y[i], rgba);
+    for (size_t i = 0; i < indices.size(); i++)
+        mIndices.push_back((GLushort)(base + indices[i]));
+}
+
+void JStaticMesh::AddRect(float x, float y, float width, float height, PIXEL_TYPE color)
+{
+    int base = Reserve(GL_TRIANGLES, NULL, TEX_FILTER_NONE, 0.0f, 4, 6);
+    if (base < 0)
+        return;
+
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    AddColorVertex(x, y, rgba);
+    AddColorVertex(x + width, y, rgba);
+    AddColorVertex(x + width, y + height, rgba);
+    AddColorVertex(x, y + height, rgba);
+
+    static const GLushort quadIndices[6] = { 0, 1, 2, 2, 3, 0 };
+    for (int i = 0; i < 6; i++)
+        mIndices.push_back((GLushort)(base + quadIndices[i]));
+}
+
+void JStaticMesh::AddLine(float x1, float y1, float x2, float y2, PIXEL_TYPE color, float width)
+{
+    int base = Reserve(GL_LINES, NULL, TEX_FILTER_NONE, width, 2, 2);
+    if (base < 0)
+        return;
+
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    AddColorVertex(x1, y1, rgba);
+    AddColorVertex(x2, y2, rgba);
+    mIndices.push_back((GLushort)base);
+    mIndices.push_back((GLushort)(base + 1));
+}
+
+void JStaticMesh::AddStrokedPath(const JStrokedPath &path, PIXEL_TYPE color)
+{
+    int count = path.GetVertexCount();
+    if (count < 3)
+        return;
+
+    // the strip as a list, so that paths share the draw call
+    int base = Reserve(GL_TRIANGLES, NULL, TEX_FILTER_NONE, 0.0f, count, (count - 2) * 3);
+    if (base < 0)
+        return;
+
+    GLuint rgba = ARGB_TO_RGBA8(color);
+    const float *x = path.GetX();
+    const float *y = path.GetY();
+    for (int i = 0; i < count; i++)
+        AddColorVertex(x[i], y[i], rgba);
+
+    for (int i = 0; i < count - 2; i++)
+    {
+        mIndices.push_back((GLushort)(base + i));
+        mIndices.push_back((GLushort)(base + i + 1 + (i & 1)));
+        mIndices.push_back((GLushort)(base + i + 2 - (i & 1)));
+    }
+}
+
+void JStaticMesh::AddQuad(JQuad *quad, float xo, float yo, float angle, float xScale, float yScale)
+{
+    JSprite sprite;
+    JSpriteRenderer::SetSprite(quad, xo, yo, angle, xScale, yScale, sprite);
+    sprite.textureFilter = JRenderer::GetInstance()->GetTextureFilter();
+
+    int base = Reserve(GL_TRIANGLES, sprite.texture, sprite.textureFilter, 0.0f, 4, 6);
+    if (base < 0)
+        return;
+
+    JSpriteVertex vertices[4];
+    JSpriteRenderer::BuildQuad(sprite, vertices);
+    mVertices.insert(mVertices.end(), vertices, vertices + 4);
+
+    static const GLushort quadIndices[6] = { 0, 1, 2, 2, 3, 0 };
+    for (int i = 0; i < 6; i++)
+        mIndices.push_back((GLushort)(base + quadIndices[i]));
+}
+
+void JStaticMesh::AddIndexed(GLenum mode, const JColorVertex *vertices, int vertexCount, const GLushort *indices, int indexCount)
+{
+    if (mode != GL_TRIANGLES && mode != GL_LINES)
+        return;
+
+    int base = Reserve(mode, NULL, TEX_FILTER_NONE, 1.0f, vertexCount, indexCount);
+    if (base < 0)
+        return;
+
+    for (int i = 0; i < vertexCount; i++)
+        AddColorVertex(vertices[i].x, vertices[i].y, vertices[i].color);
+    for (int i = 0; i < indexCount; i++)
+        mIndices.push_back((GLushort)(base + indices[i]));
+}
+
+GLuint JStaticMesh::CreateVertexArray(JShader &shader, bool textured)
+{
+    JRenderState *renderState = JRenderState::GetInstance();
+
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+
+    renderState->BindVertexArray(vao);
+    renderState->BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    renderState->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+
+    GLint vertexLocation = glGetAttribLocation(shader.Program, "vertex");
+    glEnableVertexAttribArray(vertexLocation);
+    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, sizeof(JSpriteVertex), (GLvoid*)offsetof(JSpriteVertex, x));
+
+    GLint colorLocation = glGetAttribLocation(shader.Program, "color");
+    glEnableVertexAttribArray(colorLocation);
+    glVertexAttribPointer(colorLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(JSpriteVertex), (GLvoid*)offsetof(JSpriteVertex, color));
+
+    if (textured)
+    {
+        GLint texCoordLocation = glGetAttribLocation(shader.Program, "texCoord");
+        glEnableVertexAttribArray(texCoordLocation);
+        glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, sizeof(JSpriteVertex), (GLvoid*)offsetof(JSpriteVertex, u));
+    }
+
+    return vao;
+}
+
+void JStaticMesh::Build()
+{
+    if (mBuilt)
+        return;
+    mBuilt = true;
+
+    if (mIndices.empty())
+        return;
+
+    JRenderState *renderState = JRenderState::GetInstance();
+
+    bool colored = false, textured = false;
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        if (mSections[i].texture)
+            textured = true;
+        else
+            colored = true;
+    }
+
+    glGenBuffers(1, &mVertexBuffer);
+    renderState->BindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(JSpriteVertex), &mVertices[0], GL_STATIC_DRAW);
+
+    glGenBuffers(1, &mIndexBuffer);
+
+    if (colored)
+        mColorVAO = CreateVertexArray(mColorShader, false);
+    if (textured)
+        mTextureVAO = CreateVertexArray(mTextureShader, true);
+
+    // the element buffer binding is part of the vertex array just set up
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(GLushort), &mIndices[0], GL_STATIC_DRAW);
+
+    renderState->CountUpload((int)(mVertices.size() * sizeof(JSpriteVertex) + mIndices.size() * sizeof(GLushort)));
+
+    renderState->BindVertexArray(0);
+    renderState->BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // only the buffers are needed from now on
+    std::vector<JSpriteVertex>().swap(mVertices);
+    std::vector<GLushort>().swap(mIndices);
+}
+
+void JStaticMesh::Draw()
+{
+    if (!mBuilt)
+        Build();
+
+    if (mSections.empty())
+        return;
+
+    JRenderState *renderState = JRenderState::GetInstance();
+    renderState->BeginSubmit();
+
+    for (size_t i = 0; i < mSections.size(); i++)
+    {
+        const Section &section = mSections[i];
+
+        if (section.texture)
+        {
+            mTextureShader.Use();
+            renderState->ActiveTexture(GL_TEXTURE0);
+            renderState->BindTexture(section.texture->mTexId);
+
+            if (section.textureFilter == TEX_FILTER_LINEAR)
+                renderState->SetTextureFilter(section.texture, true);
+            else if (section.textureFilter == TEX_FILTER_NEAREST)
+                renderState->SetTextureFilter(section.texture, false);
+            renderState->SetTextureWrap(section.texture, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+            renderState->BindVertexArray(mTextureVAO);
+        }
+        else
+        {
+            mColorShader.Use();
+            renderState->BindVertexArray(mColorVAO);
+        }
+
+        if (section.mode == GL_LINES)
+            glLineWidth(section.lineWidth);
+
+        glDrawElements(section.mode, section.count, GL_UNSIGNED_SHORT, (GLvoid*)(section.first * sizeof(GLushort)));
+        renderState->CountDraw(section.count);
+    }
+
+    renderState->EndSubmit();
+}
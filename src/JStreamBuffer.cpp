@@ -0,0 +1,67 @@
+#include "../include/JStreamBuffer.h"
+#include "../include/JRenderState.h"
+
+#include <stddef.h>
+
+// allocations are kept 4 byte aligned, enough for any attribute or index type
+#define STREAM_BUFFER_ALIGNMENT	4
+
+JStreamBuffer::JStreamBuffer(GLenum target, int frameSize)
+{
+    mTarget = target;
+    mFrameSize = frameSize;
+    mFrame = 0;
+    mOffset = 0;
+
+    glGenBuffers(1, &mBuffer);
+    JRenderState::GetInstance()->BindBuffer(mTarget, mBuffer);
+    glBufferData(mTarget, mFrameSize * STREAM_BUFFER_FRAMES, NULL, GL_DYNAMIC_DRAW);
+}
+
+JStreamBuffer::~JStreamBuffer()
+{
+    JRenderState::GetInstance()->DeleteBuffer(mBuffer);
+}
+
+void JStreamBuffer::Grow(int size)
+{
+    while (mFrameSize < size)
+        mFrameSize *= 2;
+
+    // orphan the old storage: draws already issued keep reading from it
+    JRenderState::GetInstance()->BindBuffer(mTarget, mBuffer);
+    glBufferData(mTarget, mFrameSize * STREAM_BUFFER_FRAMES, NULL, GL_DYNAMIC_DRAW);
+
+    mFrame = 0;
+    mOffset = 0;
+}
+
+GLintptr JStreamBuffer::Upload(const void *data, int size)
+{
+    int aligned = (mOffset + STREAM_BUFFER_ALIGNMENT - 1) & ~(STREAM_BUFFER_ALIGNMENT - 1);
+
+    if (aligned + size > mFrameSize)
+    {
+        // size for the whole frame so far, not just this allocation
+        Grow(aligned + size);
+        aligned = 0;
+    }
+    else
+    {
+        JRenderState::GetInstance()->BindBuffer(mTarget, mBuffer);
+    }
+
+    GLintptr offset = mFrame * mFrameSize + aligned;
+    glBufferSubData(mTarget, offset, size, data);
+    JRenderState::GetInstance()->CountUpload(size);
+
+    mOffset = aligned + size;
+
+    return offset;
+}
+
+void JStreamBuffer::NextFrame()
+{
+    mFrame = (mFrame + 1) % STREAM_BUFFER_FRAMES;
+    mOffset = 0;
+}
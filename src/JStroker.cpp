@@ -0,0 +1,242 @@
+#include "../include/JStroker.h"
+
+#include <math.h>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846f
+#endif
+
+namespace
+{
+	struct Vec
+	{
+		float x, y;
+	};
+
+	inline Vec Make(float x, float y) { Vec v = { x, y }; return v; }
+	inline Vec operator+(Vec a, Vec b) { return Make(a.x + b.x, a.y + b.y); }
+	inline Vec operator-(Vec a, Vec b) { return Make(a.x - b.x, a.y - b.y); }
+	inline Vec operator*(Vec a, float s) { return Make(a.x * s, a.y * s); }
+	inline float Dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+	inline float Cross(Vec a, Vec b) { return a.x * b.y - a.y * b.x; }
+	inline Vec Normal(Vec d) { return Make(-d.y, d.x); }
+
+	// Collects the strip as pairs of points on the two sides of the path.
+	struct Strip
+	{
+		std::vector<float> &x;
+		std::vector<float> &y;
+
+		Strip(std::vector<float> &stripX, std::vector<float> &stripY) : x(stripX), y(stripY) { }
+
+		void Pair(Vec left, Vec right)
+		{
+			x.push_back(left.x);
+			y.push_back(left.y);
+			x.push_back(right.x);
+			y.push_back(right.y);
+		}
+	};
+
+	// Steps needed for an arc of the given angle to stay within STROKE_TOLERANCE.
+	int ArcSteps(float angle, float radius)
+	{
+		if (radius <= STROKE_TOLERANCE)
+			return 1;
+
+		float step = 2.0f * acosf(1.0f - STROKE_TOLERANCE / radius);
+		int steps = (int)ceilf(fabsf(angle) / step);
+		return steps < 1 ? 1 : steps;
+	}
+
+	// Rotate v by angle.
+	inline Vec Rotate(Vec v, float c, float s)
+	{
+		return Make(v.x * c - v.y * s, v.x * s + v.y * c);
+	}
+
+	void Cap(Strip &strip, Vec p, Vec d, float hw, bool start)
+	{
+		// quarter circles on both sides, as pairs mirrored across the path
+		// so the cap stays part of the strip
+		Vec n = Normal(d);
+		Vec out = start ? d * -1.0f : d;
+		int steps = ArcSteps(0.5f * (float)M_PI, hw);
+
+		for (int i = 0; i < steps; i++)
+		{
+			// start cap runs from the tip to the sides, end cap the other way
+			int k = start ? steps - i : i + 1;
+			float a = 0.5f * (float)M_PI * k / steps;
+			Vec side = n * (hw * cosf(a));
+			Vec ahead = out * (hw * sinf(a));
+			strip.Pair(p + side + ahead, p - side + ahead);
+		}
+	}
+
+	// Join of segments a and b at p. With tailOnly only the last pair is
+	// emitted, which starts a closed path.
+	void Join(Strip &strip, Vec p, Vec a, Vec b, float maxInner, float hw, int join, bool tailOnly)
+	{
+		Vec na = Normal(a);
+		Vec nb = Normal(b);
+		float cross = Cross(a, b);
+		float dot = Dot(a, b);
+
+		if (fabsf(cross) < 1e-6f && dot > 0.0f)
+		{
+			// straight on
+			strip.Pair(p + na * hw, p - na * hw);
+			return;
+		}
+
+		// inner side is +1 when turning towards the normal
+		float inner = (cross > 0.0f) ? 1.0f : -1.0f;
+
+		Vec innerPoint = p;
+		float miter = 0.0f;
+		Vec m = na + nb;
+		float mLength = sqrtf(Dot(m, m));
+
+		if (mLength < 1e-4f)
+		{
+			// path turns back on itself, there is no miter
+			if (join == LINE_JOIN_MITER)
+				join = LINE_JOIN_BEVEL;
+		}
+		else
+		{
+			m = m * (1.0f / mLength);
+			miter = hw / Dot(m, na);
+
+			// keep the inner point from overshooting short segments
+			innerPoint = p + m * (inner * std::min(miter, maxInner));
+		}
+
+		if (join == LINE_JOIN_MITER && miter <= hw * STROKE_MITER_LIMIT)
+		{
+			Vec outerPoint = p - m * (inner * miter);
+			if (inner > 0.0f)
+				strip.Pair(innerPoint, outerPoint);
+			else
+				strip.Pair(outerPoint, innerPoint);
+			return;
+		}
+
+		// bevel and round walk the outer side from segment a to segment b,
+		// turning the same way as the path
+		float angle = acosf(std::max(-1.0f, std::min(1.0f, dot)));
+		int steps = (join == LINE_JOIN_ROUND) ? ArcSteps(angle, hw) : 1;
+
+		float stepAngle = inner * angle / steps;
+		float c = cosf(stepAngle);
+		float s = sinf(stepAngle);
+
+		Vec outer = na * (-inner * hw);
+		for (int i = 0; i <= steps; i++)
+		{
+			if (i == steps)
+				outer = nb * (-inner * hw);
+
+			if (!tailOnly || i == steps)
+			{
+				if (inner > 0.0f)
+					strip.Pair(innerPoint, p + outer);
+				else
+					strip.Pair(p + outer, innerPoint);
+			}
+			outer = Rotate(outer, c, s);
+		}
+	}
+}
+
+void JStroker::Stroke(const float *x, const float *y, int count, float width, int join, int cap, bool closed,
+                      std::vector<float> &stripX, std::vector<float> &stripY)
+{
+    stripX.clear();
+    stripY.clear();
+
+    float hw = width * 0.5f;
+    if (hw <= 0.0f)
+        return;
+
+    // drop repeated points, they have no direction
+    std::vector<Vec> points;
+    for (int i = 0; i < count; i++)
+    {
+        Vec p = Make(x[i], y[i]);
+        if (points.empty() || p.x != points.back().x || p.y != points.back().y)
+            points.push_back(p);
+    }
+
+    if (closed && points.size() > 2 && points.back().x == points[0].x && points.back().y == points[0].y)
+        points.pop_back();
+
+    int n = (int)points.size();
+    if (n < 2)
+        return;
+    if (n < 3)
+        closed = false;
+
+    int segmentCount = closed ? n : n - 1;
+    std::vector<Vec> directions(segmentCount);
+    std::vector<float> lengths(segmentCount);
+    for (int i = 0; i < segmentCount; i++)
+    {
+        Vec d = points[(i + 1) % n] - points[i];
+        lengths[i] = sqrtf(Dot(d, d));
+        directions[i] = d * (1.0f / lengths[i]);
+    }
+
+    Strip strip(stripX, stripY);
+
+    if (closed)
+    {
+        // start with the end of the join at the first point, the path
+        // comes back to it through the full join
+        float shortest = std::min(lengths[n - 1], lengths[0]);
+        Join(strip, points[0], directions[n - 1], directions[0], sqrtf(hw * hw + shortest * shortest), hw, join, true);
+    }
+    else
+    {
+        Vec start = points[0];
+        Vec d = directions[0];
+        if (cap == LINE_CAP_SQUARE)
+            start = start - d * hw;
+        else if (cap == LINE_CAP_ROUND)
+            Cap(strip, start, d, hw, true);
+
+        Vec nrm = Normal(d) * hw;
+        strip.Pair(start + nrm, start - nrm);
+    }
+
+    int joinCount = closed ? n + 1 : n - 1;
+    for (int i = 1; i < joinCount; i++)
+    {
+        int previous = i - 1;
+        int next = i % segmentCount;
+        float shortest = std::min(lengths[previous], lengths[next]);
+
+        Join(strip, points[i % n], directions[previous], directions[next], sqrtf(hw * hw + shortest * shortest), hw, join, false);
+    }
+
+    if (!closed)
+    {
+        Vec end = points[n - 1];
+        Vec d = directions[n - 2];
+        if (cap == LINE_CAP_SQUARE)
+            end = end + d * hw;
+
+        Vec nrm = Normal(d) * hw;
+        strip.Pair(end + nrm, end - nrm);
+
+        if (cap == LINE_CAP_ROUND)
+            Cap(strip, end, d, hw, false);
+    }
+}
+
+JStrokedPath::JStrokedPath(const float *x, const float *y, int count, float width, int join, int cap, bool closed)
+{
+    JStroker::Stroke(x, y, count, width, join, cap, closed, mStripX, mStripY);
+}
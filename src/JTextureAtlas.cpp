@@ -0,0 +1,238 @@
+#include "../include/JTextureAtlas.h"
+#include "../include/JRenderer.h"
+#include "../include/JResourceManager.h"
+#include "../include/JRenderState.h"
+
+#include <algorithm>
+
+JTextureAtlas::JTextureAtlas(int pageSize, int padding, int maxPages)
+{
+    mPageSize = pageSize;
+    mPadding = padding;
+    mMaxPages = maxPages;
+}
+
+JTextureAtlas::~JTextureAtlas()
+{
+    for (size_t i = 0; i < mImages.size(); i++)
+    {
+        delete [] mImages[i].bits;
+        delete mImages[i].quad;
+    }
+
+    for (size_t i = 0; i < mPackers.size(); i++)
+        delete mPackers[i];
+
+    SetPageCount(0);
+}
+
+JQuad* JTextureAtlas::AddFile(const char *filename)
+{
+    JQuad *quad = GetQuad(filename);
+    if (quad)
+        return quad;
+
+    int width, height, pitch;
+    u8 *bits = JResourceManager::LoadImageBits(filename, width, height, pitch);
+    if (bits == NULL)
+        return NULL;
+
+    quad = AddImage(filename, (PIXEL_TYPE*)bits, width, height, pitch);
+    delete [] bits;
+
+    return quad;
+}
+
+JQuad* JTextureAtlas::AddImage(const char *name, const PIXEL_TYPE *bits, int width, int height, int pitch)
+{
+    JQuad *quad = GetQuad(name);
+    if (quad)
+        return quad;
+
+    if (width <= 0 || height <= 0 || width + 2*mPadding > mPageSize || height + 2*mPadding > mPageSize)
+    {
+        printf("Image %s does not fit in an atlas page\n", name);
+        return NULL;
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.bits = new PIXEL_TYPE[width * height];
+    for (int y = 0; y < height; y++)
+        memcpy(image.bits + y*width, bits + y*pitch, width * sizeof(PIXEL_TYPE));
+
+    bool placed = Place(mPackers, image);
+    if (!placed && Repack())
+        placed = Place(mPackers, image);
+
+    if (!placed)
+    {
+        printf("Texture atlas is full, %s not added\n", name);
+        delete [] image.bits;
+        return NULL;
+    }
+
+    SetPageCount((int)mPackers.size());
+
+    image.quad = new JQuad(mPages[image.page], 0.0f, 0.0f, (float)width, (float)height);
+    UpdateQuad(image);
+    Upload(image);
+
+    mImageIndex[name] = (int)mImages.size();
+    mImages.push_back(image);
+
+    return image.quad;
+}
+
+JQuad* JTextureAtlas::GetQuad(const char *name) const
+{
+    std::map<std::string, int>::const_iterator it = mImageIndex.find(name);
+    if (it == mImageIndex.end())
+        return NULL;
+
+    return mImages[it->second].quad;
+}
+
+float JTextureAtlas::GetOccupancy() const
+{
+    if (mPages.empty())
+        return 0.0f;
+
+    float occupancy = 0.0f;
+    for (size_t i = 0; i < mPackers.size(); i++)
+        occupancy += mPackers[i]->GetOccupancy();
+
+    return occupancy / mPackers.size();
+}
+
+bool JTextureAtlas::Place(std::vector<JSkylinePacker*> &packers, Image &image)
+{
+    int width = image.width + 2*mPadding;
+    int height = image.height + 2*mPadding;
+    int x, y;
+
+    for (size_t i = 0; i < packers.size(); i++)
+    {
+        if (packers[i]->Insert(width, height, x, y))
+        {
+            image.page = (int)i;
+            image.x = x + mPadding;
+            image.y = y + mPadding;
+            return true;
+        }
+    }
+
+    if (mMaxPages > 0 && (int)packers.size() >= mMaxPages)
+        return false;
+
+    packers.push_back(new JSkylinePacker(mPageSize, mPageSize));
+    packers.back()->Insert(width, height, x, y);
+
+    image.page = (int)packers.size() - 1;
+    image.x = x + mPadding;
+    image.y = y + mPadding;
+    return true;
+}
+
+void JTextureAtlas::SetPageCount(int count)
+{
+    while ((int)mPages.size() > count)
+    {
+        delete mPages.back();
+        mPages.pop_back();
+    }
+
+    while ((int)mPages.size() < count)
+    {
+        JTexture *page = JRenderer::GetInstance()->CreateTexture(mPageSize, mPageSize);
+        JRenderState::GetInstance()->SetTextureWrap(page, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        mPages.push_back(page);
+    }
+}
+
+void JTextureAtlas::ClearPage(int page)
+{
+    std::vector<PIXEL_TYPE> empty(mPageSize * mPageSize, 0);
+    mPages[page]->UpdateBits(mPageSize, mPageSize, &empty[0]);
+}
+
+void JTextureAtlas::Upload(const Image &image)
+{
+    int width = image.width + 2*mPadding;
+    int height = image.height + 2*mPadding;
+
+    // extrude the edges of the image into the padding
+    std::vector<PIXEL_TYPE> cell(width * height);
+    for (int y = 0; y < height; y++)
+    {
+        int sy = std::min(std::max(y - mPadding, 0), image.height - 1);
+        const PIXEL_TYPE *src = image.bits + sy*image.width;
+        PIXEL_TYPE *dst = &cell[y*width];
+
+        for (int x = 0; x < width; x++)
+            dst[x] = src[std::min(std::max(x - mPadding, 0), image.width - 1)];
+    }
+
+    JRenderState::GetInstance()->BindTexture(mPages[image.page]->mTexId);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, image.x - mPadding, image.y - mPadding, width, height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, &cell[0]);
+    JRenderState::GetInstance()->CountUpload(width * height * sizeof(PIXEL_TYPE));
+}
+
+void JTextureAtlas::UpdateQuad(Image &image)
+{
+    image.quad->mTex = mPages[image.page];
+    image.quad->SetTextureRect((float)image.x, (float)image.y, (float)image.width, (float)image.height);
+}
+
+static bool IsTaller(const std::pair<int, int> &a, const std::pair<int, int> &b)
+{
+    return a.first > b.first;
+}
+
+bool JTextureAtlas::Repack()
+{
+    if (mImages.empty())
+        return true;
+
+    // tallest first, the skyline stays flat that way
+    std::vector<std::pair<int, int> > order;
+    for (size_t i = 0; i < mImages.size(); i++)
+        order.push_back(std::make_pair(mImages[i].height * mPageSize + mImages[i].width, (int)i));
+    std::stable_sort(order.begin(), order.end(), IsTaller);
+
+    // pack into new packers, the current layout stays valid if it fails
+    std::vector<JSkylinePacker*> packers;
+    std::vector<Image> packed = mImages;
+    bool placed = true;
+    for (size_t i = 0; i < order.size() && placed; i++)
+        placed = Place(packers, packed[order[i].second]);
+
+    if (!placed)
+    {
+        for (size_t i = 0; i < packers.size(); i++)
+            delete packers[i];
+        return false;
+    }
+
+    // quads of pending batches still point at the old layout
+    JRenderer::GetInstance()->FlushBatch();
+
+    for (size_t i = 0; i < mPackers.size(); i++)
+        delete mPackers[i];
+    mPackers = packers;
+    mImages = packed;
+
+    SetPageCount((int)mPackers.size());
+    for (size_t i = 0; i < mPages.size(); i++)
+        ClearPage((int)i);
+
+    for (size_t i = 0; i < mImages.size(); i++)
+    {
+        UpdateQuad(mImages[i]);
+        Upload(mImages[i]);
+    }
+
+    return true;
+}
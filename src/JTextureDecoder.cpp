@@ -0,0 +1,370 @@
+#include "../include/JTextureDecoder.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// ETC1 modifiers, the negative ones are used for indices 2 and 3
+static const int ETC_MODIFIERS[8][2] =
+{
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// ETC2 T and H mode distances
+static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int EAC_MODIFIERS[16][8] =
+{
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static inline int Clamp255(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static inline int Extend4(int value)
+{
+    return (value << 4) | value;
+}
+
+static inline int Extend5(int value)
+{
+    return (value << 3) | (value >> 2);
+}
+
+static inline int Extend6(int value)
+{
+    return (value << 2) | (value >> 4);
+}
+
+static inline int Extend7(int value)
+{
+    return (value << 1) | (value >> 6);
+}
+
+static inline void SetColor(unsigned char *pixel, int r, int g, int b)
+{
+    pixel[0] = (unsigned char)Clamp255(r);
+    pixel[1] = (unsigned char)Clamp255(g);
+    pixel[2] = (unsigned char)Clamp255(b);
+}
+
+bool JTextureDecoder::IsSupported(GLenum format)
+{
+    return GetImageSize(format, 4, 4) != 0;
+}
+
+size_t JTextureDecoder::GetImageSize(GLenum format, int width, int height)
+{
+    int blockSize;
+    switch (format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_ETC1_RGB8_OES:
+    case GL_COMPRESSED_RGB8_ETC2:
+        blockSize = 8;
+        break;
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        blockSize = 16;
+        break;
+    default:
+        return 0;
+    }
+
+    return (size_t)((uint64_t)((width + 3) / 4) * (uint64_t)((height + 3) / 4) * blockSize);
+}
+
+bool JTextureDecoder::Decode(GLenum format, const unsigned char *data, int width, int height, unsigned char *pixels)
+{
+    if (!IsSupported(format))
+        return false;
+
+    size_t blockSize = GetImageSize(format, 4, 4);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+
+    unsigned char block[64];
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            const unsigned char *src = data + ((size_t)by * blocksX + bx) * blockSize;
+
+            switch (format)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                DecodeBC1(src, false, false, block);
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                DecodeBC1(src, true, false, block);
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+                DecodeBC1(src + 8, false, true, block);
+                DecodeBC2Alpha(src, block);
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                DecodeBC1(src + 8, false, true, block);
+                DecodeBC3Alpha(src, block);
+                break;
+            case GL_ETC1_RGB8_OES:
+                DecodeETC(src, false, block);
+                break;
+            case GL_COMPRESSED_RGB8_ETC2:
+                DecodeETC(src, true, block);
+                break;
+            case GL_COMPRESSED_RGBA8_ETC2_EAC:
+                DecodeETC(src + 8, true, block);
+                DecodeEACAlpha(src, block);
+                break;
+            }
+
+            // blocks on the right and bottom edges may stick out of the image
+            int columns = width - bx * 4 < 4 ? width - bx * 4 : 4;
+            int rows = height - by * 4 < 4 ? height - by * 4 : 4;
+            for (int y = 0; y < rows; y++)
+                memcpy(pixels + ((size_t)(by * 4 + y) * width + bx * 4) * 4, block + y * 16, columns * 4);
+        }
+    }
+
+    return true;
+}
+
+void JTextureDecoder::DecodeBC1(const unsigned char *block, bool alpha, bool fourColors, unsigned char *out)
+{
+    int c0 = block[0] | (block[1] << 8);
+    int c1 = block[2] | (block[3] << 8);
+
+    unsigned char colors[4][4];
+    colors[0][0] = (unsigned char)Extend5(c0 >> 11);
+    colors[0][1] = (unsigned char)Extend6((c0 >> 5) & 0x3F);
+    colors[0][2] = (unsigned char)Extend5(c0 & 0x1F);
+    colors[1][0] = (unsigned char)Extend5(c1 >> 11);
+    colors[1][1] = (unsigned char)Extend6((c1 >> 5) & 0x3F);
+    colors[1][2] = (unsigned char)Extend5(c1 & 0x1F);
+    colors[0][3] = colors[1][3] = colors[2][3] = colors[3][3] = 255;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (fourColors || c0 > c1)
+        {
+            colors[2][i] = (unsigned char)((2 * colors[0][i] + colors[1][i]) / 3);
+            colors[3][i] = (unsigned char)((colors[0][i] + 2 * colors[1][i]) / 3);
+        }
+        else
+        {
+            colors[2][i] = (unsigned char)((colors[0][i] + colors[1][i]) / 2);
+            colors[3][i] = 0;
+        }
+    }
+
+    if (alpha && !fourColors && c0 <= c1)
+        colors[3][3] = 0;
+
+    unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+    for (int i = 0; i < 16; i++)
+        memcpy(out + i * 4, colors[(indices >> (i * 2)) & 3], 4);
+}
+
+void JTextureDecoder::DecodeBC2Alpha(const unsigned char *block, unsigned char *out)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        int value = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+        out[i * 4 + 3] = (unsigned char)(value * 17);
+    }
+}
+
+void JTextureDecoder::DecodeBC3Alpha(const unsigned char *block, unsigned char *out)
+{
+    int a0 = block[0];
+    int a1 = block[1];
+
+    int alphas[8];
+    alphas[0] = a0;
+    alphas[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; i++)
+            alphas[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+            alphas[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        alphas[6] = 0;
+        alphas[7] = 255;
+    }
+
+    unsigned long long indices = 0;
+    for (int i = 7; i >= 2; i--)
+        indices = (indices << 8) | block[i];
+
+    for (int i = 0; i < 16; i++)
+        out[i * 4 + 3] = (unsigned char)alphas[(indices >> (i * 3)) & 7];
+}
+
+void JTextureDecoder::DecodeETC(const unsigned char *block, bool etc2, unsigned char *out)
+{
+    // pixel indices run down the columns, their high bits in the upper half
+    unsigned int indices = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+    bool differential = (block[3] & 2) != 0;
+
+    if (differential && etc2)
+    {
+        int r = (block[0] >> 3) + ((int)((block[0] & 7) ^ 4) - 4);
+        int g = (block[1] >> 3) + ((int)((block[1] & 7) ^ 4) - 4);
+        int b = (block[2] >> 3) + ((int)((block[2] & 7) ^ 4) - 4);
+
+        // ETC2 modes hide in differential blocks whose second color overflows
+        if (r < 0 || r > 31 || g < 0 || g > 31)
+        {
+            int paint[4][3];
+            if (r < 0 || r > 31)
+            {
+                // T mode
+                int c1[3] = { Extend4(((block[0] >> 1) & 0xC) | (block[0] & 3)), Extend4(block[1] >> 4), Extend4(block[1] & 0xF) };
+                int c2[3] = { Extend4(block[2] >> 4), Extend4(block[2] & 0xF), Extend4(block[3] >> 4) };
+                int distance = ETC_DISTANCES[((block[3] >> 1) & 6) | (block[3] & 1)];
+
+                for (int i = 0; i < 3; i++)
+                {
+                    paint[0][i] = c1[i];
+                    paint[1][i] = c2[i] + distance;
+                    paint[2][i] = c2[i];
+                    paint[3][i] = c2[i] - distance;
+                }
+            }
+            else
+            {
+                // H mode
+                int c1[3] = { Extend4((block[0] >> 3) & 0xF),
+                              Extend4(((block[0] & 7) << 1) | ((block[1] >> 4) & 1)),
+                              Extend4((block[1] & 8) | ((block[1] & 3) << 1) | (block[2] >> 7)) };
+                int c2[3] = { Extend4((block[2] >> 3) & 0xF),
+                              Extend4(((block[2] & 7) << 1) | (block[3] >> 7)),
+                              Extend4((block[3] >> 3) & 0xF) };
+
+                // the order of the colors holds the last bit of the distance
+                int order = (c1[0] << 16 | c1[1] << 8 | c1[2]) >= (c2[0] << 16 | c2[1] << 8 | c2[2]) ? 1 : 0;
+                int distance = ETC_DISTANCES[(block[3] & 4) | ((block[3] & 1) << 1) | order];
+
+                for (int i = 0; i < 3; i++)
+                {
+                    paint[0][i] = c1[i] + distance;
+                    paint[1][i] = c1[i] - distance;
+                    paint[2][i] = c2[i] + distance;
+                    paint[3][i] = c2[i] - distance;
+                }
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                int index = ((indices >> (15 + i)) & 2) | ((indices >> i) & 1);
+                unsigned char *pixel = out + ((i & 3) * 4 + (i >> 2)) * 4;
+                SetColor(pixel, paint[index][0], paint[index][1], paint[index][2]);
+                pixel[3] = 255;
+            }
+            return;
+        }
+
+        if (b < 0 || b > 31)
+        {
+            // planar mode, a gradient from three colors
+            int ro = Extend6((block[0] >> 1) & 0x3F);
+            int go = Extend7(((block[0] & 1) << 6) | ((block[1] >> 1) & 0x3F));
+            int bo = Extend6(((block[1] & 1) << 5) | (block[2] & 0x18) | ((block[2] & 3) << 1) | (block[3] >> 7));
+            int rh = Extend6(((block[3] >> 1) & 0x3E) | (block[3] & 1));
+            int gh = Extend7(block[4] >> 1);
+            int bh = Extend6(((block[4] & 1) << 5) | (block[5] >> 3));
+            int rv = Extend6(((block[5] & 7) << 3) | (block[6] >> 5));
+            int gv = Extend7(((block[6] & 0x1F) << 2) | (block[7] >> 6));
+            int bv = Extend6(block[7] & 0x3F);
+
+            for (int y = 0; y < 4; y++)
+            {
+                for (int x = 0; x < 4; x++)
+                {
+                    unsigned char *pixel = out + (y * 4 + x) * 4;
+                    SetColor(pixel, (x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+                             (x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+                             (x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+                    pixel[3] = 255;
+                }
+            }
+            return;
+        }
+    }
+
+    int base[2][3];
+    if (differential)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            int value = block[i] >> 3;
+            base[0][i] = Extend5(value);
+            base[1][i] = Extend5((value + ((int)((block[i] & 7) ^ 4) - 4)) & 0x1F);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            base[0][i] = Extend4(block[i] >> 4);
+            base[1][i] = Extend4(block[i] & 0xF);
+        }
+    }
+
+    const int *modifiers[2] = { ETC_MODIFIERS[block[3] >> 5], ETC_MODIFIERS[(block[3] >> 2) & 7] };
+    bool flip = (block[3] & 1) != 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        int x = i >> 2;
+        int y = i & 3;
+        int half = flip ? y >> 1 : x >> 1;
+
+        int modifier = modifiers[half][(indices >> i) & 1];
+        if ((indices >> (16 + i)) & 1)
+            modifier = -modifier;
+
+        unsigned char *pixel = out + (y * 4 + x) * 4;
+        SetColor(pixel, base[half][0] + modifier, base[half][1] + modifier, base[half][2] + modifier);
+        pixel[3] = 255;
+    }
+}
+
+void JTextureDecoder::DecodeEACAlpha(const unsigned char *block, unsigned char *out)
+{
+    int base = block[0];
+    int multiplier = block[1] >> 4;
+    const int *modifiers = EAC_MODIFIERS[block[1] & 0xF];
+
+    unsigned long long indices = 0;
+    for (int i = 2; i < 8; i++)
+        indices = (indices << 8) | block[i];
+
+    // 3 bit indices down the columns, the first pixel in the top bits
+    for (int i = 0; i < 16; i++)
+    {
+        int modifier = modifiers[(indices >> (45 - i * 3)) & 7];
+        out[((i & 3) * 4 + (i >> 2)) * 4 + 3] = (unsigned char)Clamp255(base + modifier * multiplier);
+    }
+}
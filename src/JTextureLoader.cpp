@@ -0,0 +1,270 @@
+#include "../include/JTextureLoader.h"
+#include "../include/JResourceManager.h"
+#include "../include/JFileSystem.h"
+#include "../include/JRenderState.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+struct JTextureLoader::Job
+{
+    JTexture *texture;      // NULL once cancelled
+    std::string filename;
+    int flags;
+    JResourceManager::TextureData data;
+    bool loaded;
+};
+
+JTextureLoader* JTextureLoader::mInstance = NULL;
+
+JTextureLoader* JTextureLoader::GetInstance()
+{
+    if (mInstance == NULL)
+        mInstance = new JTextureLoader();
+
+    return mInstance;
+}
+
+void JTextureLoader::Destroy()
+{
+    if (mInstance)
+    {
+        delete mInstance;
+        mInstance = NULL;
+    }
+}
+
+JTextureLoader::JTextureLoader()
+{
+    mPendingCount = 0;
+    mUploadBytes = TEXTURE_LOADER_UPLOAD_BYTES;
+    mUploadTime = TEXTURE_LOADER_UPLOAD_TIME;
+    mPlaceholderColor = ARGB(0, 0, 0, 0);
+
+#ifdef JGE_THREADS
+    mQuit = false;
+#endif
+}
+
+JTextureLoader::~JTextureLoader()
+{
+#ifdef JGE_THREADS
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (size_t i = 0; i < mWorkers.size(); i++)
+        mWorkers[i].join();
+#endif
+
+    // workers finish the jobs they were reading before quitting
+    std::deque<Job*> jobs(mQueued);
+    jobs.insert(jobs.end(), mFinished.begin(), mFinished.end());
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (jobs[i]->texture)
+            jobs[i]->texture->mLoading = false;
+        delete jobs[i];
+    }
+}
+
+JTexture* JTextureLoader::LoadTexture(const char *filename, int flags)
+{
+    // asked here so that loading threads only read the cached answers
+    JFileSystem::GetInstance();
+    JResourceManager::IsNPOTSupported();
+    JResourceManager::IsCompressedFormatSupported(0);
+
+    GLuint texid;
+    glGenTextures(1, &texid);
+    if (texid == 0)
+    {
+        printf("Failed to load texture %s \n", filename);
+        return NULL;
+    }
+
+    JTexture *tex = new JTexture();
+    tex->mTexId = texid;
+    tex->mWidth = tex->mHeight = 1;
+    tex->mTexWidth = tex->mTexHeight = 1;
+    tex->mLoading = true;
+
+    JRenderState *renderState = JRenderState::GetInstance();
+    renderState->BindTexture(texid);
+    renderState->SetTextureWrap(tex, GL_REPEAT, GL_REPEAT);
+    renderState->SetTextureFilter(tex, GL_LINEAR, GL_LINEAR);
+
+    PIXEL_TYPE texel = ARGB_TO_RGBA8(mPlaceholderColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texel);
+    renderState->CountUpload(sizeof(PIXEL_TYPE));
+
+    Job *job = new Job();
+    job->texture = tex;
+    job->filename = filename;
+    job->flags = flags;
+    job->loaded = false;
+    mPendingCount++;
+
+#ifdef JGE_THREADS
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueued.push_back(job);
+    }
+
+    if (mWorkers.empty())
+    {
+        for (int i = 0; i < TEXTURE_LOADER_WORKERS; i++)
+            mWorkers.push_back(std::thread(&JTextureLoader::WorkerLoop, this));
+    }
+    mWakeCondition.notify_one();
+#else
+    mQueued.push_back(job);
+#endif
+
+    return tex;
+}
+
+void JTextureLoader::SetUploadBudget(int bytes, float milliseconds)
+{
+    mUploadBytes = bytes;
+    mUploadTime = milliseconds;
+}
+
+void JTextureLoader::Upload(Job *job)
+{
+    JTexture *tex = job->texture;
+    tex->mLoading = false;
+    mPendingCount--;
+
+    if (job->loaded)
+        JResourceManager::UploadTexture(tex, job->data);
+    else
+        printf("Failed to load texture %s \n", job->filename.c_str());
+}
+
+void JTextureLoader::Update()
+{
+    if (mPendingCount == 0)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int bytes = 0;
+
+    for (;;)
+    {
+        Job *job = NULL;
+
+#ifdef JGE_THREADS
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mFinished.empty())
+            {
+                job = mFinished.front();
+                mFinished.pop_front();
+            }
+        }
+#else
+        if (!mQueued.empty())
+        {
+            job = mQueued.front();
+            mQueued.pop_front();
+            job->loaded = JResourceManager::ReadTexture(job->filename.c_str(), job->flags, job->data);
+        }
+#endif
+
+        if (job == NULL)
+            break;
+
+        if (job->loaded)
+        {
+            const JResourceManager::TextureData &data = job->data;
+            if (data.mIsCompressed)
+            {
+                for (size_t level = 0; level < data.mCompressed.mLevelSizes.size(); level++)
+                    bytes += data.mCompressed.mLevelSizes[level];
+            }
+            else
+                bytes += data.mImage.mTexWidth * data.mImage.mTexHeight * sizeof(PIXEL_TYPE);
+        }
+
+        Upload(job);
+        delete job;
+
+        float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if ((mUploadBytes > 0 && bytes >= mUploadBytes) || (mUploadTime > 0.0f && elapsed >= mUploadTime))
+            break;
+    }
+}
+
+void JTextureLoader::Cancel(JTexture *tex)
+{
+#ifdef JGE_THREADS
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // a worker reading it drops the job when done
+    for (size_t i = 0; i < mRunning.size(); i++)
+    {
+        if (mRunning[i]->texture == tex)
+        {
+            mRunning[i]->texture = NULL;
+            tex->mLoading = false;
+            mPendingCount--;
+            return;
+        }
+    }
+#endif
+
+    std::deque<Job*> *lists[2] = { &mQueued, &mFinished };
+    for (int i = 0; i < 2; i++)
+    {
+        for (std::deque<Job*>::iterator it = lists[i]->begin(); it != lists[i]->end(); ++it)
+        {
+            if ((*it)->texture == tex)
+            {
+                delete *it;
+                lists[i]->erase(it);
+                tex->mLoading = false;
+                mPendingCount--;
+                return;
+            }
+        }
+    }
+}
+
+#ifdef JGE_THREADS
+
+void JTextureLoader::WorkerLoop()
+{
+    for (;;)
+    {
+        Job *job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [&] { return mQuit || !mQueued.empty(); });
+            if (mQuit)
+                return;
+
+            job = mQueued.front();
+            mQueued.pop_front();
+            mRunning.push_back(job);
+        }
+
+        job->loaded = JResourceManager::ReadTexture(job->filename.c_str(), job->flags, job->data);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunning.erase(std::find(mRunning.begin(), mRunning.end(), job));
+
+            if (job->texture)
+                mFinished.push_back(job);
+            else
+                delete job;
+        }
+    }
+}
+
+#endif
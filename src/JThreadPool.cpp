@@ -0,0 +1,136 @@
+#include "../include/JThreadPool.h"
+
+#include <stddef.h>
+
+JThreadPool* JThreadPool::mInstance = NULL;
+
+JThreadPool* JThreadPool::GetInstance()
+{
+    if (mInstance == NULL)
+    {
+        int workers = THREAD_POOL_DEFAULT_WORKERS;
+#ifdef JGE_THREADS
+        // the calling thread works too
+        if (std::thread::hardware_concurrency() > 1)
+            workers = std::thread::hardware_concurrency() - 1;
+#endif
+        mInstance = new JThreadPool(workers);
+    }
+
+    return mInstance;
+}
+
+void JThreadPool::Destroy()
+{
+    if (mInstance)
+    {
+        delete mInstance;
+        mInstance = NULL;
+    }
+}
+
+#ifdef JGE_THREADS
+
+JThreadPool::JThreadPool(int workerCount)
+{
+    mTask = NULL;
+    mTaskCount = 0;
+    mNextTask = 0;
+    mFinishedWorkers = 0;
+    mGeneration = 0;
+    mQuit = false;
+
+    for (int i = 0; i < workerCount; i++)
+        mWorkers.push_back(std::thread(&JThreadPool::WorkerLoop, this, i + 1));
+}
+
+JThreadPool::~JThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (size_t i = 0; i < mWorkers.size(); i++)
+        mWorkers[i].join();
+}
+
+void JThreadPool::RunTasks(int thread)
+{
+    int task;
+    while ((task = mNextTask.fetch_add(1)) < mTaskCount)
+        (*mTask)(task, thread);
+}
+
+void JThreadPool::WorkerLoop(int thread)
+{
+    unsigned int generation = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [&] { return mQuit || mGeneration != generation; });
+            if (mQuit)
+                return;
+            generation = mGeneration;
+        }
+
+        RunTasks(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFinishedWorkers++;
+        }
+        mDoneCondition.notify_one();
+    }
+}
+
+void JThreadPool::Run(int taskCount, const std::function<void(int task, int thread)> &task)
+{
+    if (taskCount <= 0)
+        return;
+
+    if (taskCount == 1 || mWorkers.empty())
+    {
+        for (int i = 0; i < taskCount; i++)
+            task(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mTaskCount = taskCount;
+        mNextTask = 0;
+        mFinishedWorkers = 0;
+        mGeneration++;
+    }
+    mWakeCondition.notify_all();
+
+    RunTasks(0);
+
+    // workers still touch mTask until they report back
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [&] { return mFinishedWorkers == (int)mWorkers.size(); });
+    mTask = NULL;
+}
+
+#else
+
+JThreadPool::JThreadPool(int workerCount)
+{
+}
+
+JThreadPool::~JThreadPool()
+{
+}
+
+void JThreadPool::Run(int taskCount, const std::function<void(int task, int thread)> &task)
+{
+    for (int i = 0; i < taskCount; i++)
+        task(i, 0);
+}
+
+#endif
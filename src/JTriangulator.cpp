@@ -0,0 +1,107 @@
+#include "../include/JTriangulator.h"
+
+#include <stdio.h>
+
+#include <array>
+#include <limits>
+
+#include "../include/earcut.hpp"
+
+JTriangulator::JTriangulator()
+{
+    mFrame = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+JTriangulator::~JTriangulator()
+{
+}
+
+// 64 bit FNV-1a over the raw bytes
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+const std::vector<GLushort>& JTriangulator::Triangulate(const float *x, const float *y, const int *ringCounts, int ringCount)
+{
+    int vertexCount = 0;
+    for (int i = 0; i < ringCount; i++)
+        vertexCount += ringCounts[i];
+
+    // earcut numbers the vertices with GLushort, larger polygons would wrap
+    if (vertexCount > TRIANGULATOR_MAX_VERTICES)
+    {
+        printf("Too many vertices to triangulate: %d\n", vertexCount);
+        mEmpty.clear();
+        return mEmpty;
+    }
+
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, ringCounts, ringCount * sizeof(int));
+    hash = HashBytes(hash, x, vertexCount * sizeof(float));
+    hash = HashBytes(hash, y, vertexCount * sizeof(float));
+
+    std::map<uint64_t, Entry>::iterator it = mCache.find(hash);
+    if (it != mCache.end() && it->second.vertexCount == vertexCount)
+    {
+        mHits++;
+        it->second.lastFrame = mFrame;
+        return it->second.indices;
+    }
+
+    mMisses++;
+
+    typedef std::array<float, 2> Point;
+    std::vector<std::vector<Point> > polygon(ringCount);
+
+    int vertex = 0;
+    for (int i = 0; i < ringCount; i++)
+    {
+        polygon[i].resize(ringCounts[i]);
+        for (int j = 0; j < ringCounts[i]; j++, vertex++)
+        {
+            polygon[i][j][0] = x[vertex];
+            polygon[i][j][1] = y[vertex];
+        }
+    }
+
+    Entry &entry = mCache[hash];
+    entry.vertexCount = vertexCount;
+    entry.lastFrame = mFrame;
+    entry.indices = mapbox::earcut<GLushort>(polygon);
+
+    return entry.indices;
+}
+
+void JTriangulator::NextFrame()
+{
+    mFrame++;
+
+    std::map<uint64_t, Entry>::iterator it = mCache.begin();
+    while (it != mCache.end())
+    {
+        if (mFrame - it->second.lastFrame > TRIANGULATION_CACHE_FRAMES)
+            mCache.erase(it++);
+        else
+            ++it;
+    }
+}
+
+void JTriangulator::Clear()
+{
+    mCache.clear();
+}
+
+void JTriangulator::ResetCounters()
+{
+    mHits = 0;
+    mMisses = 0;
+}
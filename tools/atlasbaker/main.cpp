@@ -0,0 +1,358 @@
+//////////////////////////////////////////////////////////////////////////
+/// atlasbaker - packs a directory of PNG images into atlas pages and a
+/// binary index loaded by JResourceManager::LoadAtlas.
+///
+/// Usage: atlasbaker [options] <image dir> <output>
+///
+///		-s <size>		page width and height (default 2048)
+///		-p <pixels>		padding around each image (default 2)
+///		-c				hot spots at the image centres (default top-left)
+///		-n				do not trim transparent borders
+///
+/// Writes <output>.atlas and <output>_<page>.png.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <png.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "JAtlasFormat.h"
+#include "JSkylinePacker.h"
+
+struct Image
+{
+    std::string name;
+    std::vector<uint32_t> bits;		// RGBA8
+    int width, height;
+
+    // trimmed rect in the source image
+    int trimX, trimY;
+    int trimWidth, trimHeight;
+
+    int page;
+    int x, y;
+};
+
+static bool ReadPNG(const std::string &path, Image &image)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, NULL);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+
+    int colorType = png_get_color_type(png, info);
+    int bitDepth = png_get_bit_depth(png, info);
+
+    png_set_strip_16(png);
+    png_set_packing(png);
+    if (colorType == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8) png_set_expand_gray_1_2_4_to_8(png);
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png);
+    png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+    png_read_update_info(png, info);
+
+    image.width = png_get_image_width(png, info);
+    image.height = png_get_image_height(png, info);
+    image.bits.resize(image.width * image.height);
+
+    std::vector<png_bytep> rows(image.height);
+    for (int y = 0; y < image.height; y++)
+        rows[y] = (png_bytep)&image.bits[y * image.width];
+
+    png_read_image(png, &rows[0]);
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(file);
+
+    return true;
+}
+
+static bool WritePNG(const std::string &path, const std::vector<uint32_t> &bits, int width, int height)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for (int y = 0; y < height; y++)
+        png_write_row(png, (png_const_bytep)&bits[y * width]);
+
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+
+    return true;
+}
+
+static void Trim(Image &image)
+{
+    int left = image.width, right = -1, top = image.height, bottom = -1;
+
+    for (int y = 0; y < image.height; y++)
+    {
+        for (int x = 0; x < image.width; x++)
+        {
+            if ((image.bits[y * image.width + x] >> 24) == 0)
+                continue;
+
+            left = std::min(left, x);
+            right = std::max(right, x);
+            top = std::min(top, y);
+            bottom = std::max(bottom, y);
+        }
+    }
+
+    if (right < 0)
+    {
+        // fully transparent, keep a single pixel
+        right = left = bottom = top = 0;
+    }
+
+    image.trimX = left;
+    image.trimY = top;
+    image.trimWidth = right - left + 1;
+    image.trimHeight = bottom - top + 1;
+}
+
+static bool IsTaller(const Image *a, const Image *b)
+{
+    if (a->trimHeight != b->trimHeight)
+        return a->trimHeight > b->trimHeight;
+    return a->trimWidth > b->trimWidth;
+}
+
+static void Usage()
+{
+    printf("usage: atlasbaker [-s size] [-p padding] [-c] [-n] <image dir> <output>\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int pageSize = 2048;
+    int padding = 2;
+    bool centerHotSpots = false;
+    bool trim = true;
+
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+            pageSize = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-p") == 0 && arg + 1 < argc)
+            padding = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "-c") == 0)
+            centerHotSpots = true;
+        else if (strcmp(argv[arg], "-n") == 0)
+            trim = false;
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (argc - arg != 2 || pageSize <= 0 || padding < 0)
+    {
+        Usage();
+        return 1;
+    }
+
+    std::string inputDir = argv[arg];
+    std::string output = argv[arg + 1];
+
+    DIR *dir = opendir(inputDir.c_str());
+    if (dir == NULL)
+    {
+        printf("could not open directory %s\n", inputDir.c_str());
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string file = entry->d_name;
+        if (file.size() > 4 && file.compare(file.size() - 4, 4, ".png") == 0)
+            files.push_back(file);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+
+    std::vector<Image> images(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        Image &image = images[i];
+        image.name = files[i].substr(0, files[i].size() - 4);
+
+        if (!ReadPNG(inputDir + "/" + files[i], image))
+        {
+            printf("could not read %s\n", files[i].c_str());
+            return 1;
+        }
+
+        if (trim)
+            Trim(image);
+        else
+        {
+            image.trimX = image.trimY = 0;
+            image.trimWidth = image.width;
+            image.trimHeight = image.height;
+        }
+
+        if (image.trimWidth + 2*padding > pageSize || image.trimHeight + 2*padding > pageSize)
+        {
+            printf("%s does not fit in a %dx%d page\n", files[i].c_str(), pageSize, pageSize);
+            return 1;
+        }
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (JAtlasHash(images[j].name.c_str()) == JAtlasHash(image.name.c_str()))
+            {
+                printf("hash of %s collides with %s, rename one of them\n", image.name.c_str(), images[j].name.c_str());
+                return 1;
+            }
+        }
+    }
+
+    // pack tallest first
+    std::vector<Image*> order;
+    for (size_t i = 0; i < images.size(); i++)
+        order.push_back(&images[i]);
+    std::sort(order.begin(), order.end(), IsTaller);
+
+    std::vector<JSkylinePacker> packers;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        Image &image = *order[i];
+        int width = image.trimWidth + 2*padding;
+        int height = image.trimHeight + 2*padding;
+
+        image.page = -1;
+        for (size_t p = 0; p < packers.size() && image.page < 0; p++)
+        {
+            if (packers[p].Insert(width, height, image.x, image.y))
+                image.page = (int)p;
+        }
+
+        if (image.page < 0)
+        {
+            packers.push_back(JSkylinePacker(pageSize, pageSize));
+            packers.back().Insert(width, height, image.x, image.y);
+            image.page = (int)packers.size() - 1;
+        }
+
+        image.x += padding;
+        image.y += padding;
+    }
+
+    // pages, with the edges of each image extruded into its padding
+    for (size_t p = 0; p < packers.size(); p++)
+    {
+        std::vector<uint32_t> page(pageSize * pageSize, 0);
+
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            const Image &image = images[i];
+            if (image.page != (int)p)
+                continue;
+
+            for (int y = -padding; y < image.trimHeight + padding; y++)
+            {
+                int sy = image.trimY + std::min(std::max(y, 0), image.trimHeight - 1);
+                for (int x = -padding; x < image.trimWidth + padding; x++)
+                {
+                    int sx = image.trimX + std::min(std::max(x, 0), image.trimWidth - 1);
+                    page[(image.y + y) * pageSize + image.x + x] = image.bits[sy * image.width + sx];
+                }
+            }
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s_%d.png", output.c_str(), (int)p);
+        if (!WritePNG(path, page, pageSize, pageSize))
+        {
+            printf("could not write %s\n", path);
+            return 1;
+        }
+    }
+
+    // index
+    std::vector<JAtlasEntry> entries;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        const Image &image = images[i];
+
+        JAtlasEntry entry;
+        entry.nameHash = JAtlasHash(image.name.c_str());
+        entry.page = (uint16_t)image.page;
+        entry.x = (uint16_t)image.x;
+        entry.y = (uint16_t)image.y;
+        entry.width = (uint16_t)image.trimWidth;
+        entry.height = (uint16_t)image.trimHeight;
+        entry.trimX = (int16_t)image.trimX;
+        entry.trimY = (int16_t)image.trimY;
+        entry.sourceWidth = (uint16_t)image.width;
+        entry.sourceHeight = (uint16_t)image.height;
+        entry.hotSpotX = (int16_t)(centerHotSpots ? image.width / 2 : 0);
+        entry.hotSpotY = (int16_t)(centerHotSpots ? image.height / 2 : 0);
+        entry.reserved = 0;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const JAtlasEntry &a, const JAtlasEntry &b) { return a.nameHash < b.nameHash; });
+
+    JAtlasHeader header;
+    header.magic = ATLAS_MAGIC;
+    header.version = ATLAS_VERSION;
+    header.pageCount = (uint16_t)packers.size();
+    header.entryCount = (uint32_t)entries.size();
+
+    std::string indexPath = output + ".atlas";
+    FILE *file = fopen(indexPath.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("could not write %s\n", indexPath.c_str());
+        return 1;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    if (!entries.empty())
+        fwrite(&entries[0], sizeof(JAtlasEntry), entries.size(), file);
+    fclose(file);
+
+    printf("%d images packed in %d pages\n", (int)images.size(), (int)packers.size());
+    return 0;
+}
@@ -0,0 +1,348 @@
+//////////////////////////////////////////////////////////////////////////
+/// headlesscheck - draws fixed scenes on the headless GL and fails when
+/// the draw calls or upload bytes recorded for them change, so that a
+/// change batching less is caught without a GPU.
+///
+/// It also rasterizes a frame on the CPU and fails when it differs from
+/// the golden image, golden/frame.png here, decodes compressed blocks of
+/// known colors and loads damaged ktx files, expected to be rejected.
+///
+/// Usage: headlesscheck [-u] <work dir> <golden dir>
+///
+///		-u		write the golden image instead of comparing with it,
+///				after a change meant to alter the drawing
+///
+/// Run from the shaders folder. The font drawn is generated into the
+/// work dir. Built and run by "make check" at the top of the tree.
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include <string>
+#include <vector>
+
+#include "JRenderer.h"
+#include "JLBFont.h"
+#include "JResourceManager.h"
+#include "JTextureDecoder.h"
+#include "JGLHeadless.h"
+#include "JGLRasterizer.h"
+
+#define FONT_SIZE		256
+#define FONT_CELL		16
+
+// largest channel difference with the golden image still counted as equal
+#define GOLDEN_TOLERANCE	2
+
+static int failures = 0;
+
+static void Expect(const char *scene, const char *what, long value, long expected)
+{
+    if (value == expected)
+        return;
+
+    printf("%s: %s is %ld, expected %ld\n", scene, what, value, expected);
+    failures++;
+}
+
+static bool WritePNG(const std::string &path, const std::vector<uint32_t> &bits, int width, int height)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png_create_info_struct(png);
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+
+    for (int y = 0; y < height; y++)
+        png_write_row(png, (png_const_bytep)&bits[y * width]);
+
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(file);
+
+    return true;
+}
+
+// 16x16 cells of blocky glyphs, widths varying with the character, in the layout JLBFont reads
+static bool WriteFont(const std::string &name)
+{
+    std::vector<uint32_t> bits(FONT_SIZE * FONT_SIZE, 0);
+    short widths[1024];
+
+    for (int n = 0; n < 256; n++)
+    {
+        int cellX = (n % 16) * FONT_CELL;
+        int cellY = (n / 16) * FONT_CELL;
+        int width = 4 + n % 9;
+
+        for (int y = 2; y < FONT_CELL - 2; y++)
+            for (int x = 1; x <= width; x++)
+                if (((x + y + n) & 3) != 0)
+                    bits[(cellY + y) * FONT_SIZE + cellX + x] = 0xFFFFFFFF;
+
+        widths[n * 4] = (short)cellX;
+        widths[n * 4 + 1] = 1;
+        widths[n * 4 + 2] = (short)width;
+        widths[n * 4 + 3] = 1;
+    }
+
+    FILE *file = fopen((name + ".dat").c_str(), "wb");
+    if (file == NULL)
+        return false;
+    fwrite(widths, sizeof(widths), 1, file);
+    fclose(file);
+
+    return WritePNG(name + ".png", bits, FONT_SIZE, FONT_SIZE);
+}
+
+static JTexture* CreateSpriteTexture()
+{
+    std::vector<PIXEL_TYPE> bits(64 * 64);
+    for (int y = 0; y < 64; y++)
+        for (int x = 0; x < 64; x++)
+            bits[y * 64 + x] = ARGB_TO_RGBA8(ARGB((255 - x), x * 4, y * 4, 160));
+
+    JTexture *tex = JRenderer::GetInstance()->CreateTexture(64, 64);
+    tex->UpdateBits(64, 64, &bits[0]);
+    return tex;
+}
+
+// sprites of one texture and a string, expected to go out as one batch each
+static void DrawSprites(JTexture *sprites, JLBFont *font)
+{
+    JRenderer *renderer = JRenderer::GetInstance();
+
+    JQuad quad(sprites, 0, 0, 32, 32);
+    quad.SetHotSpot(16, 16);
+    for (int i = 0; i < 20; i++)
+        renderer->RenderQuad(&quad, 40.0f + i * 20.0f, 60.0f + (i % 4) * 30.0f, i * 0.2f);
+
+    font->DrawString("Headless check 1234", 20, 200);
+}
+
+static void CheckSprites(JTexture *sprites, JLBFont *font)
+{
+    JRenderer *renderer = JRenderer::GetInstance();
+    JGLRecorder *recorder = JGLRecorder::GetInstance();
+
+    // the first frame also caches the glyph run of the string
+    for (int frame = 0; frame < 2; frame++)
+    {
+        recorder->ResetStats();
+        renderer->BeginScene();
+        DrawSprites(sprites, font);
+        renderer->EndScene();
+    }
+
+    const JRenderStats *stats = renderer->GetFrameStats();
+    const JGLStats &gl = recorder->GetStats();
+
+    Expect("sprites", "draw calls", stats->drawCalls, 2);
+    Expect("sprites", "vertices", stats->vertices, 234);
+    Expect("sprites", "upload bytes", stats->uploadBytes, 3120);
+    Expect("sprites", "texture uploads", gl.textureUploads, 0);
+    Expect("sprites", "gl draw calls", gl.drawCalls, stats->drawCalls);
+    Expect("sprites", "gl buffer bytes", gl.bufferUploadBytes, stats->uploadBytes);
+}
+
+// sprites in both blend modes over filled and outlined shapes and lines
+static void DrawGolden(JTexture *sprites, JLBFont *font)
+{
+    JRenderer *renderer = JRenderer::GetInstance();
+
+    renderer->FillRect(0, 0, SCREEN_WIDTH_F, SCREEN_HEIGHT_F, ARGB(255, 20, 30, 60));
+    renderer->FillRect(40, 40, 160, 100, ARGB(255, 200, 60, 40));
+    renderer->DrawRect(240, 40, 160, 100, ARGB(255, 240, 240, 240));
+    renderer->DrawLine(20, 180, 460, 250, ARGB(255, 255, 255, 0));
+    renderer->DrawLine(20, 250, 460, 180, 4.0f, ARGB(160, 0, 255, 120));
+
+    JQuad quad(sprites, 0, 0, 64, 64);
+    quad.SetHotSpot(32, 32);
+    for (int i = 0; i < 4; i++)
+        renderer->RenderQuad(&quad, 80.0f + i * 50.0f, 90.0f, i * 0.4f);
+
+    renderer->SetTexBlend(BLEND_SRC_ALPHA, BLEND_ONE);
+    for (int i = 0; i < 4; i++)
+        renderer->RenderQuad(&quad, 280.0f + i * 40.0f, 90.0f + (i % 2) * 20.0f, 0.0f, 1.5f, 1.5f);
+    renderer->SetTexBlend(BLEND_SRC_ALPHA, BLEND_ONE_MINUS_SRC_ALPHA);
+
+    font->DrawShadowedString("Golden 1234", 240, 200, JGETEXT_CENTER);
+}
+
+static void CheckGolden(JTexture *sprites, JLBFont *font, const std::string &golden, bool update)
+{
+    JRenderer *renderer = JRenderer::GetInstance();
+    JGLRasterizer *rasterizer = JGLRasterizer::GetInstance();
+
+    rasterizer->SetEnabled(true);
+    renderer->BeginScene();
+    DrawGolden(sprites, font);
+    renderer->EndScene();
+    rasterizer->SetEnabled(false);
+
+    if (update)
+    {
+        if (rasterizer->SavePNG(golden.c_str()))
+            printf("Wrote %s\n", golden.c_str());
+        else
+            Expect("golden", "written", 0, 1);
+        return;
+    }
+
+    Expect("golden", "differing pixels", rasterizer->ComparePNG(golden.c_str(), GOLDEN_TOLERANCE), 0);
+}
+
+static long Rgba(int r, int g, int b, int a)
+{
+    return ((long)r << 24) | (g << 16) | (b << 8) | a;
+}
+
+static long Pixel(const unsigned char *pixels, int x, int y)
+{
+    const unsigned char *p = pixels + (y * 4 + x) * 4;
+    return Rgba(p[0], p[1], p[2], p[3]);
+}
+
+// one 4x4 block per format, colors worked out by hand from the format specs
+static void CheckDecoder()
+{
+    // BC1 red and blue endpoints, the first row using the four colors
+    static const unsigned char bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0x00, 0x00, 0x00 };
+    // BC3 alpha 255 and 0, the first pixel using the second, over the block above
+    static const unsigned char bc3[16] = { 0xFF, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                           0x00, 0xF8, 0x1F, 0x00, 0xE4, 0x00, 0x00, 0x00 };
+    // ETC1 differential gray 132, table 0, the first pixel -8 and the others +8
+    static const unsigned char etc1[8] = { 0x80, 0x80, 0x80, 0x02, 0x00, 0x01, 0xFF, 0xFF };
+    // EAC alpha base 128 multiplier 1 table 0, the first pixel +14 and the others -3, over the block above
+    static const unsigned char etc2eac[16] = { 0x80, 0x10, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                               0x80, 0x80, 0x80, 0x02, 0x00, 0x01, 0xFF, 0xFF };
+    unsigned char pixels[4 * 4 * 4];
+
+    JTextureDecoder::Decode(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, bc1, 4, 4, pixels);
+    Expect("decoder", "bc1 color 0", Pixel(pixels, 0, 0), Rgba(255, 0, 0, 255));
+    Expect("decoder", "bc1 color 1", Pixel(pixels, 1, 0), Rgba(0, 0, 255, 255));
+    Expect("decoder", "bc1 color 2", Pixel(pixels, 2, 0), Rgba(170, 0, 85, 255));
+    Expect("decoder", "bc1 color 3", Pixel(pixels, 3, 0), Rgba(85, 0, 170, 255));
+    Expect("decoder", "bc1 last pixel", Pixel(pixels, 3, 3), Rgba(255, 0, 0, 255));
+
+    JTextureDecoder::Decode(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, bc3, 4, 4, pixels);
+    Expect("decoder", "bc3 first pixel", Pixel(pixels, 0, 0), Rgba(255, 0, 0, 0));
+    Expect("decoder", "bc3 second pixel", Pixel(pixels, 1, 0), Rgba(0, 0, 255, 255));
+
+    JTextureDecoder::Decode(GL_ETC1_RGB8_OES, etc1, 4, 4, pixels);
+    Expect("decoder", "etc1 first pixel", Pixel(pixels, 0, 0), Rgba(124, 124, 124, 255));
+    Expect("decoder", "etc1 last pixel", Pixel(pixels, 3, 3), Rgba(140, 140, 140, 255));
+
+    JTextureDecoder::Decode(GL_COMPRESSED_RGBA8_ETC2_EAC, etc2eac, 4, 4, pixels);
+    Expect("decoder", "etc2 eac first pixel", Pixel(pixels, 0, 0), Rgba(124, 124, 124, 142));
+    Expect("decoder", "etc2 eac last pixel", Pixel(pixels, 3, 3), Rgba(140, 140, 140, 125));
+}
+
+// ktx 1.1 file of one ETC1 level, its header fields and level size given
+static bool WriteKTX(const std::string &path, uint32_t width, uint32_t height, uint32_t levels, uint32_t keyValueBytes,
+                     uint32_t levelSize, size_t truncate = 0)
+{
+    static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    uint32_t header[13] = { 0x04030201, 0, 1, 0, GL_ETC1_RGB8_OES, 0x1907, width, height, 0, 0, 1, levels, keyValueBytes };
+
+    std::vector<unsigned char> data(identifier, identifier + sizeof(identifier));
+    data.insert(data.end(), (const unsigned char*)header, (const unsigned char*)header + sizeof(header));
+    data.insert(data.end(), (const unsigned char*)&levelSize, (const unsigned char*)&levelSize + 4);
+    data.resize(data.size() + 8, 0x80);
+    if (truncate > 0)
+        data.resize(truncate);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    fwrite(&data[0], 1, data.size(), file);
+    fclose(file);
+    return true;
+}
+
+static void ExpectKTX(const std::string &dir, const char *what, bool valid, uint32_t width, uint32_t height, uint32_t levels,
+                      uint32_t keyValueBytes, uint32_t levelSize, size_t truncate = 0)
+{
+    std::string path = dir + "/check.ktx";
+    if (!WriteKTX(path, width, height, levels, keyValueBytes, levelSize, truncate))
+    {
+        Expect("ktx", "written", 0, 1);
+        return;
+    }
+
+    JTexture *tex = JResourceManager::LoadTextureFromFile(path.c_str());
+    Expect("ktx", what, tex != NULL, valid);
+    delete tex;
+}
+
+// the loader messages of the rejected files are expected
+static void CheckKTX(const std::string &dir)
+{
+    ExpectKTX(dir, "valid file loaded", true, 4, 4, 1, 0, 8);
+    ExpectKTX(dir, "truncated header loaded", false, 4, 4, 1, 0, 8, 40);
+    ExpectKTX(dir, "truncated level loaded", false, 4, 4, 1, 0, 8, 72);
+    ExpectKTX(dir, "short level loaded", false, 8, 8, 1, 0, 8);
+    ExpectKTX(dir, "oversized image loaded", false, 131072, 131072, 1, 0, 0);
+    ExpectKTX(dir, "oversized key value data loaded", false, 4, 4, 1, 0xFFFFFFF0u, 8);
+    ExpectKTX(dir, "too many levels loaded", false, 4, 4, 0xFFFFFFFFu, 0, 8);
+}
+
+int main(int argc, char *argv[])
+{
+    bool update = argc > 1 && strcmp(argv[1], "-u") == 0;
+    int arg = update ? 2 : 1;
+    if (argc - arg != 2)
+    {
+        printf("Usage: headlesscheck [-u] <work dir> <golden dir>\n");
+        return 1;
+    }
+
+    std::string fontName = std::string(argv[arg]) + "/font";
+    if (!WriteFont(fontName))
+    {
+        printf("Could not write %s\n", fontName.c_str());
+        return 1;
+    }
+
+    JGLRecorder *recorder = JGLRecorder::GetInstance();
+    recorder->ResetStats();
+    JTexture *sprites = CreateSpriteTexture();
+    JLBFont *font = new JLBFont(fontName.c_str(), FONT_CELL);
+    Expect("load", "texture upload bytes", recorder->GetStats().textureUploadBytes, 64 * 64 * 4 * 2 + FONT_SIZE * FONT_SIZE * 4);
+    // the sprite texture made then filled, the font png without generated mipmaps
+    Expect("load", "texture uploads", recorder->GetStats().textureUploads, 3);
+
+    CheckSprites(sprites, font);
+    CheckGolden(sprites, font, std::string(argv[arg + 1]) + "/frame.png", update);
+    CheckDecoder();
+    CheckKTX(argv[arg]);
+
+    delete font;
+    delete sprites;
+    JRenderer::Destroy();
+
+    if (failures > 0)
+    {
+        printf("headlesscheck: %d failures\n", failures);
+        return 1;
+    }
+
+    printf("headlesscheck: passed\n");
+    return 0;
+}